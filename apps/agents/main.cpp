@@ -0,0 +1,120 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include "agents.hpp"
+#include "strategy.hpp"
+
+/**
+ * agents — runs a crowd of coroutine player sessions against simulated tables.
+ *
+ *   agents [--sessions N] [--tables N] [--threads N] [--rounds N]
+ *          [--bankroll B] [--american] [--seed S] [--strategy FILE]
+ *
+ * Every session is one coroutine (see agents.hpp) that sits at a table and
+ * plays a strategy script (default: 10 on red) for up to --rounds rounds,
+ * until it stops or goes broke. Reports the throughput, the cost of a
+ * session switch, the frame memory per session and the house's hold.
+ */
+
+static Task player(SimTable& table, const StrategyProgram& program, double bankroll, int rounds) {
+    Seat seat(table, bankroll);
+    ScriptedStrategy strategy(program);
+    for (int r = 0; r < rounds; ++r) {
+        Decision d = strategy.decide(seat.bankroll());
+        if (d.kind == Decision::Kind::Stop) break;
+        if (d.kind == Decision::Kind::Bet && !co_await seat.place(d)) break;      // can't cover it
+        const RoundOutcome o = co_await seat.next_round();
+        strategy.observe(o.index, d, o.paid > 0.0);
+    }
+}
+
+int main(int argc, char** argv) {
+    int sessions = 100000, tables = 1000, threads = 0, rounds = 100;
+    double bankroll = 1000.0;
+    uint64_t seed = 1;
+    Wheel::Type type = Wheel::Type::European;
+    std::string source = "bet red 10\n";
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { std::cerr << "missing value for " << a << "\n"; std::exit(2); }
+            return argv[++i];
+        };
+        if (a == "--sessions")      sessions = std::atoi(next());
+        else if (a == "--tables")   tables = std::max(1, std::atoi(next()));
+        else if (a == "--threads")  threads = std::atoi(next());
+        else if (a == "--rounds")   rounds = std::atoi(next());
+        else if (a == "--bankroll") bankroll = std::atof(next());
+        else if (a == "--american") type = Wheel::Type::American;
+        else if (a == "--seed")     seed = std::strtoull(next(), nullptr, 10);
+        else if (a == "--strategy") {
+            std::ifstream in(next());
+            if (!in) { std::cerr << "cannot read " << argv[i] << "\n"; return 1; }
+            std::stringstream ss;
+            ss << in.rdbuf();
+            source = ss.str();
+        } else { std::cerr << "unknown option " << a << "\n"; return 2; }
+    }
+
+    std::unique_ptr<StrategyProgram> program;
+    try {
+        program = std::make_unique<StrategyProgram>(source);
+    } catch (const std::exception& e) {
+        std::cerr << "strategy: " << e.what() << "\n";
+        return 1;
+    }
+
+    Executor exec(threads);
+    std::vector<std::unique_ptr<SimTable>> floor;
+    for (int t = 0; t < tables; ++t)
+        floor.push_back(std::make_unique<SimTable>(exec, type, seed + 0x9E3779B97F4A7C15ull * (t + 1)));
+
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int s = 0; s < sessions; ++s) exec.spawn(player(*floor[s % tables], *program, bankroll, rounds));
+    // Open the tables once everyone has sat down, so the first rounds are full.
+    auto seated = [&] {
+        uint64_t n = 0;
+        for (auto& t : floor) n += t->joined();
+        return n;
+    };
+    while (seated() < (uint64_t)sessions) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    const size_t pooled = FramePool::reserved();
+    const auto t1 = std::chrono::steady_clock::now();
+    const double spawn_secs = std::chrono::duration<double>(t1 - t0).count();
+    for (auto& t : floor) t->open();
+    exec.wait();
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+
+    uint64_t spins = 0;
+    double staked = 0.0, paid = 0.0;
+    for (auto& t : floor) {
+        spins += t->rounds();
+        staked += t->staked();
+        paid += t->paid();
+    }
+    rusage ru{};
+    ::getrusage(RUSAGE_SELF, &ru);
+#if defined(__APPLE__)
+    const double rss_mb = ru.ru_maxrss / 1048576.0;
+#else
+    const double rss_mb = ru.ru_maxrss / 1024.0;
+#endif
+
+    const uint64_t resumes = exec.resumes();
+    std::printf("%d sessions at %d tables on %zu threads: seated in %.2f s, played in %.2f s\n", sessions, tables,
+                exec.threads(), spawn_secs, secs);
+    std::printf("spins %llu, session resumes %llu (%.1fM/s, %.0f ns each per thread), steals %llu\n",
+                (unsigned long long)spins, (unsigned long long)resumes, resumes / secs / 1e6,
+                secs * exec.threads() * 1e9 / std::max<uint64_t>(1, resumes), (unsigned long long)exec.steals());
+    std::printf("frame pool %.1f MB after spawning (%.0f bytes/session), peak RSS %.1f MB\n", pooled / 1048576.0,
+                (double)pooled / std::max(1, sessions), rss_mb);
+    std::printf("staked %.2f, paid %.2f, hold %.3f%%\n", staked, paid, staked > 0 ? 100.0 * (staked - paid) / staked : 0.0);
+}
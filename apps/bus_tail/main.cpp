@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "shm_bus.hpp"
+
+/**
+ * bus_tail — follows the round-result bus of a local roulette_server.
+ *
+ *   bus_tail NAME [--from-oldest] [--count N] [--quiet] [--spin US]
+ *
+ * Prints one line per finished round as it is published. On exit (after
+ * N records, Ctrl-C or the server closing the bus) it reports how many
+ * records were read or lost to overruns, and the publish-to-read latency.
+ * --spin keeps polling that long before sleeping on the futex.
+ */
+
+static volatile std::sig_atomic_t g_stop = 0;
+
+int main(int argc, char** argv) {
+    std::string name;
+    bool from_oldest = false, quiet = false;
+    uint64_t count = UINT64_MAX;
+    std::chrono::microseconds spin{20};
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--from-oldest")              from_oldest = true;
+        else if (a == "--quiet")               quiet = true;
+        else if (a == "--count" && i + 1 < argc) count = std::strtoull(argv[++i], nullptr, 10);
+        else if (a == "--spin" && i + 1 < argc)  spin = std::chrono::microseconds(std::atoll(argv[++i]));
+        else if (name.empty() && a[0] != '-')  name = a;
+        else { std::cerr << "usage: bus_tail NAME [--from-oldest] [--count N] [--quiet] [--spin US]\n"; return 2; }
+    }
+    if (name.empty()) { std::cerr << "usage: bus_tail NAME [--from-oldest] [--count N] [--quiet] [--spin US]\n"; return 2; }
+    std::signal(SIGINT, [](int) { g_stop = 1; });
+
+    std::unique_ptr<SpinBusReader> reader;
+    try {
+        reader = std::make_unique<SpinBusReader>(name, from_oldest);
+    } catch (const std::exception& e) {
+        std::cerr << "bus_tail: " << e.what() << "\n";
+        return 1;
+    }
+    SpinBusReader& bus = *reader;
+    std::vector<int64_t> latency;
+    uint64_t read = 0;
+    RoundRecord r;
+    while (!g_stop && read < count) {
+        const SpinBusReader::Status st = bus.try_read(r);
+        if (st == SpinBusReader::Status::Closed) break;
+        if (st == SpinBusReader::Status::Empty) {
+            if (!bus.wait(std::chrono::milliseconds(200), spin) && !bus.writer_alive()) break;
+            continue;
+        }
+        const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        latency.push_back(now - r.time_ns);
+        ++read;
+        if (quiet) continue;
+        std::printf("table %u round %llu %.3s staked %.2f paid %.2f seats %u", r.table, (unsigned long long)r.round,
+                    r.label, r.staked, r.paid, r.settlements);
+        if (r.nonce != RoundRecord::NO_NONCE) std::printf(" nonce %llu", (unsigned long long)r.nonce);
+        std::printf("\n");
+    }
+
+    std::printf("%llu records, %llu lost", (unsigned long long)read, (unsigned long long)bus.lost());
+    if (!latency.empty()) {
+        std::sort(latency.begin(), latency.end());
+        auto pct = [&](double p) { return latency[(size_t)(p * (latency.size() - 1))] / 1000.0; };
+        std::printf(", latency us p50 %.1f p99 %.1f max %.1f", pct(0.5), pct(0.99), pct(1.0));
+    }
+    std::printf("\n");
+}
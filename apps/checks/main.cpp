@@ -0,0 +1,391 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "audit.hpp"
+#include "chacha.hpp"
+#include "ledger.hpp"
+#include "provably_fair.hpp"
+#include "sha256.hpp"
+#include "snapshot.hpp"
+
+/**
+ * checks — known answers and crash cases for the durable and crypto code.
+ *
+ *   checks [--dir DIR]
+ *
+ * SHA-256 (FIPS 180-2), HMAC-SHA256 (RFC 4231) and ChaCha20 (zero key and
+ * nonce, as in RFC 7539 A.1) against published vectors, scalar and eight-lane
+ * paths alike; an audit log that verifies and then fails once tampered with;
+ * a ledger cut back to its last whole record after a torn or corrupt tail;
+ * and a snapshot plus ledger tail recovering the same tables as a replay of
+ * the whole ledger. Scratch files go in DIR (default /tmp) and are removed.
+ * Exit status is 0 only if every check passes.
+ */
+
+static int g_failed = 0;
+
+static void check(const std::string& what, bool ok) {
+    std::printf("%s  %s\n", ok ? "ok  " : "FAIL", what.c_str());
+    if (!ok) ++g_failed;
+}
+
+static std::string hex(const uint8_t* p, size_t n) {
+    static const char digits[] = "0123456789abcdef";
+    std::string s;
+    for (size_t i = 0; i < n; ++i) {
+        s += digits[p[i] >> 4];
+        s += digits[p[i] & 15];
+    }
+    return s;
+}
+
+static std::string hex(const Sha256Digest& d) { return hex(d.data(), d.size()); }
+
+static std::vector<uint8_t> read_file(const std::string& path) {
+    std::vector<uint8_t> data;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return data;
+    uint8_t buf[1 << 16];
+    for (ssize_t n; (n = ::read(fd, buf, sizeof buf)) > 0;) data.insert(data.end(), buf, buf + n);
+    ::close(fd);
+    return data;
+}
+
+static void write_file(const std::string& path, const std::vector<uint8_t>& data) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0 || ::write(fd, data.data(), data.size()) != (ssize_t)data.size())
+        throw std::runtime_error("cannot write " + path + ": " + std::strerror(errno));
+    ::close(fd);
+}
+
+static off_t file_size(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+// ---------- SHA-256 and HMAC ----------
+
+static void check_sha256() {
+    struct Vector { std::string msg; const char* digest; };
+    const Vector vectors[] = {
+        { "", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+        { "abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+        { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+          "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+        { std::string(1000000, 'a'), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" },
+    };
+    const int count = (int)(sizeof vectors / sizeof vectors[0]);
+
+    const uint8_t* msgs[8];
+    size_t lens[8];
+    Sha256Digest lanes[8];
+    for (int i = 0; i < count; ++i) {
+        msgs[i] = reinterpret_cast<const uint8_t*>(vectors[i].msg.data());
+        lens[i] = vectors[i].msg.size();
+    }
+    sha256_x8(msgs, lens, lanes, count);
+
+    for (int i = 0; i < count; ++i) {
+        const Vector& v = vectors[i];
+        const std::string name = "sha256 of " + std::to_string(v.msg.size()) + " bytes";
+        check(name, hex(sha256(v.msg.data(), v.msg.size())) == v.digest);
+
+        Sha256 h;                       // odd-sized pieces cross every block boundary differently
+        for (size_t at = 0; at < v.msg.size(); at += 61)
+            h.update(v.msg.data() + at, std::min<size_t>(61, v.msg.size() - at));
+        check(name + ", streamed", hex(h.final()) == v.digest);
+        check(name + ", eight-lane", hex(lanes[i]) == v.digest);
+    }
+}
+
+static void check_hmac() {
+    struct Vector { std::string key, msg; const char* mac; };
+    const Vector vectors[] = {
+        { std::string(20, '\x0b'), "Hi There", "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7" },
+        { "Jefe", "what do ya want for nothing?", "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843" },
+        { std::string(131, '\xaa'), "Test Using Larger Than Block-Size Key - Hash Key First",
+          "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54" },
+    };
+    for (int i = 0; i < 3; ++i) {
+        const Vector& v = vectors[i];
+        const HmacSha256 key(v.key.data(), v.key.size());
+        const std::string name = "hmac-sha256 rfc 4231 case " + std::to_string(i == 2 ? 6 : i + 1);
+        check(name, hex(key.mac(v.msg.data(), v.msg.size())) == v.mac);
+
+        const uint8_t* msgs[8];
+        size_t lens[8];
+        Sha256Digest out[8];
+        for (int l = 0; l < 8; ++l) {
+            msgs[l] = reinterpret_cast<const uint8_t*>(v.msg.data());
+            lens[l] = v.msg.size();
+        }
+        key.mac_x8(msgs, lens, out, 8);
+        bool all = true;
+        for (int l = 0; l < 8; ++l) all = all && hex(out[l]) == v.mac;
+        check(name + ", eight-lane", all);
+    }
+}
+
+// ---------- ChaCha20 ----------
+
+static void check_chacha() {
+    // keystream blocks 0 and 1 under the all-zero key and nonce
+    const char* stream =
+        "76b8e0ada0f13d90405d6ae55386bd28bdd219b8a08ded1aa836efcc8b770dc7"
+        "da41597c5157488d7724e03fb8d84a376a43b8f41518a11cc387b669b2ee6586"
+        "9f07e7be5551387a98ba977c732d080dcb0f29a048e3656912c6533e32ee7aed"
+        "29b721769ce64e43d57133b074d839d531ed1f28510afb45ace10a1f4b794d6f";
+    const ChaCha20::Key zero{};
+
+    uint32_t words[32];
+    ChaCha20::block(zero, 0, 0, words);
+    ChaCha20::block(zero, 0, 1, words + 16);
+    uint8_t bytes[128];
+    std::memcpy(bytes, words, sizeof bytes);       // keystream words are little-endian
+    check("chacha20 zero-key blocks, portable", hex(bytes, sizeof bytes) == stream);
+
+    ChaCha20 engine(zero, 0);
+    for (uint32_t& w : words) w = engine();
+    std::memcpy(bytes, words, sizeof bytes);
+    check("chacha20 zero-key blocks, engine", hex(bytes, sizeof bytes) == stream);
+
+    // all eight blocks of a refill, whichever path made them
+    const ChaCha20::Key key = [] {
+        ChaCha20::Key k;
+        for (int i = 0; i < 8; ++i) k[i] = 0x01020304u * (i + 1);
+        return k;
+    }();
+    ChaCha20 keyed(key, 7);
+    bool same = true;
+    for (uint64_t b = 0; b < 3 * ChaCha20::BLOCKS; ++b) {
+        uint32_t ref[16];
+        ChaCha20::block(key, 7, b, ref);
+        for (uint32_t w : ref) same = same && keyed() == w;
+    }
+    check("chacha20 engine matches the portable block function", same);
+
+    ChaCha20 seeded(42);
+    for (int i = 0; i < 1000; ++i) seeded();
+    std::stringstream saved;
+    saved << seeded;
+    ChaCha20 loaded;
+    saved >> loaded;
+    same = bool(saved) && loaded == seeded;
+    for (int i = 0; i < 1000; ++i) same = same && loaded() == seeded();
+    check("chacha20 state saves and loads", same);
+}
+
+// ---------- audit log ----------
+
+static void check_audit(const std::string& dir) {
+    const std::string path = dir + "/checks-" + std::to_string(::getpid()) + ".audit";
+    ::unlink(path.c_str());
+    {
+        AuditLog log(path);
+        for (uint32_t i = 0; i < 40; ++i) {
+            AuditEntry e;
+            e.table = i % 3;
+            e.round = i / 3 + 1;
+            e.index = (int)(i * 7 % 37);
+            e.time_ns = 1000 * i;
+            for (uint32_t s = 0; s < i % 4; ++s) e.settlements.push_back(AuditSettlement{ s, 10.0, s ? 0.0 : 20.0 });
+            log.record(std::move(e));
+        }
+    }
+    std::vector<uint8_t> data = read_file(path);
+    AuditReport rep = verify_audit(data.data(), data.size(), 3);
+    check("audit log of 40 records verifies", rep.records == 40 && rep.bad == 0 && !rep.truncated &&
+                                              rep.heads.size() == 3);
+
+    data[data.size() / 2] ^= 1;
+    rep = verify_audit(data.data(), data.size(), 3);
+    check("audit log with one flipped bit fails", rep.bad > 0 || rep.truncated);
+    ::unlink(path.c_str());
+}
+
+// ---------- ledger ----------
+
+static LedgerRecord make_record(uint32_t table, uint32_t seat, LedgerRecord::Kind kind, uint64_t ref,
+                                double amount, double balance, const std::string& text = "",
+                                Bet::Type type = Bet::Type::Red) {
+    LedgerRecord r;
+    r.table = table;
+    r.seat = seat;
+    r.kind = kind;
+    r.ref = ref;
+    r.amount = amount;
+    r.balance = balance;
+    r.bet_type = (uint8_t)type;
+    set_record_text(r, text);
+    return r;
+}
+
+static uint64_t append_all(const std::string& path, const std::vector<LedgerRecord>& records) {
+    LedgerConfig lc;
+    lc.path = path;
+    Ledger ledger(lc);
+    uint64_t lsn = ledger.durable_lsn();
+    for (const LedgerRecord& r : records) lsn = ledger.append(r);
+    ledger.wait_durable(lsn);
+    return lsn;
+}
+
+static uint64_t last_lsn(const std::string& path) { return replay_ledger(path, 0, [](const LedgerRecord&) {}); }
+
+static void check_ledger(const std::string& dir) {
+    using Kind = LedgerRecord::Kind;
+    const std::string path = dir + "/checks-" + std::to_string(::getpid()) + ".ledger";
+    const off_t REC = (off_t)sizeof(LedgerRecord);
+    ::unlink(path.c_str());
+
+    std::vector<LedgerRecord> five;
+    for (uint32_t s = 0; s < 5; ++s)
+        five.push_back(make_record(0, s, Kind::Sit, 0, 0.0, 100.0 * (s + 1), "p" + std::to_string(s)));
+    check("ledger appends lsn 1..5", append_all(path, five) == 5 && last_lsn(path) == 5);
+
+    // a crash mid-batch: a sixth record that never checked out and half a seventh
+    std::vector<uint8_t> data = read_file(path);
+    data.insert(data.end(), (size_t)REC * 3 / 2, 0xAB);
+    write_file(path, data);
+    check("replay stops before a torn tail", last_lsn(path) == 5);
+    const uint64_t lsn = append_all(path, { make_record(0, 0, Kind::Leave, 0, 0.0, 100.0) });
+    check("reopening cuts a torn tail and appends after it",
+          lsn == 6 && last_lsn(path) == 6 && file_size(path) == 6 * REC);
+
+    // a whole but corrupt last record goes the same way
+    data = read_file(path);
+    data[data.size() - 20] ^= 0x40;
+    write_file(path, data);
+    check("replay stops before a corrupt record", last_lsn(path) == 5);
+    {
+        LedgerConfig lc;
+        lc.path = path;
+        Ledger ledger(lc);
+        check("reopening cuts a corrupt tail", ledger.durable_lsn() == 5 && file_size(path) == 5 * REC);
+    }
+    ::unlink(path.c_str());
+}
+
+// ---------- snapshot plus ledger tail ----------
+
+static bool same_image(const TableImage& a, const TableImage& b) {
+    if (a.id != b.id || a.round != b.round || a.lsn != b.lsn || a.rng != b.rng || a.spins_after != b.spins_after ||
+        a.pending_index != b.pending_index || a.seats.size() != b.seats.size() || a.bets.size() != b.bets.size())
+        return false;
+    for (size_t i = 0; i < a.seats.size(); ++i)
+        if (a.seats[i].name != b.seats[i].name || a.seats[i].balance != b.seats[i].balance ||
+            a.seats[i].occupied != b.seats[i].occupied)
+            return false;
+    for (size_t i = 0; i < a.bets.size(); ++i)
+        if (a.bets[i].handle != b.bets[i].handle || a.bets[i].seat != b.bets[i].seat ||
+            a.bets[i].type != b.bets[i].type || a.bets[i].selection != b.bets[i].selection ||
+            a.bets[i].amount != b.bets[i].amount)
+            return false;
+    return true;
+}
+
+static void check_recovery(const std::string& dir) {
+    using Kind = LedgerRecord::Kind;
+    using T = Bet::Type;
+    const std::string base = dir + "/checks-" + std::to_string(::getpid());
+    const std::string ledger_path = base + ".ledger", snap_path = base + ".snap";
+    ::unlink(ledger_path.c_str());
+    ::unlink(snap_path.c_str());
+
+    // two tables, interleaved: a settled round on each, then open bets and a departure
+    const std::vector<LedgerRecord> records = {
+        make_record(0, 0, Kind::Sit, 0, 0.0, 1000.0, "alice"),
+        make_record(1, 0, Kind::Sit, 0, 0.0, 200.0, "carol"),
+        make_record(0, 1, Kind::Sit, 0, 0.0, 500.0, "bob"),
+        make_record(0, 0, Kind::Place, 1, 10.0, 990.0, "", T::Red),
+        make_record(1, 0, Kind::Place, 1, 20.0, 180.0, "2", T::Dozen),
+        make_record(0, 1, Kind::Place, 2, 5.0, 495.0, "17", T::Straight),
+        make_record(0, 0, Kind::Modify, 1, 20.0, 980.0),
+        make_record(1, 0, Kind::Spin, 1, 14.0, 0.0),
+        make_record(0, 0, Kind::Spin, 1, 17.0, 0.0),
+        make_record(1, 0, Kind::Settle, 1, 60.0, 240.0),
+        make_record(0, 0, Kind::Settle, 1, 0.0, 980.0),
+        make_record(0, 1, Kind::Settle, 1, 180.0, 675.0),
+        make_record(0, 0, Kind::Place, 3, 30.0, 950.0, "2", T::Dozen),
+        make_record(1, 0, Kind::Place, 2, 10.0, 230.0, "", T::Black),
+        make_record(0, 1, Kind::Place, 4, 25.0, 650.0, "", T::Odd),
+        make_record(1, 0, Kind::Cancel, 2, 10.0, 240.0),
+        make_record(0, 1, Kind::Leave, 0, 0.0, 675.0),
+    };
+    const uint64_t last = append_all(ledger_path, records);
+
+    const std::vector<TableImage> full = recover_tables("", ledger_path, 2);
+    check("ledger replay rebuilds both tables",
+          last == records.size() && full[0].seats.size() == 2 && full[0].seats[0].balance == 950.0 &&
+          !full[0].seats[1].occupied && full[0].bets.size() == 1 && full[0].round == 2 &&
+          full[1].seats[0].balance == 240.0 && full[1].bets.empty() && full[1].round == 2);
+
+    // tables are captured one by one, so each image stops at its own LSN
+    const uint64_t cut[2] = { 9, 5 };
+    std::vector<TableImage> snap(2);
+    for (uint32_t t = 0; t < 2; ++t) snap[t].id = t;
+    replay_ledger(ledger_path, 0, [&](const LedgerRecord& r) {
+        if (r.lsn <= cut[r.table]) apply_record(snap[r.table], r);
+    });
+    write_snapshot(snap_path, encode_snapshot(snap));
+    std::vector<TableImage> loaded;
+    check("snapshot loads back as written",
+          load_snapshot(snap_path, loaded) && loaded.size() == 2 && same_image(loaded[0], snap[0]) &&
+          same_image(loaded[1], snap[1]));
+
+    const std::vector<TableImage> recovered = recover_tables(snap_path, ledger_path, 2);
+    check("snapshot plus ledger tail matches a full replay",
+          recovered.size() == 2 && same_image(recovered[0], full[0]) && same_image(recovered[1], full[1]));
+
+    bool restored = true;
+    try {
+        for (const TableImage& img : recovered) {
+            Table table(img.id, Wheel::Type::European, Table::Timing{}, 1);
+            table.restore(img);
+            TableImage back = table.capture();
+            back.rng = img.rng;             // the table keeps its own wheel: the images carry none
+            back.spins_after = img.spins_after;
+            restored = restored && same_image(back, img);
+        }
+    } catch (const std::exception&) {
+        restored = false;
+    }
+    check("recovered tables restore and capture the same", restored);
+
+    ::unlink(ledger_path.c_str());
+    ::unlink(snap_path.c_str());
+}
+
+int main(int argc, char** argv) {
+    std::string dir = "/tmp";
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--dir" && i + 1 < argc) dir = argv[++i];
+        else { std::cerr << "usage: checks [--dir DIR]\n"; return 2; }
+    }
+
+    try {
+        check_sha256();
+        check_hmac();
+        check_chacha();
+        check_audit(dir);
+        check_ledger(dir);
+        check_recovery(dir);
+    } catch (const std::exception& e) {
+        std::cerr << "checks: " << e.what() << "\n";
+        return 1;
+    }
+    if (g_failed) std::printf("%d checks FAILED\n", g_failed);
+    else          std::printf("all checks passed\n");
+    return g_failed ? 1 : 0;
+}
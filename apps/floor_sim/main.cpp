@@ -0,0 +1,70 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "floor_sim.hpp"
+
+/**
+ * floor_sim — simulates a casino floor for staffing and hold forecasts.
+ *
+ *   floor_sim [--tables N] [--seats N] [--days D] [--arrivals PER_HOUR]
+ *             [--spins-per-hour N] [--american-share F] [--session-min M]
+ *             [--relief N] [--shift-min M] [--break-min M] [--seed S]
+ *
+ * Prints the floor totals (handle, hold by wheel type, balked arrivals,
+ * dealer shortages, closed table-hours) and an hour-of-day breakdown of
+ * demand, occupancy and hold. See floor_sim.hpp for the model.
+ */
+
+int main(int argc, char** argv) {
+    FloorConfig cfg;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { std::cerr << "missing value for " << a << "\n"; std::exit(2); }
+            return argv[++i];
+        };
+        if (a == "--tables")              cfg.tables = std::max(1, std::atoi(next()));
+        else if (a == "--seats")          cfg.seats = std::clamp(std::atoi(next()), 1, 255);
+        else if (a == "--days")           cfg.days = std::atof(next());
+        else if (a == "--arrivals")       cfg.arrivals_per_hour = std::atof(next());
+        else if (a == "--spins-per-hour") cfg.spins_per_hour = std::max(1.0, std::atof(next()));
+        else if (a == "--american-share") cfg.american_share = std::atof(next());
+        else if (a == "--session-min")    cfg.session_minutes = std::max(1.0, std::atof(next()));
+        else if (a == "--relief")         cfg.relief_dealers = std::atoi(next());
+        else if (a == "--shift-min")      cfg.shift_minutes = std::max(1.0, std::atof(next()));
+        else if (a == "--break-min")      cfg.break_minutes = std::atof(next());
+        else if (a == "--seed")           cfg.seed = std::strtoull(next(), nullptr, 10);
+        else { std::cerr << "unknown option " << a << "\n"; return 2; }
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    FloorSim sim(cfg);
+    const FloorReport r = sim.run();
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    auto hold = [](double handle, double paid) { return handle > 0 ? 100.0 * (handle - paid) / handle : 0.0; };
+    std::printf("%d tables x %d seats, %.0f days: %llu events in %.1f s (%.0f ns/event)\n", cfg.tables, cfg.seats,
+                r.days, (unsigned long long)r.events, secs, secs * 1e9 / std::max<uint64_t>(1, r.events));
+    std::printf("spins %llu, bets %llu, handle %.0f, paid %.0f, hold %.3f%%\n", (unsigned long long)r.spins,
+                (unsigned long long)r.bets, r.handle, r.paid, hold(r.handle, r.paid));
+    std::printf("  single-zero hold %.3f%% (2.703%% expected), double-zero hold %.3f%% (5.263%% expected)\n",
+                hold(r.handle_by_wheel[0], r.paid_by_wheel[0]), hold(r.handle_by_wheel[1], r.paid_by_wheel[1]));
+    std::printf("arrivals %llu, balked %llu (%.1f%%), sessions %llu (%llu broke), table switches %llu\n",
+                (unsigned long long)r.arrivals, (unsigned long long)r.balked,
+                r.arrivals ? 100.0 * r.balked / r.arrivals : 0.0, (unsigned long long)r.sessions,
+                (unsigned long long)r.broke, (unsigned long long)r.switches);
+    std::printf("dealer breaks %llu, no relief %llu times, closed table-hours %.0f (%.2f%% of table time)\n",
+                (unsigned long long)r.breaks, (unsigned long long)r.relief_shortages, r.closed_table_hours,
+                100.0 * r.closed_table_hours / (cfg.tables * r.days * 24.0));
+
+    std::printf("\nhour  arrivals/day  balked  players  busy tables  closed   handle/day   hold\n");
+    for (int h = 0; h < 24; ++h) {
+        const FloorReport::Hour& x = r.by_hour[h];
+        const double n = (double)std::max<uint64_t>(1, x.samples);
+        std::printf("%02d    %12.1f  %5.1f%%  %7.1f  %11.1f  %6.1f  %11.0f  %5.2f%%\n", h, x.arrivals / r.days,
+                    x.arrivals ? 100.0 * x.balked / x.arrivals : 0.0, x.seated / n, x.busy_tables / n,
+                    x.closed_tables / n, x.handle / r.days, hold(x.handle, x.paid));
+    }
+}
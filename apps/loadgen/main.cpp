@@ -0,0 +1,587 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "ai.hpp"
+#include "event_loop.hpp"
+#include "hdr_histogram.hpp"
+#include "layout.hpp"
+#include "strategy.hpp"
+#include "wire.hpp"
+
+/**
+ * loadgen — drives a roulette_server with a crowd of simulated players.
+ *
+ *   loadgen [--players N] [--threads N] [--tables N] [--host H] [--port P]
+ *           [--unix PATH] [--sources K] [--ramp PER_SEC] [--duration S]
+ *           [--betting-ms MS] [--spin-ms MS] [--think-ms MS] [--late FRACTION]
+ *           [--balance B] [--strategy FILE]
+ *
+ * Every player is one binary-protocol connection, spread over the tables.
+ * A few threads each run an EventLoop over their share of the sockets, so
+ * 100k players need no more than a handful of cores on the client side.
+ * Players are driven by the AI class and by strategy scripts (flat red,
+ * martingale, dozens, long shots; or only --strategy FILE). When betting
+ * opens each one thinks for a lognormal while (median --think-ms) before
+ * placing its bet; the --late fraction bets in the last moments of the
+ * window, and whatever arrives after it closes counts as BETTING_CLOSED.
+ * A player that goes broke or whose strategy stops leaves and joins again.
+ *
+ * Every ACK and SETTLE is checked against the balance the player expects
+ * from its own bets and the RESULT, and the report counts disagreements.
+ * Latencies go into HDR histograms: placement is BET to ACK/ERR, settlement
+ * is SETTLE arrival less RESULT arrival less --spin-ms (so --betting-ms and
+ * --spin-ms must match the server's).
+ *
+ * One source address has about 28k ephemeral ports; for more TCP players
+ * use --sources K (connections bind 127.0.0.1..K round-robin) or --unix.
+ */
+
+using Clock = std::chrono::steady_clock;
+
+static volatile std::sig_atomic_t g_stop = 0;
+
+struct Options {
+    int players = 1000;
+    int threads = 0;                    // 0 = hardware_concurrency
+    int tables = 16;
+    std::string host = "127.0.0.1";
+    uint16_t port = 7777;
+    std::string unix_path;
+    int sources = 1;
+    double ramp = 5000.0;               // connections per second
+    int duration = 30;
+    std::chrono::milliseconds betting{15000};
+    std::chrono::milliseconds spin{4000};
+    double think_ms = 3000.0;
+    double late = 0.1;
+    double balance = 1000.0;
+    std::string strategy_path;
+};
+
+// ---------- Strategies ----------
+static const char* BUILTIN_STRATEGIES[] = {
+    "bet red 10\n",
+    "if loss_streak >= 6: stop\n"
+    "if lost: bet red stake * 2\n"
+    "bet red 10\n",
+    "if profit >= 300: stop\n"
+    "bet dozen 2 max(5, bankroll / 50)\n",
+    "if profit >= 500: stop\n"
+    "if rounds >= 100: stop\n"
+    "bet straight 17 5\n",
+};
+
+// Decisions carry a coverage mask, the wire wants a selection label.
+class LabelMap {
+public:
+    LabelMap() {
+        for (const Bet& b : legal_bets(Wheel::Type::American)) labels_.emplace(key(b.type, coverage_mask(b)), b.selection_label);
+    }
+    const std::string* find(const Decision& d) const {
+        auto it = labels_.find(key(d.type, d.mask));
+        return it == labels_.end() ? nullptr : &it->second;
+    }
+
+private:
+    static uint64_t key(Bet::Type t, uint64_t mask) { return mask | (uint64_t)t << 40; }
+    std::unordered_map<uint64_t, std::string> labels_;
+};
+
+// ---------- Stats ----------
+struct Stats {
+    uint64_t connects = 0, connect_errors = 0, disconnects = 0;
+    uint64_t joins = 0, sessions = 0;
+    uint64_t bets = 0, acks = 0, settles = 0, mismatches = 0;
+    std::map<std::string, uint64_t> errors;
+    HdrHistogram ack_ns, settle_ns;
+
+    void merge(const Stats& o) {
+        connects += o.connects; connect_errors += o.connect_errors; disconnects += o.disconnects;
+        joins += o.joins; sessions += o.sessions;
+        bets += o.bets; acks += o.acks; settles += o.settles; mismatches += o.mismatches;
+        for (const auto& [k, v] : o.errors) errors[k] += v;
+        ack_ns.merge(o.ack_ns);
+        settle_ns.merge(o.settle_ns);
+    }
+};
+
+// ---------- Bots ----------
+struct Bot {
+    enum class State : uint8_t { Idle, Connecting, Joining, Seated };
+
+    uint32_t id = 0;
+    uint32_t table = 0;
+    int fd = -1;
+    State state = State::Idle;
+    bool late = false;                  // bets at the end of the window
+    bool writing = false;               // poller watches for writable
+    bool leaving = false;               // session over once the round settles
+    std::optional<ScriptedStrategy> script;     // empty = AI
+
+    double balance = 0.0;               // what the server should report
+    uint64_t round = 0;
+    Decision bet;                       // this round's accepted bet, if any
+    Decision pending;                   // sent, not yet answered
+    bool in_flight = false;
+    Clock::time_point sent, result_at;
+    double due = 0.0;                   // payout the SETTLE should carry
+
+    std::string in, out;
+};
+
+class Swarm {
+public:
+    Swarm(const Options& opt, const LabelMap& labels, const std::vector<StrategyProgram>& programs, int index)
+    : opt_(opt), labels_(labels), programs_(programs), rng_(0x5EEDull * (index + 1)) {
+        loop_.on_io([this](const IoEvent& ev) { on_io(ev); });
+    }
+
+    void add(uint32_t id) {
+        Bot b;
+        b.id = id;
+        b.table = id % (uint32_t)opt_.tables;
+        const size_t kinds = programs_.size() + (opt_.strategy_path.empty() ? 1 : 0);
+        const size_t kind = id % kinds;
+        if (kind < programs_.size()) b.script.emplace(programs_[kind]);
+        b.late = std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < opt_.late;
+        bots_.push_back(std::move(b));
+    }
+
+    // Connects bot k at start + k / rate, so the server sees a ramp rather than a wall.
+    void run(Clock::time_point start, double rate) {
+        for (size_t k = 0; k < bots_.size(); ++k) {
+            const auto at = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(k / rate));
+            loop_.at(at, [this, k] { connect(k); });
+        }
+        loop_.run();
+        for (Bot& b : bots_) if (b.fd >= 0) ::close(b.fd);
+    }
+
+    void stop() { loop_.stop(); }
+    const Stats& stats() const { return stats_; }
+
+private:
+    // ---------- connection ----------
+    void connect(size_t k) {
+        Bot& b = bots_[k];
+        const bool unix_socket = !opt_.unix_path.empty();
+        b.fd = ::socket(unix_socket ? AF_UNIX : AF_INET, SOCK_STREAM, 0);
+        if (b.fd < 0) return retry(k, std::chrono::seconds(1));
+        ::fcntl(b.fd, F_SETFL, ::fcntl(b.fd, F_GETFL) | O_NONBLOCK);
+
+        int rc;
+        if (unix_socket) {
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, opt_.unix_path.c_str(), sizeof addr.sun_path - 1);
+            rc = ::connect(b.fd, (sockaddr*)&addr, sizeof addr);
+        } else {
+            int one = 1;
+            ::setsockopt(b.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+            if (opt_.sources > 1) {
+                sockaddr_in src{};
+                src.sin_family = AF_INET;
+                src.sin_addr.s_addr = htonl(INADDR_LOOPBACK + b.id % (uint32_t)opt_.sources);
+                ::bind(b.fd, (sockaddr*)&src, sizeof src);
+            }
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(opt_.port);
+            ::inet_pton(AF_INET, opt_.host.c_str(), &addr.sin_addr);
+            rc = ::connect(b.fd, (sockaddr*)&addr, sizeof addr);
+        }
+        if (rc != 0 && errno != EINPROGRESS) {
+            // a full Unix listen backlog says EAGAIN: back off briefly
+            ++stats_.connect_errors;
+            const bool busy = errno == EAGAIN;
+            ::close(b.fd);
+            b.fd = -1;
+            return retry(k, busy ? std::chrono::milliseconds(20) : std::chrono::milliseconds(1000));
+        }
+        b.state = Bot::State::Connecting;
+        b.writing = true;
+        loop_.poller().add(b.fd, k + 1, true);
+    }
+
+    void retry(size_t k, Clock::duration after) {
+        loop_.at(Clock::now() + after, [this, k] { connect(k); });
+    }
+
+    void drop(size_t k) {
+        Bot& b = bots_[k];
+        loop_.poller().remove(b.fd);
+        ::close(b.fd);
+        b.fd = -1;
+        b.state = Bot::State::Idle;
+        b.writing = b.leaving = b.in_flight = false;
+        b.bet = b.pending = Decision::skip();
+        b.in.clear();
+        b.out.clear();
+        ++stats_.disconnects;
+        retry(k, std::chrono::seconds(1));
+    }
+
+    void on_io(const IoEvent& ev) {
+        const size_t k = ev.tag - 1;
+        Bot& b = bots_[k];
+        if (b.fd < 0) return;
+        if (b.state == Bot::State::Connecting) {
+            if (!ev.writable && !ev.closed) return;
+            int err = 0;
+            socklen_t len = sizeof err;
+            ::getsockopt(b.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err != 0) {
+                ++stats_.connect_errors;
+                loop_.poller().remove(b.fd);
+                ::close(b.fd);
+                b.fd = -1;
+                b.state = Bot::State::Idle;
+                return retry(k, std::chrono::seconds(1));
+            }
+            ++stats_.connects;
+            join(k);
+            if (!flush(k)) drop(k);
+            return;
+        }
+        if (ev.readable || ev.closed) {
+            char buf[4096];
+            for (;;) {
+                const ssize_t n = ::read(b.fd, buf, sizeof buf);
+                if (n > 0) { b.in.append(buf, (size_t)n); continue; }
+                if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) return drop(k);
+                break;
+            }
+            if (!handle_frames(k)) return drop(k);
+        }
+        if (!flush(k)) drop(k);
+    }
+
+    // Queues a frame; it goes out with the next flush.
+    template <class M>
+    void send(size_t k, const M& m) {
+        wire::encode(m, bots_[k].out);
+    }
+
+    // false = the connection is gone
+    bool flush(size_t k) {
+        Bot& b = bots_[k];
+        while (!b.out.empty()) {
+            const ssize_t n = ::write(b.fd, b.out.data(), b.out.size());
+            if (n > 0) { b.out.erase(0, (size_t)n); continue; }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            return false;
+        }
+        const bool want = !b.out.empty();
+        if (want != b.writing) {
+            loop_.poller().modify(b.fd, k + 1, want);
+            b.writing = want;
+        }
+        return true;
+    }
+
+    // For timer callbacks; I/O handlers flush once on the way out.
+    void send_now(size_t k) {
+        if (!flush(k)) drop(k);
+    }
+
+    // ---------- sessions ----------
+    void join(size_t k) {
+        Bot& b = bots_[k];
+        wire::Join m{};
+        m.table = b.table;
+        m.balance = opt_.balance;
+        wire::set_str(m.name, "bot" + std::to_string(b.id));
+        send(k, m);
+        b.state = Bot::State::Joining;
+        b.leaving = false;
+        b.bet = b.pending = Decision::skip();
+        b.in_flight = false;
+    }
+
+    // Leaves once nothing is riding on the table, then takes a fresh seat.
+    void end_session(size_t k) {
+        Bot& b = bots_[k];
+        b.leaving = true;
+        if (b.in_flight || b.bet.kind == Decision::Kind::Bet) return;
+        send(k, wire::Leave{});
+        ++stats_.sessions;
+        join(k);
+    }
+
+    // ---------- betting ----------
+    void schedule_bet(size_t k) {
+        Bot& b = bots_[k];
+        double ms;
+        if (b.late) {
+            ms = (double)opt_.betting.count() - std::uniform_real_distribution<double>(-50.0, 300.0)(rng_);
+        } else {
+            std::lognormal_distribution<double> think(std::log(opt_.think_ms), 0.6);
+            ms = think(rng_);
+        }
+        const auto when = Clock::now() + std::chrono::microseconds((int64_t)(ms * 1000.0));
+        loop_.at(when, [this, k, round = b.round] { place(k, round); });
+    }
+
+    void place(size_t k, uint64_t round) {
+        Bot& b = bots_[k];
+        if (b.state != Bot::State::Seated || b.round != round || b.leaving || b.in_flight) return;
+
+        static AI ai;
+        const Decision d = b.script ? b.script->decide(b.balance)
+                                    : Decision::place(ai.decide_bet(Player("", b.balance)));
+        if (d.kind == Decision::Kind::Stop) { end_session(k); return send_now(k); }
+        if (d.kind != Decision::Kind::Bet) return;
+        const std::string* label = labels_.find(d);
+        if (!label) return;
+        if (!(d.amount > 0.0 && d.amount <= b.balance)) { end_session(k); return send_now(k); }  // busted, or NaN
+
+        wire::PlaceBet m{};
+        m.amount = d.amount;
+        m.bet_type = (uint8_t)d.type;
+        wire::set_str(m.selection, *label);
+        send(k, m);
+        b.pending = d;
+        b.in_flight = true;
+        b.sent = Clock::now();
+        ++stats_.bets;
+        send_now(k);
+    }
+
+    void mismatch(Bot& b, const char* what, double want, double got) {
+        if (++stats_.mismatches <= 10)
+            std::fprintf(stderr, "bot%u table %u round %llu: %s expected %.2f, server says %.2f\n", b.id, b.table,
+                         (unsigned long long)b.round, what, want, got);
+    }
+
+    static bool differs(double a, double b) { return std::fabs(a - b) > 1e-6 * std::max(1.0, std::fabs(a)); }
+
+    // ---------- messages ----------
+    bool handle_frames(size_t k) {
+        Bot& b = bots_[k];
+        size_t start = 0;
+        wire::Frame f;
+        for (;;) {
+            const wire::Status st = wire::decode_frame(b.in.data() + start, b.in.size() - start, f);
+            if (st == wire::Status::NeedMore) break;
+            if (st != wire::Status::Ok) {
+                ++stats_.errors[std::string("frame ") + wire::status_name(st)];
+                return false;
+            }
+            handle_frame(k, f);
+            start += f.size();
+        }
+        b.in.erase(0, start);
+        return true;
+    }
+
+    void handle_frame(size_t k, const wire::Frame& f) {
+        Bot& b = bots_[k];
+        const Clock::time_point now = Clock::now();
+        switch (f.type) {
+            case wire::Type::Joined: {
+                const wire::Joined m = f.as<wire::Joined>();
+                b.state = Bot::State::Seated;
+                b.balance = m.balance;
+                if (b.script) b.script->reset(m.balance);
+                ++stats_.joins;
+                break;
+            }
+            case wire::Type::Phase: {
+                const wire::Phase m = f.as<wire::Phase>();
+                if (m.phase != (uint8_t)Table::Phase::BettingOpen || b.state != Bot::State::Seated) break;
+                b.round = m.round;
+                b.bet = Decision::skip();
+                b.due = 0.0;
+                schedule_bet(k);
+                break;
+            }
+            case wire::Type::BetAck: {
+                const wire::BetAck m = f.as<wire::BetAck>();
+                if (!b.in_flight) break;
+                stats_.ack_ns.record((uint64_t)std::chrono::nanoseconds(now - b.sent).count());
+                b.in_flight = false;
+                ++stats_.acks;
+                b.balance -= b.pending.amount;
+                if (differs(b.balance, m.balance)) {
+                    mismatch(b, "balance after bet", b.balance, m.balance);
+                    b.balance = m.balance;
+                }
+                b.bet = b.pending;
+                break;
+            }
+            case wire::Type::Error: {
+                const std::string reason(wire::get_str(f.as<wire::Error>().reason));
+                ++stats_.errors[reason];
+                if (b.in_flight) {
+                    stats_.ack_ns.record((uint64_t)std::chrono::nanoseconds(now - b.sent).count());
+                    b.in_flight = false;
+                    if (b.leaving) end_session(k);
+                } else if (b.state == Bot::State::Joining) {
+                    loop_.at(now + std::chrono::seconds(1), [this, k] {
+                        if (bots_[k].state != Bot::State::Joining) return;
+                        join(k);
+                        send_now(k);
+                    });
+                }
+                break;
+            }
+            case wire::Type::Result: {
+                const wire::Result m = f.as<wire::Result>();
+                if (b.state != Bot::State::Seated || m.round != b.round) break;
+                const bool placed = b.bet.kind == Decision::Kind::Bet;
+                const bool won = placed && ((b.bet.mask >> m.index) & 1);
+                b.due = won ? b.bet.amount * (b.bet.odds + 1.0) : 0.0;
+                b.result_at = now;
+                if (b.script) b.script->observe(m.index, b.bet, won);
+                if (!placed && b.leaving) end_session(k);
+                break;
+            }
+            case wire::Type::Settle: {
+                const wire::Settle m = f.as<wire::Settle>();
+                if (b.bet.kind != Decision::Kind::Bet) break;
+                ++stats_.settles;
+                const auto late_by = now - b.result_at - opt_.spin;
+                stats_.settle_ns.record((uint64_t)std::max<int64_t>(0, std::chrono::nanoseconds(late_by).count()));
+                if (differs(b.bet.amount, m.staked)) mismatch(b, "staked", b.bet.amount, m.staked);
+                if (differs(b.due, m.paid)) mismatch(b, "paid", b.due, m.paid);
+                b.balance += b.due;
+                if (differs(b.balance, m.balance)) {
+                    mismatch(b, "balance after settle", b.balance, m.balance);
+                    b.balance = m.balance;
+                }
+                b.bet = Decision::skip();
+                if (b.leaving) end_session(k);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    const Options& opt_;
+    const LabelMap& labels_;
+    const std::vector<StrategyProgram>& programs_;
+    std::mt19937_64 rng_;
+    EventLoop loop_;
+    std::vector<Bot> bots_;
+    Stats stats_;
+};
+
+// ---------- Report ----------
+static void print_latency(const char* name, const HdrHistogram& h) {
+    auto ms = [&](double p) { return h.percentile(p) / 1e6; };
+    std::printf("%-10s n %llu  p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f ms\n", name,
+                (unsigned long long)h.count(), ms(50), ms(90), ms(99), ms(99.9), h.max() / 1e6);
+}
+
+static void raise_fd_limit() {
+    rlimit rl{};
+    if (::getrlimit(RLIMIT_NOFILE, &rl) != 0) return;
+    rl.rlim_cur = rl.rlim_max;
+#if defined(__APPLE__)
+    rl.rlim_cur = std::min<rlim_t>(rl.rlim_cur, OPEN_MAX);
+#endif
+    ::setrlimit(RLIMIT_NOFILE, &rl);
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { std::cerr << "missing value for " << a << "\n"; std::exit(2); }
+            return argv[++i];
+        };
+        if (a == "--players")         opt.players = std::atoi(next());
+        else if (a == "--threads")    opt.threads = std::atoi(next());
+        else if (a == "--tables")     opt.tables = std::max(1, std::atoi(next()));
+        else if (a == "--host")       opt.host = next();
+        else if (a == "--port")       opt.port = (uint16_t)std::atoi(next());
+        else if (a == "--unix")       opt.unix_path = next();
+        else if (a == "--sources")    opt.sources = std::clamp(std::atoi(next()), 1, 254);
+        else if (a == "--ramp")       opt.ramp = std::max(1.0, std::atof(next()));
+        else if (a == "--duration")   opt.duration = std::atoi(next());
+        else if (a == "--betting-ms") opt.betting = std::chrono::milliseconds(std::atoi(next()));
+        else if (a == "--spin-ms")    opt.spin = std::chrono::milliseconds(std::atoi(next()));
+        else if (a == "--think-ms")   opt.think_ms = std::max(1.0, std::atof(next()));
+        else if (a == "--late")       opt.late = std::atof(next());
+        else if (a == "--balance")    opt.balance = std::atof(next());
+        else if (a == "--strategy")   opt.strategy_path = next();
+        else { std::cerr << "unknown option " << a << "\n"; return 2; }
+    }
+
+    std::vector<StrategyProgram> programs;
+    try {
+        if (!opt.strategy_path.empty()) {
+            std::ifstream in(opt.strategy_path);
+            if (!in) { std::cerr << "cannot read " << opt.strategy_path << "\n"; return 1; }
+            std::stringstream ss;
+            ss << in.rdbuf();
+            programs.emplace_back(ss.str());
+        } else {
+            for (const char* src : BUILTIN_STRATEGIES) programs.emplace_back(src);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "strategy: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::signal(SIGINT,  [](int) { g_stop = 1; });
+    std::signal(SIGPIPE, SIG_IGN);
+    raise_fd_limit();
+
+    const int threads = opt.threads > 0 ? opt.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+    const LabelMap labels;
+    std::vector<std::unique_ptr<Swarm>> swarms;
+    for (int t = 0; t < threads; ++t) swarms.push_back(std::make_unique<Swarm>(opt, labels, programs, t));
+    for (int i = 0; i < opt.players; ++i) swarms[i % threads]->add((uint32_t)i);
+
+    const auto start = Clock::now();
+    std::vector<std::thread> workers;
+    for (auto& s : swarms) workers.emplace_back([&s, start, rate = opt.ramp / threads] { s->run(start, rate); });
+
+    while (!g_stop && Clock::now() - start < std::chrono::seconds(opt.duration))
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    for (auto& s : swarms) s->stop();
+    for (std::thread& w : workers) w.join();
+    const double secs = std::chrono::duration<double>(Clock::now() - start).count();
+
+    Stats total;
+    for (auto& s : swarms) total.merge(s->stats());
+    std::printf("%d players on %d threads, %.1f s\n", opt.players, threads, secs);
+    std::printf("connects %llu (errors %llu, dropped %llu), joins %llu, sessions ended %llu\n",
+                (unsigned long long)total.connects, (unsigned long long)total.connect_errors,
+                (unsigned long long)total.disconnects, (unsigned long long)total.joins,
+                (unsigned long long)total.sessions);
+    std::printf("bets %llu, acked %llu (%.0f/s), settled %llu, balance mismatches %llu\n",
+                (unsigned long long)total.bets, (unsigned long long)total.acks, total.acks / secs,
+                (unsigned long long)total.settles, (unsigned long long)total.mismatches);
+    for (const auto& [reason, n] : total.errors) std::printf("  ERR %s: %llu\n", reason.c_str(), (unsigned long long)n);
+    print_latency("placement", total.ack_ns);
+    print_latency("settlement", total.settle_ns);
+    return total.mismatches ? 1 : 0;
+}
@@ -20,6 +20,7 @@
 
 #define STB_EASY_FONT_IMPLEMENTATION
 #include "stb_easy_font.h"
+#include "trace.hpp"
 
 struct EasyV { float x, y, z; unsigned char color[4]; };
 
@@ -420,9 +421,13 @@ int main() {
     BuildTextMesh(labels, rIn, rOut);
 
     bool tPrev = false;
+    bool pPrev = false;     // P toggles tracing; turning it off writes roulette_gl_trace.json
 
 
+    Trace::name_thread("render");
     while (!glfwWindowShouldClose(window)) {
+        TraceSpan frameSpan("frame");
+        TraceSpan uiSpan("ui");
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -498,6 +503,16 @@ int main() {
         }
         tPrev = tNow;
 
+        bool pNow = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+        if (pNow && !pPrev) {
+            Trace::enable(!Trace::enabled());
+            if (!Trace::enabled() && Trace::dump("roulette_gl_trace.json"))
+                std::cout << "trace written to roulette_gl_trace.json\n";
+        }
+        pPrev = pNow;
+        uiSpan.end();
+
+        TraceSpan drawSpan("draw");
         glClearColor(0.07f, 0.13f, 0.17f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
@@ -510,9 +525,12 @@ int main() {
         glUniform1f(glGetUniformLocation(wheelShader.ID, "uAngle"), gAngle);
         DrawWheelRing();
         DrawText();
+        drawSpan.end();
 
         glfwPollEvents();
 
+        TraceSpan physicsSpan("physics");
+
         double now = glfwGetTime();
         if (gLastT == 0.0) gLastT = now;
         double dt = now - gLastT;
@@ -596,7 +614,9 @@ int main() {
 
         glUniform1f(glGetUniformLocation(wheelShader.ID, "uAngle"), 0.0f);
         DrawBall();
+        physicsSpan.end();
 
+        TraceSpan presentSpan("present");
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "optimizer.hpp"
+
+/**
+ * optimizer — searches betting-progression parameters by simulation.
+ *
+ *   optimizer [--american] [--bankroll B] [--sessions N] [--rounds N]
+ *             [--population N] [--generations N] [--patience N]
+ *             [--threads N] [--seed S]
+ *
+ * Runs the genetic search in optimizer.hpp for the progression that most
+ * often leaves the table ahead, and prints the best parameters with their
+ * score. The score depends only on the seed and the parameters, not on
+ * --threads.
+ */
+
+int main(int argc, char** argv) {
+    OptimizerConfig cfg;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { std::cerr << "missing value for " << a << "\n"; std::exit(2); }
+            return argv[++i];
+        };
+        if (a == "--american")         cfg.wheel = Wheel::Type::American;
+        else if (a == "--bankroll")    cfg.bankroll = std::atof(next());
+        else if (a == "--sessions")    cfg.sessions = std::max(1, std::atoi(next()));
+        else if (a == "--rounds")      cfg.max_rounds = std::max(1, std::atoi(next()));
+        else if (a == "--population")  cfg.population = std::max(2, std::atoi(next()));
+        else if (a == "--generations") cfg.generations = std::max(1, std::atoi(next()));
+        else if (a == "--patience")    cfg.patience = std::max(1, std::atoi(next()));
+        else if (a == "--threads")     cfg.threads = std::atoi(next());
+        else if (a == "--seed")        cfg.seed = std::strtoull(next(), nullptr, 10);
+        else { std::cerr << "unknown option " << a << "\n"; return 2; }
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    StrategyOptimizer opt(cfg);
+    const OptimizerResult r = opt.run();
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::printf("%d generations, %zu parameter sets simulated (%zu cache hits) in %.1f s\n", r.generations,
+                r.evaluations, r.cache_hits, secs);
+    std::printf("best: base unit %.0f, cap %.0f, stop-loss %.0f, target %.0f\n", r.best.base_unit, r.best.cap,
+                r.best.stop_loss, r.best.target);
+    std::printf("leaves ahead in %.3f%% of %d sessions of up to %d spins from %.0f\n", 100.0 * r.fitness,
+                cfg.sessions, cfg.max_rounds, cfg.bankroll);
+}
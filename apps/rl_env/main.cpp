@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "rl_env.hpp"
+
+/**
+ * rl_env — steps the batched RL environment under a random policy.
+ *
+ *   rl_env [--american] [--envs N] [--shard N] [--steps N] [--max-steps N]
+ *          [--bankroll B] [--threads N] [--seed S]
+ *
+ * Every thread steps its own shards (VecEnv::step_shard) with uniformly
+ * random actions, which is how a learner's pool would split a batch.
+ * Prints the throughput and the episodes finished, with their mean return
+ * and how many ended broke. A baseline for comparing learned policies, and
+ * a check that the environment runs.
+ */
+
+int main(int argc, char** argv) {
+    VecEnvConfig cfg;
+    int steps = 1000;
+    int threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { std::cerr << "missing value for " << a << "\n"; std::exit(2); }
+            return argv[++i];
+        };
+        if (a == "--american")        cfg.wheel = Wheel::Type::American;
+        else if (a == "--envs")       cfg.num_envs = std::max(1, std::atoi(next()));
+        else if (a == "--shard")      cfg.shard_size = std::max(1, std::atoi(next()));
+        else if (a == "--steps")      steps = std::max(1, std::atoi(next()));
+        else if (a == "--max-steps")  cfg.max_steps = std::max(1, std::atoi(next()));
+        else if (a == "--bankroll")   cfg.bankroll = std::atof(next());
+        else if (a == "--threads")    threads = std::atoi(next());
+        else if (a == "--seed")       cfg.seed = std::strtoull(next(), nullptr, 10);
+        else { std::cerr << "unknown option " << a << "\n"; return 2; }
+    }
+
+    VecEnv env(cfg);
+    if (threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, env.num_shards());
+
+    struct Tally {
+        uint64_t episodes = 0;
+        uint64_t broke = 0;
+        double returns = 0.0;
+    };
+    std::vector<Tally> tally(threads);
+    std::vector<int32_t> actions(env.num_envs());
+    std::vector<double> episode_return(env.num_envs(), 0.0);
+    const double min_stake = *std::min_element(cfg.stakes.begin(), cfg.stakes.end());
+
+    auto worker = [&](int t) {
+        std::mt19937_64 rng(cfg.seed ^ (0xD1B54A32D192ED03ull * (t + 1)));
+        std::uniform_int_distribution<int32_t> pick(0, env.num_actions() - 1);
+        for (int k = 0; k < steps; ++k) {
+            for (int s = t; s < env.num_shards(); s += threads) {
+                const int lo = s * cfg.shard_size;
+                const int hi = std::min(env.num_envs(), lo + cfg.shard_size);
+                for (int i = lo; i < hi; ++i) actions[i] = pick(rng);
+                env.step_shard(s, actions.data());
+                for (int i = lo; i < hi; ++i) {
+                    episode_return[i] += env.rewards()[i];
+                    if (!env.dones()[i]) continue;
+                    ++tally[t].episodes;
+                    tally[t].returns += episode_return[i];
+                    if (cfg.bankroll + episode_return[i] < min_stake) ++tally[t].broke;
+                    episode_return[i] = 0.0;
+                }
+            }
+        }
+    };
+
+    const auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(worker, t);
+    worker(0);
+    for (auto& th : pool) th.join();
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    Tally all;
+    for (const Tally& t : tally) {
+        all.episodes += t.episodes;
+        all.broke += t.broke;
+        all.returns += t.returns;
+    }
+    const double env_steps = (double)env.num_envs() * steps;
+    std::printf("%d envs in %d shards on %d threads, %d steps: %.0f env steps in %.2f s (%.1f M/s)\n",
+                env.num_envs(), env.num_shards(), threads, steps, env_steps, secs, env_steps / secs * 1e-6);
+    std::printf("%d actions, observation %d floats\n", env.num_actions(), (int)VecEnv::OBS_DIM);
+    std::printf("random policy: %llu episodes, mean return %.2f, %.1f%% broke\n",
+                (unsigned long long)all.episodes, all.episodes ? all.returns / all.episodes : 0.0,
+                all.episodes ? 100.0 * all.broke / all.episodes : 0.0);
+}
@@ -0,0 +1,120 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include "server.hpp"
+
+/**
+ * roulette_server — hosts many tables over TCP and/or a Unix socket.
+ *
+ *   roulette_server [--tables N] [--threads N] [--port P] [--unix PATH]
+ *                   [--american | --wheel NAME] [--betting-ms MS] [--spin-ms MS] [--seed S]
+ *                   [--exposure-cap AMOUNT] [--ledger PATH]
+ *                   [--snapshot PATH] [--snapshot-every SECONDS] [--audit PATH]
+ *                   [--fair ROUNDS] [--bus NAME]
+ *                   [--metrics-port P] [--metrics-file PATH] [--metrics-every SECONDS]
+ *                   [--trace PATH] [--trace-on] [--spin-ahead N]
+ *                   [--secure] [--secure-reseed WORDS]
+ *
+ * --wheel picks the tables' wheel by its registry name (wheel_geometry.hpp):
+ * european (the default), american or triple-zero.
+ *
+ * With --trace, SIGUSR1 turns span tracing on and, sent again, off, writing
+ * the spans to PATH as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+ * --trace-on starts with tracing on; whatever is traced is also written on exit.
+ *
+ * Try it with:  nc 127.0.0.1 7777
+ *               JOIN 0 alice 1000
+ *               BET red - 10
+ */
+
+static std::atomic<bool> g_stop{false};
+static std::atomic<bool> g_trace_toggle{false};
+
+int main(int argc, char** argv) {
+    ServerConfig cfg;
+    std::string trace_path;
+    bool trace_on = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { std::cerr << "missing value for " << a << "\n"; std::exit(2); }
+            return argv[++i];
+        };
+        if (a == "--tables")          cfg.tables = std::atoi(next());
+        else if (a == "--threads")    cfg.threads = std::atoi(next());
+        else if (a == "--port")       cfg.port = (uint16_t)std::atoi(next());
+        else if (a == "--unix")       cfg.unix_path = next();
+        else if (a == "--american")   cfg.wheel = Wheel::Type::American;
+        else if (a == "--wheel") {
+            const WheelGeometryInfo* w = WheelRegistry::global().find(next());
+            if (!w || !w->table_type) {
+                std::cerr << "no table wheel named " << argv[i] << "; one of:";
+                for (std::string_view n : WheelRegistry::global().names())
+                    if (WheelRegistry::global().get(n).table_type) std::cerr << " " << n;
+                std::cerr << "\n";
+                return 2;
+            }
+            cfg.wheel = *w->table_type;
+        }
+        else if (a == "--betting-ms") cfg.timing.betting = std::chrono::milliseconds(std::atoi(next()));
+        else if (a == "--spin-ms")    cfg.timing.spin = std::chrono::milliseconds(std::atoi(next()));
+        else if (a == "--seed")       cfg.seed = std::strtoull(next(), nullptr, 10);
+        else if (a == "--exposure-cap") cfg.exposure_cap = std::atof(next());
+        else if (a == "--ledger")     cfg.ledger_path = next();
+        else if (a == "--snapshot")   cfg.snapshot_path = next();
+        else if (a == "--snapshot-every") cfg.snapshot_every = std::chrono::seconds(std::atoi(next()));
+        else if (a == "--audit")      cfg.audit_path = next();
+        else if (a == "--fair")       cfg.fair_rounds = std::strtoull(next(), nullptr, 10);
+        else if (a == "--bus")        cfg.bus_name = next();
+        else if (a == "--metrics-port") cfg.metrics_port = (uint16_t)std::atoi(next());
+        else if (a == "--metrics-file") cfg.metrics_path = next();
+        else if (a == "--spin-ahead") cfg.spin_ahead = (uint32_t)std::atoi(next());
+        else if (a == "--secure")     cfg.secure_rng = true;
+        else if (a == "--secure-reseed") cfg.secure_reseed_every = std::strtoull(next(), nullptr, 10);
+        else if (a == "--trace")      trace_path = next();
+        else if (a == "--trace-on")   trace_on = true;
+        else if (a == "--metrics-every") cfg.metrics_every = std::chrono::seconds(std::max(1, std::atoi(next())));
+        else { std::cerr << "unknown option " << a << "\n"; return 2; }
+    }
+
+    std::signal(SIGINT,  [](int) { g_stop = true; });
+    std::signal(SIGTERM, [](int) { g_stop = true; });
+    std::signal(SIGPIPE, SIG_IGN);
+    if (!trace_path.empty()) std::signal(SIGUSR1, [](int) { g_trace_toggle = true; });
+    Trace::enable(trace_on);
+
+    std::unique_ptr<TableServer> server;
+    try {
+        server = std::make_unique<TableServer>(cfg);
+        server->start();
+    } catch (const std::exception& e) {
+        std::cerr << "server: " << e.what() << "\n";
+        return 1;
+    }
+    std::cout << "serving " << server->tables() << " tables";
+    if (cfg.port) std::cout << " on " << cfg.host << ":" << server->port();
+    if (!cfg.unix_path.empty()) std::cout << " and " << cfg.unix_path;
+    if (server->metrics_port()) std::cout << ", metrics on 127.0.0.1:" << server->metrics_port() << "/metrics";
+    std::cout << std::endl;
+
+    while (!g_stop) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (!g_trace_toggle.exchange(false)) continue;
+        if (!Trace::enabled()) {
+            Trace::enable(true);
+            std::cout << "tracing on" << std::endl;
+        } else {
+            Trace::enable(false);
+            if (Trace::dump(trace_path)) std::cout << "trace written to " << trace_path << std::endl;
+            else std::cerr << "cannot write " << trace_path << "\n";
+        }
+    }
+    server->stop();
+    if (Trace::enabled() && !trace_path.empty()) Trace::dump(trace_path);
+}
@@ -0,0 +1,66 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "solver.hpp"
+
+/**
+ * solver — the bold-play policy for reaching a target bankroll.
+ *
+ *   solver [--american] [--bankroll B] [--target T] [--min M] [--max M]
+ *          [--unit U] [--threads N] [--tolerance E] [--points N]
+ *
+ * Solves the grid (see solver.hpp), then prints the chance of reaching the
+ * target from the starting bankroll and the optimal bet at N bankrolls
+ * spread evenly up to the target.
+ */
+
+int main(int argc, char** argv) {
+    SolverConfig cfg;
+    int points = 10;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { std::cerr << "missing value for " << a << "\n"; std::exit(2); }
+            return argv[++i];
+        };
+        if (a == "--american")        cfg.wheel = Wheel::Type::American;
+        else if (a == "--bankroll")   cfg.bankroll = std::atof(next());
+        else if (a == "--target")     cfg.target = std::atof(next());
+        else if (a == "--min")        cfg.table_min = std::atof(next());
+        else if (a == "--max")        cfg.table_max = std::atof(next());
+        else if (a == "--unit")       cfg.unit = std::atof(next());
+        else if (a == "--threads")    cfg.threads = std::atoi(next());
+        else if (a == "--tolerance")  cfg.tolerance = std::atof(next());
+        else if (a == "--points")     points = std::max(1, std::atoi(next()));
+        else { std::cerr << "unknown option " << a << "\n"; return 2; }
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    try {
+        BoldPlaySolver solver(cfg);
+        solver.solve();
+        const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        std::printf("%s wheel, %d states, %d sweeps in %.2f s\n",
+                    cfg.wheel == Wheel::Type::American ? "american" : "european", solver.states(), solver.sweeps(),
+                    secs);
+        const Bet first = solver.best_bet();
+        std::printf("P(reach %.2f from %.2f) = %.6f, first bet %s %.2f\n", cfg.target, cfg.bankroll,
+                    solver.win_probability(), bet_type_to_string(first.type).c_str(), first.amount);
+
+        std::printf("\n  bankroll   P(reach)  bet\n");
+        for (int k = 1; k <= points; ++k) {
+            const double b = cfg.target * k / (points + 1);
+            const Bet bet = solver.best_bet(b);
+            std::printf("%10.2f  %9.6f  ", b, solver.win_probability(b));
+            if (bet.amount > 0.0) std::printf("%s %.2f\n", bet_type_to_string(bet.type).c_str(), bet.amount);
+            else std::printf("-\n");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "solver: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,203 @@
+// agents.hpp
+#pragma once
+#include <coroutine>
+#include <cstdint>
+#include <mutex>
+#include "executor.hpp"
+#include "roulette.hpp"
+#include "session.hpp"
+
+/**
+ * Coroutine player agents for large behavioural simulations.
+ *
+ * A player session is a coroutine returning Task, written top to bottom:
+ *
+ *     Task player(SimTable& table, double bankroll) {
+ *         Seat seat(table, bankroll);
+ *         while (seat.bankroll() >= 10.0) {
+ *             co_await seat.place(Decision::place(Bet(Bet::Type::Red, "", 10.0)));
+ *             RoundOutcome r = co_await seat.next_round();
+ *         }
+ *     }                                   // ~Seat leaves the table
+ *
+ * A SimTable spins once every seated session has reached next_round(),
+ * after it has been opened: spawn the sessions, let them sit, then open()
+ * the table, or the first session to arrive would spin for itself alone. The
+ * last one to arrive spins, settles every waiting seat from its decision's
+ * coverage mask, hands the others back to the executor and carries on
+ * without suspending. Waiting seats form an intrusive list through the
+ * Seat objects in the sessions' own frames, so a round allocates nothing.
+ *
+ * place() settles synchronously at a SimTable (it debits the stake and
+ * never suspends); it is awaitable so that a table behind a network hop
+ * can be dropped in without touching session code.
+ */
+
+struct RoundOutcome {
+    uint64_t round = 0;
+    int index = -1;             // table index that hit
+    double staked = 0.0;
+    double paid = 0.0;          // stake included, as the table pays it
+};
+
+class Seat;
+
+class SimTable {
+public:
+    SimTable(Executor& exec, Wheel::Type type, uint64_t seed) : exec_(exec), wheel_(type, seed) {}
+
+    SimTable(const SimTable&) = delete;
+    SimTable& operator=(const SimTable&) = delete;
+
+    // Starts spinning: from now on the last arrival spins the wheel.
+    void open() {
+        Seat* ready;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            open_ = true;
+            if (!waiting_ || arrived_ < seated_) return;
+            ready = spin();
+        }
+        resume_all(ready, nullptr);
+    }
+
+    // Totals so far; exact once the sessions are done.
+    uint64_t rounds() const { std::lock_guard<std::mutex> lk(mu_); return round_; }
+    uint64_t joined() const { std::lock_guard<std::mutex> lk(mu_); return joined_; }
+    double staked() const { std::lock_guard<std::mutex> lk(mu_); return staked_; }
+    double paid() const { std::lock_guard<std::mutex> lk(mu_); return paid_; }
+    uint32_t seated() const { std::lock_guard<std::mutex> lk(mu_); return seated_; }
+
+private:
+    friend class Seat;
+
+    void sit() {
+        std::lock_guard<std::mutex> lk(mu_);
+        ++seated_;
+        ++joined_;
+    }
+
+    void stand() {
+        Seat* ready;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            --seated_;
+            if (!open_ || !waiting_ || arrived_ < seated_) return;
+            ready = spin();
+        }
+        resume_all(ready, nullptr);
+    }
+
+    // true = `s` was the last to arrive and its round is already settled.
+    bool arrive(Seat* s);
+
+    // Spins and settles everyone waiting; returns the list. Lock held.
+    Seat* spin();
+    void resume_all(Seat* list, const Seat* except);
+
+    Executor& exec_;
+    mutable std::mutex mu_;
+    Wheel wheel_;
+    Seat* waiting_ = nullptr;
+    bool open_ = false;
+    uint32_t seated_ = 0;
+    uint32_t arrived_ = 0;
+    uint64_t joined_ = 0;               // sit() calls ever
+    uint64_t round_ = 0;
+    double staked_ = 0.0;
+    double paid_ = 0.0;
+};
+
+// A session's place at a table; lives in the session's coroutine frame.
+class Seat {
+public:
+    Seat(SimTable& table, double bankroll) : table_(table), bankroll_(bankroll) { table_.sit(); }
+    ~Seat() { table_.stand(); }
+
+    Seat(const Seat&) = delete;
+    Seat& operator=(const Seat&) = delete;
+
+    double bankroll() const { return bankroll_; }
+
+    // Resolves to false (and leaves the bankroll alone) for a bet that
+    // can't be covered, or a second bet in the same round.
+    struct PlaceAwaiter {
+        bool accepted;
+        bool await_ready() const noexcept { return true; }
+        void await_suspend(std::coroutine_handle<>) const noexcept {}
+        bool await_resume() const noexcept { return accepted; }
+    };
+    PlaceAwaiter place(const Decision& d) {
+        if (d.kind != Decision::Kind::Bet || pending_.kind == Decision::Kind::Bet ||
+            !(d.amount > 0.0 && d.amount <= bankroll_))      // NaN too
+            return { false };
+        bankroll_ -= d.amount;
+        pending_ = d;
+        return { true };
+    }
+
+    // Suspends until the table spins; resolves to this seat's outcome.
+    struct RoundAwaiter {
+        Seat& seat;
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) {
+            seat.waiter_ = h;
+            return !seat.table_.arrive(&seat);
+        }
+        RoundOutcome await_resume() const noexcept { return seat.outcome_; }
+    };
+    RoundAwaiter next_round() { return { *this }; }
+
+private:
+    friend class SimTable;
+
+    SimTable& table_;
+    double bankroll_;
+    Decision pending_;
+    RoundOutcome outcome_;
+    std::coroutine_handle<> waiter_;
+    Seat* next_ = nullptr;
+};
+
+inline bool SimTable::arrive(Seat* s) {
+    Seat* ready;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        s->next_ = waiting_;
+        waiting_ = s;
+        if (++arrived_ < seated_ || !open_) return false;   // `s` may be resumed by someone else from here on
+        ready = spin();
+    }
+    resume_all(ready, s);
+    return true;
+}
+
+inline Seat* SimTable::spin() {
+    const int idx = wheel_.spin_index();
+    ++round_;
+    for (Seat* s = waiting_; s; s = s->next_) {
+        const Decision& d = s->pending_;
+        RoundOutcome& o = s->outcome_;
+        o = RoundOutcome{ round_, idx, 0.0, 0.0 };
+        if (d.kind == Decision::Kind::Bet) {
+            o.staked = d.amount;
+            if ((d.mask >> idx) & 1) o.paid = d.amount * (d.odds + 1.0);
+            s->bankroll_ += o.paid;
+            staked_ += o.staked;
+            paid_ += o.paid;
+        }
+        s->pending_ = Decision::skip();
+    }
+    Seat* ready = waiting_;
+    waiting_ = nullptr;
+    arrived_ = 0;
+    return ready;
+}
+
+inline void SimTable::resume_all(Seat* list, const Seat* except) {
+    while (list) {
+        Seat* s = list;
+        list = s->next_;                // read before the session can run
+        if (s != except) exec_.schedule(s->waiter_);
+    }
+}
@@ -0,0 +1,127 @@
+// alias_table.hpp
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * O(1) sampling from a fixed discrete distribution (Vose's alias method),
+ * for wheels whose pockets are not equally likely.
+ *
+ * The weights are split into n slots of equal mass 1/n; slot i keeps
+ * pocket i with probability cut/2^64 and otherwise gives its alias. A
+ * sample is one 64-bit random word: the high part of word * n picks the
+ * slot, and the low part (uniform within the slot) is the coin against
+ * the cut. So a biased spin costs one engine call, a multiply and a
+ * load from a table that sits in a single 16-byte entry per pocket.
+ *
+ * Building is O(n). Probabilities are exact up to the double weights and
+ * a 2^-64 quantization of each cut; weights need not sum to one.
+ */
+
+class AliasTable {
+public:
+    AliasTable() = default;
+
+    // Throws std::invalid_argument for no weights, a negative or
+    // non-finite weight, or weights that sum to zero.
+    explicit AliasTable(const std::vector<double>& weights) {
+        const size_t n = weights.size();
+        if (n == 0 || n > std::numeric_limits<uint32_t>::max())
+            throw std::invalid_argument("alias table: bad size");
+        double total = 0.0;
+        for (double w : weights) {
+            if (!std::isfinite(w) || w < 0.0) throw std::invalid_argument("alias table: bad weight");
+            total += w;
+        }
+        if (!(total > 0.0)) throw std::invalid_argument("alias table: weights sum to zero");
+
+        prob_.resize(n);
+        slots_.resize(n);
+        std::vector<double> scaled(n);
+        std::vector<uint32_t> small, large;
+        for (size_t i = 0; i < n; ++i) {
+            prob_[i] = weights[i] / total;
+            scaled[i] = prob_[i] * (double)n;
+            (scaled[i] < 1.0 ? small : large).push_back((uint32_t)i);
+        }
+        while (!small.empty() && !large.empty()) {
+            const uint32_t s = small.back(), l = large.back();
+            small.pop_back();
+            slots_[s] = Slot{ cut_of(scaled[s]), l };
+            scaled[l] -= 1.0 - scaled[s];
+            if (scaled[l] < 1.0) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        // whatever is left is 1 up to rounding: always keep it
+        for (uint32_t i : large) slots_[i] = Slot{ KEEP, i };
+        for (uint32_t i : small) slots_[i] = Slot{ KEEP, i };
+    }
+
+    size_t size() const { return slots_.size(); }
+    bool empty() const { return slots_.empty(); }
+    double probability(size_t i) const { return prob_[i]; }
+
+    // The index for one uniform 64-bit word.
+    uint32_t sample(uint64_t word) const {
+        const uint128 x = (uint128)word * slots_.size();
+        const Slot& s = slots_[(size_t)(x >> 64)];
+        return (uint64_t)x < s.cut ? (uint32_t)(&s - slots_.data()) : s.alias;
+    }
+
+    template <class URBG>
+    uint32_t operator()(URBG& g) const { return sample(word(g)); }
+
+    // n samples into out; the words are drawn first so the lookups run
+    // back to back instead of behind each engine call.
+    template <class URBG, class T>
+    void fill(URBG& g, T* out, size_t n) const {
+        uint64_t words[BATCH];
+        while (n > 0) {
+            const size_t k = n < BATCH ? n : BATCH;
+            for (size_t i = 0; i < k; ++i) words[i] = word(g);
+            for (size_t i = 0; i < k; ++i) out[i] = (T)sample(words[i]);
+            out += k;
+            n -= k;
+        }
+    }
+
+    // One uniform 64-bit word from any engine with a full 32- or 64-bit range.
+    template <class URBG>
+    static uint64_t word(URBG& g) {
+        static_assert(URBG::min() == 0, "alias table needs a full-range engine");
+        if constexpr (URBG::max() >= std::numeric_limits<uint64_t>::max()) {
+            return (uint64_t)g();
+        } else {
+            static_assert(URBG::max() == std::numeric_limits<uint32_t>::max(),
+                          "alias table needs a full-range engine");
+            const uint64_t hi = (uint32_t)g();
+            return hi << 32 | (uint32_t)g();
+        }
+    }
+
+private:
+    __extension__ typedef unsigned __int128 uint128;
+
+    static constexpr size_t BATCH = 64;
+    static constexpr uint64_t KEEP = std::numeric_limits<uint64_t>::max();
+
+    struct Slot {
+        uint64_t cut;           // keep the slot's own index below this
+        uint32_t alias;
+    };
+
+    static uint64_t cut_of(double p) {
+        if (p <= 0.0) return 0;
+        const double c = std::ldexp(p, 64);
+        return c >= 18446744073709551615.0 ? KEEP : (uint64_t)c;
+    }
+
+    std::vector<Slot> slots_;
+    std::vector<double> prob_;
+};
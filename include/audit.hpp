@@ -0,0 +1,365 @@
+// audit.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "mpsc_queue.hpp"
+#include "sha256.hpp"
+
+/**
+ * Tamper-evident audit trail: one record per table round (result index and
+ * every seat's settlement), SHA-256 chained per table:
+ *
+ *   hash_n = SHA-256(hash_{n-1} || payload_n),  hash_0 = SHA-256("roulette-audit/<table>")
+ *
+ * Changing, dropping or reordering a record breaks every later hash of
+ * that table's chain; publishing the chain heads now and then (heads())
+ * pins the tail as well.
+ *
+ * Tables hand entries to a writer thread through a lock-free queue. The
+ * writer hashes a batch eight chains at a time with sha256_x8 (chains are
+ * independent, records within one chain are not) and appends it with one
+ * write and one sync. Verification needs only the file: each record's
+ * predecessor hash is stored in the previous record of its table, so every
+ * record checks independently and verify_audit() splits them over cores.
+ *
+ * Opening an existing log checks its chains and cuts off a partial or bad
+ * last record (a crash mid-write), so appends carry on from the last good
+ * record of each table. Damage further back is left alone for
+ * audit_verify to report, and the log refuses to open.
+ *
+ * On disk: repeated [u32 payload_len][payload][32-byte hash]; payload is
+ * u32 table, u32 count, u64 round, i32 index, u32 reserved, i64 unix ns,
+ * then count x { u32 seat, u32 reserved, f64 staked, f64 paid }.
+ */
+
+struct AuditSettlement {
+    uint32_t seat;
+    double staked;
+    double paid;
+};
+
+struct AuditEntry {
+    uint32_t table = 0;
+    uint64_t round = 0;
+    int index = -1;
+    int64_t time_ns = 0;
+    std::vector<AuditSettlement> settlements;
+};
+
+inline Sha256Digest audit_genesis(uint32_t table) {
+    const std::string seed = "roulette-audit/" + std::to_string(table);
+    return sha256(seed.data(), seed.size());
+}
+
+namespace audit_detail {
+
+constexpr size_t FIXED = 32;                // payload bytes before the settlements
+constexpr size_t PER_SETTLE = 24;
+
+template <class T>
+inline void put(std::vector<uint8_t>& out, T v) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&v);
+    out.insert(out.end(), p, p + sizeof v);
+}
+
+// [u32 len][32 bytes for the previous hash][payload]: the hash input sits
+// in place and the length prefix goes straight to disk.
+inline void encode(const AuditEntry& e, std::vector<uint8_t>& out) {
+    out.clear();
+    out.reserve(4 + 32 + FIXED + e.settlements.size() * PER_SETTLE);
+    put<uint32_t>(out, (uint32_t)(FIXED + e.settlements.size() * PER_SETTLE));
+    out.resize(4 + 32);
+    put<uint32_t>(out, e.table);
+    put<uint32_t>(out, (uint32_t)e.settlements.size());
+    put<uint64_t>(out, e.round);
+    put<int32_t>(out, e.index);
+    put<uint32_t>(out, 0);
+    put<int64_t>(out, e.time_ns);
+    for (const AuditSettlement& s : e.settlements) {
+        put<uint32_t>(out, s.seat);
+        put<uint32_t>(out, 0);
+        put<double>(out, s.staked);
+        put<double>(out, s.paid);
+    }
+}
+
+inline uint32_t load_u32(const uint8_t* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+
+} // namespace audit_detail
+
+class AuditLog {
+public:
+    explicit AuditLog(const std::string& path, size_t queue_capacity = 1 << 16)
+    : queue_(queue_capacity) {
+        const off_t valid = load_heads(path);
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0) throw std::runtime_error("audit open failed: " + std::string(std::strerror(errno)));
+        // a crash can leave part of a record; appends must start after the last whole one
+        if (::lseek(fd_, 0, SEEK_END) != valid && (::ftruncate(fd_, valid) != 0 || ::fsync(fd_) != 0))
+            throw std::runtime_error("audit truncate failed: " + std::string(std::strerror(errno)));
+        writer_ = std::thread([this] { write_loop(); });
+    }
+
+    ~AuditLog() {
+        stopping_.store(true);
+        wake();
+        writer_.join();
+        ::close(fd_);
+    }
+
+    AuditLog(const AuditLog&) = delete;
+    AuditLog& operator=(const AuditLog&) = delete;
+
+    // Any thread; never waits on hashing or disk unless the queue is full.
+    void record(AuditEntry e) {
+        while (!queue_.try_push(e)) {
+            wake();
+            std::this_thread::yield();
+        }
+        wake();
+    }
+
+    uint64_t records() const { return written_.load(std::memory_order_relaxed); }
+
+private:
+    struct Pending {
+        uint32_t table;
+        std::vector<uint8_t> bytes;     // encode() layout, hash appended once known
+    };
+
+    void wake() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed) && sleeping_.exchange(false, std::memory_order_seq_cst))
+            sleeping_.notify_one();
+    }
+
+    // Picks up the chain heads of an existing log so appends continue them,
+    // checking each record against its chain; returns the length of the
+    // whole, chain-valid prefix, which the caller cuts the file back to.
+    // Only the last record may be bad: anything more is tampering or
+    // damage, and throws rather than destroy the evidence.
+    off_t load_heads(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return 0;
+        std::vector<uint8_t> data;
+        uint8_t buf[1 << 16];
+        for (ssize_t n; (n = ::read(fd, buf, sizeof buf)) > 0;) data.insert(data.end(), buf, buf + n);
+        ::close(fd);
+        size_t at = 0;
+        while (at + 4 <= data.size()) {
+            const uint32_t len = audit_detail::load_u32(&data[at]);
+            if (len < audit_detail::FIXED || at + 4 + len + 32 > data.size()) break;
+            const uint32_t count = audit_detail::load_u32(&data[at + 8]);
+            if (len != audit_detail::FIXED + (uint64_t)count * audit_detail::PER_SETTLE) break;
+            const uint32_t table = audit_detail::load_u32(&data[at + 4]);
+            Sha256 h;
+            h.update(head(table).data(), 32);
+            h.update(&data[at + 4], len);
+            const Sha256Digest d = h.final();
+            if (std::memcmp(d.data(), &data[at + 4 + len], 32) != 0) {
+                if (at + 4 + len + 32 < data.size())
+                    throw std::runtime_error("audit log fails its chain at byte " + std::to_string(at) +
+                                             " with records after it; run audit_verify");
+                break;
+            }
+            head(table) = d;
+            at += 4 + len + 32;
+        }
+        return (off_t)at;
+    }
+
+    Sha256Digest& head(uint32_t table) {
+        auto it = heads_.find(table);
+        if (it == heads_.end()) it = heads_.emplace(table, audit_genesis(table)).first;
+        return it->second;
+    }
+
+    void write_loop() {
+        std::vector<Pending> batch;
+        std::vector<uint8_t> out;
+        std::unordered_map<uint32_t, std::vector<size_t>> chains;
+        for (;;) {
+            size_t n = 0;
+            queue_.drain([&](AuditEntry&& e) {
+                if (batch.size() <= n) batch.emplace_back();
+                batch[n].table = e.table;
+                audit_detail::encode(e, batch[n].bytes);
+                ++n;
+            });
+
+            if (n == 0) {
+                if (stopping_.load()) return;
+                sleeping_.store(true, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (queue_.size_approx() == 0 && !stopping_.load()) sleeping_.wait(true, std::memory_order_seq_cst);
+                sleeping_.store(false, std::memory_order_relaxed);
+                continue;
+            }
+
+            for (auto& [t, list] : chains) list.clear();
+            for (size_t i = 0; i < n; ++i) chains[batch[i].table].push_back(i);
+            hash_batch(batch, chains);
+
+            out.clear();
+            for (size_t i = 0; i < n; ++i) out.insert(out.end(), batch[i].bytes.begin(), batch[i].bytes.end());
+            write_all(out);
+            written_.fetch_add(n, std::memory_order_relaxed);
+        }
+    }
+
+    // Step k hashes the k-th pending record of every chain, eight at a time.
+    void hash_batch(std::vector<Pending>& batch, std::unordered_map<uint32_t, std::vector<size_t>>& chains) {
+        std::vector<std::pair<uint32_t, const std::vector<size_t>*>> live;
+        for (auto& [t, list] : chains) if (!list.empty()) live.emplace_back(t, &list);
+
+        for (size_t k = 0; !live.empty(); ++k) {
+            for (size_t i = 0; i < live.size(); i += 8) {
+                const int count = (int)std::min<size_t>(8, live.size() - i);
+                const uint8_t* msgs[8];
+                size_t lens[8];
+                Sha256Digest digests[8];
+                for (int l = 0; l < count; ++l) {
+                    std::vector<uint8_t>& b = batch[(*live[i + l].second)[k]].bytes;
+                    std::memcpy(b.data() + 4, head(live[i + l].first).data(), 32);
+                    msgs[l] = b.data() + 4;
+                    lens[l] = b.size() - 4;
+                }
+                sha256_x8(msgs, lens, digests, count);
+                for (int l = 0; l < count; ++l) {
+                    std::vector<uint8_t>& b = batch[(*live[i + l].second)[k]].bytes;
+                    head(live[i + l].first) = digests[l];
+                    // on disk the previous hash is implied, so the record is
+                    // [len][payload][hash]: slide the payload over it
+                    std::memmove(b.data() + 4, b.data() + 36, b.size() - 36);
+                    b.resize(b.size() - 32);
+                    b.insert(b.end(), digests[l].begin(), digests[l].end());
+                }
+            }
+            live.erase(std::remove_if(live.begin(), live.end(),
+                                      [&](const auto& c) { return c.second->size() <= k + 1; }),
+                       live.end());
+        }
+    }
+
+    void write_all(const std::vector<uint8_t>& out) {
+        const uint8_t* p = out.data();
+        size_t left = out.size();
+        while (left > 0) {
+            ssize_t n = ::write(fd_, p, left);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) throw std::runtime_error("audit write failed: " + std::string(std::strerror(errno)));
+            p += n;
+            left -= (size_t)n;
+        }
+#if defined(__linux__)
+        const int rc = ::fdatasync(fd_);
+#else
+        const int rc = ::fsync(fd_);
+#endif
+        if (rc != 0) throw std::runtime_error("audit sync failed: " + std::string(std::strerror(errno)));
+    }
+
+    MpscQueue<AuditEntry> queue_;
+    std::unordered_map<uint32_t, Sha256Digest> heads_;     // writer thread only
+    int fd_ = -1;
+    alignas(64) std::atomic<bool> sleeping_{false};
+    std::atomic<bool> stopping_{false};
+    std::atomic<uint64_t> written_{0};
+    std::thread writer_;
+};
+
+// ---------- verification ----------
+
+struct AuditReport {
+    uint64_t records = 0;
+    uint64_t bad = 0;
+    uint64_t first_bad_offset = UINT64_MAX;     // byte offset of the first failing record
+    bool truncated = false;                     // trailing bytes that aren't a whole record
+    std::unordered_map<uint32_t, Sha256Digest> heads;
+};
+
+// Checks every record of a log image on `threads` threads. A record whose
+// length disagrees with its settlement count is bad even if it hashes.
+inline AuditReport verify_audit(const uint8_t* data, size_t size, int threads) {
+    using audit_detail::load_u32;
+    AuditReport rep;
+
+    // index pass: record offsets, and where each record's predecessor hash is
+    struct Rec {
+        uint64_t off;
+        uint32_t len;
+        int64_t prev;           // offset of the previous hash, -1 = genesis
+        uint32_t table;
+        bool shaped;            // len matches the settlement count
+    };
+    std::vector<Rec> recs;
+    std::unordered_map<uint32_t, int64_t> last;
+    size_t at = 0;
+    while (at + 4 <= size) {
+        const uint32_t len = load_u32(data + at);
+        if (len < audit_detail::FIXED || at + 4 + len + 32 > size) break;
+        const uint32_t table = load_u32(data + at + 4);
+        const uint32_t count = load_u32(data + at + 8);
+        const bool shaped = len == audit_detail::FIXED + (uint64_t)count * audit_detail::PER_SETTLE;
+        auto it = last.find(table);
+        recs.push_back(Rec{ at, len, it == last.end() ? -1 : it->second, table, shaped });
+        last[table] = (int64_t)(at + 4 + len);
+        at += 4 + len + 32;
+    }
+    rep.truncated = at != size;
+    rep.records = recs.size();
+    for (auto& [t, off] : last) std::memcpy(rep.heads[t].data(), data + off, 32);
+
+    std::unordered_map<uint32_t, Sha256Digest> genesis;
+    for (auto& [t, off] : last) genesis[t] = audit_genesis(t);
+
+    threads = std::max(1, threads);
+    std::vector<uint64_t> bad(threads, 0), first(threads, UINT64_MAX);
+    std::vector<std::thread> pool;
+    for (int w = 0; w < threads; ++w) {
+        pool.emplace_back([&, w] {
+            const size_t lo = recs.size() * w / threads, hi = recs.size() * (w + 1) / threads;
+            std::vector<uint8_t> scratch[8];
+            for (size_t i = lo; i < hi; i += 8) {
+                const int count = (int)std::min<size_t>(8, hi - i);
+                const uint8_t* msgs[8];
+                size_t lens[8];
+                Sha256Digest digests[8];
+                for (int l = 0; l < count; ++l) {
+                    const Rec& r = recs[i + l];
+                    scratch[l].resize(32 + r.len);
+                    const uint8_t* prev = r.prev < 0 ? genesis.at(r.table).data() : data + r.prev;
+                    std::memcpy(scratch[l].data(), prev, 32);
+                    std::memcpy(scratch[l].data() + 32, data + r.off + 4, r.len);
+                    msgs[l] = scratch[l].data();
+                    lens[l] = scratch[l].size();
+                }
+                sha256_x8(msgs, lens, digests, count);
+                for (int l = 0; l < count; ++l) {
+                    const Rec& r = recs[i + l];
+                    if (!r.shaped || std::memcmp(digests[l].data(), data + r.off + 4 + r.len, 32) != 0) {
+                        ++bad[w];
+                        first[w] = std::min(first[w], r.off);
+                    }
+                }
+            }
+        });
+    }
+    for (std::thread& t : pool) t.join();
+    for (int w = 0; w < threads; ++w) {
+        rep.bad += bad[w];
+        rep.first_bad_offset = std::min(rep.first_bad_offset, first[w]);
+    }
+    return rep;
+}
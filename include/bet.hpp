@@ -1,6 +1,9 @@
 #pragma once
+#include <cctype>
+#include <cstddef>
 #include <string>
 #include <stdexcept>
+#include <utility>
 
 struct Bet {
     enum class Type {
@@ -30,6 +33,44 @@ struct Bet {
     }
 };
 
+// Longest selection a table accepts. Every legal one is shorter ("00-2-3");
+// the ledger, snapshots and wire frames all hold at least this many.
+constexpr size_t MAX_SELECTION = 10;
+
+// inverse of bet_type_to_string; case and spaces are ignored ("sixline", "Six Line")
+inline bool parse_bet_type(const std::string& name, Bet::Type& out) {
+    std::string key;
+    for (char c : name) if (c != ' ') key += (char)std::tolower((unsigned char)c);
+    static const std::pair<const char*, Bet::Type> names[] = {
+        {"straight", Bet::Type::Straight}, {"split", Bet::Type::Split},
+        {"street", Bet::Type::Street},     {"corner", Bet::Type::Corner},
+        {"sixline", Bet::Type::SixLine},   {"column", Bet::Type::Column},
+        {"dozen", Bet::Type::Dozen},       {"red", Bet::Type::Red},
+        {"black", Bet::Type::Black},       {"odd", Bet::Type::Odd},
+        {"even", Bet::Type::Even},         {"high", Bet::Type::High},
+        {"low", Bet::Type::Low} };
+    for (auto [n, t] : names) if (key == n) { out = t; return true; }
+    return false;
+}
+
+// how many pockets a single bet of this type covers
+inline int pockets_covered(Bet::Type type) {
+    switch (type) {
+        case Bet::Type::Straight: return 1;
+        case Bet::Type::Split:    return 2;
+        case Bet::Type::Street:   return 3;
+        case Bet::Type::Corner:   return 4;
+        case Bet::Type::SixLine:  return 6;
+        case Bet::Type::Column:
+        case Bet::Type::Dozen:    return 12;
+        case Bet::Type::Red:   case Bet::Type::Black:
+        case Bet::Type::Odd:   case Bet::Type::Even:
+        case Bet::Type::High:  case Bet::Type::Low:
+            return 18;
+    }
+    return 0;
+}
+
 std::string bet_type_to_string(Bet::Type type) {
     switch (type) {
         case Bet::Type::Straight: return "Straight";
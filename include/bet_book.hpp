@@ -0,0 +1,143 @@
+// bet_book.hpp
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "bet.hpp"
+#include "roulette.hpp"
+
+/**
+ * All open bets on one table, as a slot map.
+ *
+ * Bets live densely in `entries()` so settlement walks one contiguous
+ * array. A handle names a slot plus the slot's generation; the slot holds
+ * the bet's current dense position, so lookup, modify and cancel are O(1)
+ * (cancel moves the last entry into the hole). A stale handle - cancelled,
+ * or from an earlier round - fails its generation check instead of hitting
+ * someone else's bet.
+ *
+ * clear() ends a round without freeing anything: slots go back on the free
+ * list with bumped generations and the vectors keep their capacity.
+ */
+
+struct BetHandle {
+    uint32_t slot = UINT32_MAX;
+    uint32_t gen = 0;
+
+    // single number for the wire
+    uint64_t value() const { return (uint64_t)gen << 32 | slot; }
+    static BetHandle from(uint64_t v) { return BetHandle{ (uint32_t)v, (uint32_t)(v >> 32) }; }
+};
+
+struct BookEntry {
+    Bet bet;
+    uint64_t mask;          // coverage_mask(bet)
+    double payout;          // amount * (odds + 1) if it wins
+    uint32_t seat;
+    uint32_t slot;          // back-pointer for swap-remove
+};
+
+class BetBook {
+public:
+    BetHandle add(uint32_t seat, const Bet& bet) {
+        uint32_t s;
+        if (free_head_ != NONE) {
+            s = free_head_;
+            free_head_ = slots_[s].next;
+        } else {
+            s = (uint32_t)slots_.size();
+            slots_.push_back(Slot{});
+        }
+        slots_[s].dense = (uint32_t)entries_.size();
+        entries_.push_back(BookEntry{ bet, coverage_mask(bet), bet.amount * (bet.payout_odds + 1.0), seat, s });
+        return BetHandle{ s, slots_[s].gen };
+    }
+
+    const BookEntry* find(BetHandle h) const {
+        if (h.slot >= slots_.size()) return nullptr;
+        const Slot& s = slots_[h.slot];
+        return s.gen == h.gen && s.dense != NONE ? &entries_[s.dense] : nullptr;
+    }
+    BookEntry* find(BetHandle h) {
+        return const_cast<BookEntry*>(static_cast<const BetBook&>(*this).find(h));
+    }
+
+    BetHandle handle_of(const BookEntry& e) const { return BetHandle{ e.slot, slots_[e.slot].gen }; }
+
+    // New stake for an open bet; false if the handle is stale.
+    bool resize(BetHandle h, double amount) {
+        BookEntry* e = find(h);
+        if (!e) return false;
+        e->bet.amount = amount;
+        e->payout = amount * (e->bet.payout_odds + 1.0);
+        return true;
+    }
+
+    bool remove(BetHandle h) {
+        if (!find(h)) return false;
+        remove_at(slots_[h.slot].dense);
+        return true;
+    }
+
+    // Drops every bet `seat` holds; O(open bets).
+    void remove_seat(uint32_t seat) {
+        for (size_t i = entries_.size(); i-- > 0;)
+            if (entries_[i].seat == seat) remove_at((uint32_t)i);
+    }
+
+    void clear() {
+        for (const BookEntry& e : entries_) release(e.slot);
+        entries_.clear();
+    }
+
+    // Recovery: puts a bet back under the handle it had before. Call
+    // rebuild_free_list() once every bet is back in.
+    void restore(BetHandle h, uint32_t seat, const Bet& bet) {
+        if (h.slot >= slots_.size()) slots_.resize(h.slot + 1);
+        slots_[h.slot].gen = h.gen;
+        slots_[h.slot].dense = (uint32_t)entries_.size();
+        entries_.push_back(BookEntry{ bet, coverage_mask(bet), bet.amount * (bet.payout_odds + 1.0), seat, h.slot });
+    }
+
+    void rebuild_free_list() {
+        free_head_ = NONE;
+        for (uint32_t s = (uint32_t)slots_.size(); s-- > 0;) {
+            if (slots_[s].dense != NONE) continue;
+            ++slots_[s].gen;
+            slots_[s].next = free_head_;
+            free_head_ = s;
+        }
+    }
+
+    const std::vector<BookEntry>& entries() const { return entries_; }
+    size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Slot {
+        uint32_t dense = NONE;      // position in entries_, NONE when free
+        uint32_t gen = 0;
+        uint32_t next = NONE;       // free list link
+    };
+
+    void release(uint32_t s) {
+        slots_[s].dense = NONE;
+        ++slots_[s].gen;
+        slots_[s].next = free_head_;
+        free_head_ = s;
+    }
+
+    void remove_at(uint32_t i) {
+        release(entries_[i].slot);
+        if (i + 1 != entries_.size()) {
+            entries_[i] = std::move(entries_.back());
+            slots_[entries_[i].slot].dense = i;
+        }
+        entries_.pop_back();
+    }
+
+    std::vector<Slot> slots_;
+    std::vector<BookEntry> entries_;
+    uint32_t free_head_ = NONE;
+};
@@ -0,0 +1,301 @@
+// chacha.hpp
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHACHA_X86 1
+#endif
+
+/**
+ * ChaCha stream cipher (Bernstein) as a random engine: the keystream under
+ * a 256-bit key is the output, 32 bits at a time. With 20 rounds it is a
+ * cryptographically secure generator; ChaCha12 trades margin for speed.
+ *
+ * Keystream is made eight 64-byte blocks at a time. On x86 CPUs with AVX2
+ * each 256-bit register holds one state word of all eight blocks, so the
+ * rounds run on eight blocks at once; elsewhere the same blocks are made
+ * one by one. Both give the same bytes (the original 64-bit counter and
+ * 64-bit stream nonce layout).
+ *
+ * bounded(n) draws uniformly from [0, n) without bias (Lemire's multiply
+ * and reject: one multiply, and for n = 37 a retry about once in 10^8).
+ *
+ * from_urandom() keys from /dev/urandom, and with a reseed interval the
+ * engine re-keys itself from /dev/urandom after that many outputs; the
+ * sequence of such an engine is not reproducible, by design. A seeded
+ * engine (a 64-bit seed expanded to a key) is, for simulations. The
+ * stream operators save and load the whole state, as for the std engines.
+ */
+
+template <int ROUNDS>
+class ChaCha {
+    static_assert(ROUNDS % 2 == 0 && ROUNDS > 0, "ChaCha runs double rounds");
+
+public:
+    using result_type = uint32_t;
+    using Key = std::array<uint32_t, 8>;
+    static constexpr int BLOCKS = 8;                    // per refill
+    static constexpr int WORDS = 16 * BLOCKS;
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+
+    // Key expanded from `seed` with SplitMix64: reproducible, not secret.
+    explicit ChaCha(uint64_t seed = 0) {
+        Key k;
+        for (size_t i = 0; i < k.size(); i += 2) {
+            uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            z ^= z >> 31;
+            k[i] = (uint32_t)z;
+            k[i + 1] = (uint32_t)(z >> 32);
+        }
+        rekey(k, 0);
+    }
+
+    ChaCha(const Key& key, uint64_t stream) { rekey(key, stream); }
+
+    // Keyed from /dev/urandom; reseed_every > 0 re-keys after that many outputs.
+    static ChaCha from_urandom(uint64_t reseed_every = 0) {
+        ChaCha c(urandom_key(), 0);
+        c.reseed_every_ = reseed_every;
+        return c;
+    }
+
+    // A fresh key from /dev/urandom, counter back to zero.
+    void reseed() { rekey(urandom_key(), stream_); }
+
+    result_type operator()() {
+        if (pos_ == WORDS) refill();
+        return buf_[pos_++];
+    }
+
+    // Uniform in [0, n), n > 0.
+    uint32_t bounded(uint32_t n) {
+        uint64_t m = (uint64_t)(*this)() * n;
+        if ((uint32_t)m < n) {
+            const uint32_t floor = (0u - n) % n;
+            while ((uint32_t)m < floor) m = (uint64_t)(*this)() * n;
+        }
+        return (uint32_t)(m >> 32);
+    }
+
+    void discard(unsigned long long n) {
+        while (n) {
+            if (pos_ == WORDS) refill();
+            const unsigned long long step = std::min<unsigned long long>(n, WORDS - pos_);
+            pos_ += (uint32_t)step;
+            n -= step;
+        }
+    }
+
+    bool operator==(const ChaCha& o) const {
+        return key_ == o.key_ && stream_ == o.stream_ && counter_ == o.counter_ && pos_ == o.pos_ &&
+               reseed_every_ == o.reseed_every_ && since_reseed_ == o.since_reseed_;
+    }
+
+    // key words, stream, counter of the buffered blocks, position in them,
+    // reseed interval and progress
+    friend std::ostream& operator<<(std::ostream& os, const ChaCha& c) {
+        os << "chacha" << ROUNDS;
+        for (uint32_t k : c.key_) os << ' ' << k;
+        return os << ' ' << c.stream_ << ' ' << c.counter_ << ' ' << c.pos_ << ' ' << c.reseed_every_ << ' '
+                  << c.since_reseed_;
+    }
+    friend std::istream& operator>>(std::istream& is, ChaCha& c) {
+        std::string tag;
+        Key key;
+        uint64_t stream, counter, every, since;
+        uint32_t pos;
+        is >> tag;
+        for (uint32_t& k : key) is >> k;
+        is >> stream >> counter >> pos >> every >> since;
+        if (!is || tag != "chacha" + std::to_string(ROUNDS) || pos > WORDS) {
+            is.setstate(std::ios::failbit);
+            return is;
+        }
+        c.key_ = key;
+        c.stream_ = stream;
+        c.counter_ = counter;
+        c.reseed_every_ = every;
+        c.since_reseed_ = since;
+        c.generate();
+        c.pos_ = pos;
+        return is;
+    }
+
+    // One 64-byte block of keystream, portable code (for checking).
+    static void block(const Key& key, uint64_t stream, uint64_t counter, uint32_t out[16]) {
+        uint32_t x[16];
+        init(x, key, stream, counter);
+        uint32_t s[16];
+        std::memcpy(s, x, sizeof s);
+        for (int r = 0; r < ROUNDS; r += 2) double_round(x);
+        for (int i = 0; i < 16; ++i) out[i] = x[i] + s[i];
+    }
+
+private:
+    static uint32_t rotl(uint32_t v, int n) { return (v << n) | (v >> (32 - n)); }
+
+    static void quarter(uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d) {
+        a += b; d = rotl(d ^ a, 16);
+        c += d; b = rotl(b ^ c, 12);
+        a += b; d = rotl(d ^ a, 8);
+        c += d; b = rotl(b ^ c, 7);
+    }
+
+    static void double_round(uint32_t* x) {
+        quarter(x[0], x[4], x[8],  x[12]);
+        quarter(x[1], x[5], x[9],  x[13]);
+        quarter(x[2], x[6], x[10], x[14]);
+        quarter(x[3], x[7], x[11], x[15]);
+        quarter(x[0], x[5], x[10], x[15]);
+        quarter(x[1], x[6], x[11], x[12]);
+        quarter(x[2], x[7], x[8],  x[13]);
+        quarter(x[3], x[4], x[9],  x[14]);
+    }
+
+    static void init(uint32_t* x, const Key& key, uint64_t stream, uint64_t counter) {
+        x[0] = 0x61707865; x[1] = 0x3320646e; x[2] = 0x79622d32; x[3] = 0x6b206574;   // "expand 32-byte k"
+        for (int i = 0; i < 8; ++i) x[4 + i] = key[i];
+        x[12] = (uint32_t)counter;
+        x[13] = (uint32_t)(counter >> 32);
+        x[14] = (uint32_t)stream;
+        x[15] = (uint32_t)(stream >> 32);
+    }
+
+    static Key urandom_key() {
+        Key k;
+        const int fd = ::open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throw std::runtime_error("cannot open /dev/urandom: " + std::string(std::strerror(errno)));
+        size_t got = 0;
+        while (got < sizeof k) {
+            const ssize_t n = ::read(fd, reinterpret_cast<char*>(k.data()) + got, sizeof k - got);
+            if (n <= 0 && errno != EINTR) {
+                ::close(fd);
+                throw std::runtime_error("cannot read /dev/urandom");
+            }
+            if (n > 0) got += (size_t)n;
+        }
+        ::close(fd);
+        return k;
+    }
+
+    void rekey(const Key& key, uint64_t stream) {
+        key_ = key;
+        stream_ = stream;
+        counter_ = 0;
+        since_reseed_ = 0;
+        generate();
+    }
+
+    void refill() {
+        if (reseed_every_ && (since_reseed_ += WORDS) >= reseed_every_) {
+            const uint64_t every = reseed_every_;
+            reseed();
+            reseed_every_ = every;
+            return;
+        }
+        counter_ += BLOCKS;
+        generate();
+    }
+
+    // Blocks counter_ .. counter_ + 7 into buf_.
+    void generate() {
+        pos_ = 0;
+#if defined(CHACHA_X86)
+        static const bool avx2 = __builtin_cpu_supports("avx2");
+        if (avx2) return generate_avx2(key_, stream_, counter_, buf_.data());
+#endif
+        for (int b = 0; b < BLOCKS; ++b) block(key_, stream_, counter_ + (uint64_t)b, buf_.data() + 16 * b);
+    }
+
+#if defined(CHACHA_X86)
+    __attribute__((target("avx2"), always_inline))
+    static inline void quarter8(__m256i& a, __m256i& b, __m256i& c, __m256i& d) {
+        const __m256i rot16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                               2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+        const __m256i rot8 = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+                                              3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+        a = _mm256_add_epi32(a, b); d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot16);
+        c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c);
+        b = _mm256_or_si256(_mm256_slli_epi32(b, 12), _mm256_srli_epi32(b, 20));
+        a = _mm256_add_epi32(a, b); d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot8);
+        c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c);
+        b = _mm256_or_si256(_mm256_slli_epi32(b, 7), _mm256_srli_epi32(b, 25));
+    }
+
+    // Lane b of every register belongs to block counter + b.
+    __attribute__((target("avx2")))
+    static void generate_avx2(const Key& key, uint64_t stream, uint64_t counter, uint32_t* out) {
+        uint32_t init_words[16];
+        init(init_words, key, stream, counter);
+        __m256i s[16], x[16];
+        for (int i = 0; i < 16; ++i) s[i] = _mm256_set1_epi32((int)init_words[i]);
+        // per-lane 64-bit counters, carried into word 13
+        const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i lo = _mm256_add_epi32(s[12], lane);
+        const __m256i sign = _mm256_set1_epi32(INT32_MIN);
+        const __m256i carry = _mm256_cmpgt_epi32(_mm256_xor_si256(s[12], sign), _mm256_xor_si256(lo, sign));
+        s[12] = lo;
+        s[13] = _mm256_sub_epi32(s[13], carry);
+        for (int i = 0; i < 16; ++i) x[i] = s[i];
+
+        for (int r = 0; r < ROUNDS; r += 2) {
+            quarter8(x[0], x[4], x[8],  x[12]);
+            quarter8(x[1], x[5], x[9],  x[13]);
+            quarter8(x[2], x[6], x[10], x[14]);
+            quarter8(x[3], x[7], x[11], x[15]);
+            quarter8(x[0], x[5], x[10], x[15]);
+            quarter8(x[1], x[6], x[11], x[12]);
+            quarter8(x[2], x[7], x[8],  x[13]);
+            quarter8(x[3], x[4], x[9],  x[14]);
+        }
+        for (int i = 0; i < 16; ++i) x[i] = _mm256_add_epi32(x[i], s[i]);
+
+        // 8x8 transposes: words 0-7 and 8-15 of each block
+        for (int half = 0; half < 2; ++half) {
+            __m256i* v = x + 8 * half;
+            const __m256i t0 = _mm256_unpacklo_epi32(v[0], v[1]), t1 = _mm256_unpackhi_epi32(v[0], v[1]);
+            const __m256i t2 = _mm256_unpacklo_epi32(v[2], v[3]), t3 = _mm256_unpackhi_epi32(v[2], v[3]);
+            const __m256i t4 = _mm256_unpacklo_epi32(v[4], v[5]), t5 = _mm256_unpackhi_epi32(v[4], v[5]);
+            const __m256i t6 = _mm256_unpacklo_epi32(v[6], v[7]), t7 = _mm256_unpackhi_epi32(v[6], v[7]);
+            const __m256i u0 = _mm256_unpacklo_epi64(t0, t2), u1 = _mm256_unpackhi_epi64(t0, t2);
+            const __m256i u2 = _mm256_unpacklo_epi64(t1, t3), u3 = _mm256_unpackhi_epi64(t1, t3);
+            const __m256i u4 = _mm256_unpacklo_epi64(t4, t6), u5 = _mm256_unpackhi_epi64(t4, t6);
+            const __m256i u6 = _mm256_unpacklo_epi64(t5, t7), u7 = _mm256_unpackhi_epi64(t5, t7);
+            // u0: words 0-3 of blocks 0 and 4; u4: words 4-7 of blocks 0 and 4; ...
+            const __m256i rows[8] = {
+                _mm256_permute2x128_si256(u0, u4, 0x20), _mm256_permute2x128_si256(u1, u5, 0x20),
+                _mm256_permute2x128_si256(u2, u6, 0x20), _mm256_permute2x128_si256(u3, u7, 0x20),
+                _mm256_permute2x128_si256(u0, u4, 0x31), _mm256_permute2x128_si256(u1, u5, 0x31),
+                _mm256_permute2x128_si256(u2, u6, 0x31), _mm256_permute2x128_si256(u3, u7, 0x31),
+            };
+            for (int b = 0; b < 8; ++b)
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 16 * b + 8 * half), rows[b]);
+        }
+    }
+#endif
+
+    Key key_{};
+    uint64_t stream_ = 0;
+    uint64_t counter_ = 0;              // first block in buf_
+    uint64_t reseed_every_ = 0;         // outputs between re-keys; 0 = never
+    uint64_t since_reseed_ = 0;
+    uint32_t pos_ = WORDS;
+    alignas(32) std::array<uint32_t, WORDS> buf_{};
+};
+
+using ChaCha20 = ChaCha<20>;
+using ChaCha12 = ChaCha<12>;
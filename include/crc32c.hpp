@@ -0,0 +1,79 @@
+// crc32c.hpp
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+/**
+ * CRC-32C (Castagnoli), the checksum used by iSCSI, ext4 and most modern
+ * wire formats.
+ *
+ * Uses the CPU's CRC instruction when the build enables it (-msse4.2 on
+ * x86-64; arm64 compilers such as Apple clang enable it by default), and
+ * slicing-by-8 tables otherwise, which still runs at about a byte per cycle.
+ * crc32c(b, crc32c(a)) == crc32c(a + b), so a checksum can be built up
+ * over pieces.
+ */
+
+namespace crc32c_detail {
+
+constexpr uint32_t POLY = 0x82f63b78;       // reflected Castagnoli polynomial
+
+constexpr std::array<std::array<uint32_t, 256>, 8> make_tables() {
+    std::array<std::array<uint32_t, 256>, 8> t{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) c = (c >> 1) ^ (POLY & (0u - (c & 1)));
+        t[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; ++i)
+        for (int s = 1; s < 8; ++s) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xff];
+    return t;
+}
+
+inline constexpr auto TABLES = make_tables();
+
+} // namespace crc32c_detail
+
+inline uint32_t crc32c(const void* data, size_t len, uint32_t crc = 0) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint32_t c = ~crc;
+#if defined(__SSE4_2__)
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        c = (uint32_t)_mm_crc32_u64(c, v);
+    }
+    for (; len; ++p, --len) c = _mm_crc32_u8(c, *p);
+#elif defined(__ARM_FEATURE_CRC32)
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        c = __crc32cd(c, v);
+    }
+    for (; len; ++p, --len) c = __crc32cb(c, *p);
+#else
+    using crc32c_detail::TABLES;
+    for (; len >= 8; p += 8, len -= 8) {
+        uint32_t lo, hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + 4, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        lo = __builtin_bswap32(lo);
+        hi = __builtin_bswap32(hi);
+#endif
+        lo ^= c;
+        c = TABLES[7][lo & 0xff] ^ TABLES[6][(lo >> 8) & 0xff] ^ TABLES[5][(lo >> 16) & 0xff] ^ TABLES[4][lo >> 24] ^
+            TABLES[3][hi & 0xff] ^ TABLES[2][(hi >> 8) & 0xff] ^ TABLES[1][(hi >> 16) & 0xff] ^ TABLES[0][hi >> 24];
+    }
+    for (; len; ++p, --len) c = (c >> 8) ^ TABLES[0][(c ^ *p) & 0xff];
+#endif
+    return ~c;
+}
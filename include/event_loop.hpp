@@ -0,0 +1,205 @@
+// event_loop.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#else
+#include <sys/event.h>
+#endif
+
+/**
+ * Minimal single-threaded event loop: readiness polling (epoll on Linux,
+ * kqueue on macOS/BSD), a timer heap, and a task inbox other threads can
+ * post to. Everything except post() and stop() must be called from the
+ * loop's own thread.
+ */
+
+struct IoEvent {
+    uint64_t tag;
+    bool readable;
+    bool writable;
+    bool closed;
+};
+
+class Poller {
+public:
+    Poller() {
+#if defined(__linux__)
+        fd_ = epoll_create1(EPOLL_CLOEXEC);
+#else
+        fd_ = kqueue();
+#endif
+        if (fd_ < 0) throw std::runtime_error("poller create failed");
+    }
+    ~Poller() { ::close(fd_); }
+    Poller(const Poller&) = delete;
+    Poller& operator=(const Poller&) = delete;
+
+    // Watches fd for reads (and writes if `write`); tag comes back in IoEvent.
+    void add(int fd, uint64_t tag, bool write = false) { ctl(fd, tag, write, true); }
+    void modify(int fd, uint64_t tag, bool write) { ctl(fd, tag, write, false); }
+
+    void remove(int fd) {
+#if defined(__linux__)
+        epoll_ctl(fd_, EPOLL_CTL_DEL, fd, nullptr);
+#else
+        struct kevent ev[2];
+        EV_SET(&ev[0], fd, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+        EV_SET(&ev[1], fd, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+        kevent(fd_, ev, 2, nullptr, 0, nullptr);
+#endif
+    }
+
+    int wait(IoEvent* out, int max, int timeout_ms) {
+#if defined(__linux__)
+        epoll_event evs[256];
+        int n = epoll_wait(fd_, evs, std::min(max, 256), timeout_ms);
+        for (int i = 0; i < n; ++i)
+            out[i] = IoEvent{ evs[i].data.u64,
+                              (evs[i].events & EPOLLIN) != 0,
+                              (evs[i].events & EPOLLOUT) != 0,
+                              (evs[i].events & (EPOLLHUP | EPOLLERR)) != 0 };
+        return n < 0 ? 0 : n;
+#else
+        struct kevent evs[256];
+        timespec ts{ timeout_ms / 1000, (timeout_ms % 1000) * 1000000L };
+        int n = kevent(fd_, nullptr, 0, evs, std::min(max, 256), timeout_ms < 0 ? nullptr : &ts);
+        for (int i = 0; i < n; ++i)
+            out[i] = IoEvent{ (uint64_t)(uintptr_t)evs[i].udata,
+                              evs[i].filter == EVFILT_READ,
+                              evs[i].filter == EVFILT_WRITE,
+                              (evs[i].flags & (EV_EOF | EV_ERROR)) != 0 };
+        return n < 0 ? 0 : n;
+#endif
+    }
+
+private:
+    void ctl(int fd, uint64_t tag, bool write, bool add) {
+#if defined(__linux__)
+        epoll_event ev{};
+        ev.events = EPOLLIN | (write ? (uint32_t)EPOLLOUT : 0u);
+        ev.data.u64 = tag;
+        epoll_ctl(fd_, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev);
+#else
+        (void)add;
+        void* udata = (void*)(uintptr_t)tag;
+        struct kevent ev[2];
+        EV_SET(&ev[0], fd, EVFILT_READ, EV_ADD, 0, 0, udata);
+        EV_SET(&ev[1], fd, EVFILT_WRITE, write ? EV_ADD : EV_DELETE, 0, 0, udata);
+        kevent(fd_, ev, 2, nullptr, 0, nullptr);
+#endif
+    }
+
+    int fd_ = -1;
+};
+
+class EventLoop {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Task = std::function<void()>;
+    static constexpr uint64_t WAKE_TAG = 0;
+
+    EventLoop() {
+        if (::pipe(wake_) != 0) throw std::runtime_error("pipe failed");
+        for (int fd : wake_) ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+        poller_.add(wake_[0], WAKE_TAG);
+    }
+    ~EventLoop() { ::close(wake_[0]); ::close(wake_[1]); }
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    Poller& poller() { return poller_; }
+
+    // Called for every ready fd other than the wake pipe.
+    void on_io(std::function<void(const IoEvent&)> fn) { on_io_ = std::move(fn); }
+
+    // Thread-safe: runs `t` on the loop thread soon.
+    void post(Task t) {
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            wake = inbox_.empty();
+            inbox_.push_back(std::move(t));
+        }
+        if (wake) notify();
+    }
+
+    // Runs `t` on the loop thread at `when`.
+    void at(Clock::time_point when, Task t) {
+        timers_.push(Timer{ when, seq_++, std::move(t) });
+    }
+
+    void stop() {
+        stopping_.store(true);
+        notify();
+    }
+
+    void run() {
+        std::vector<IoEvent> events(256);
+        std::vector<Task> tasks;
+        while (!stopping_.load(std::memory_order_relaxed)) {
+            int timeout = -1;
+            if (!timers_.empty()) {
+                auto wait = timers_.top().when - Clock::now();
+                timeout = (int)std::max<int64_t>(0,
+                    std::chrono::ceil<std::chrono::milliseconds>(wait).count());
+            }
+
+            int n = poller_.wait(events.data(), (int)events.size(), timeout);
+            for (int i = 0; i < n; ++i) {
+                if (events[i].tag == WAKE_TAG) {
+                    char buf[256];
+                    while (::read(wake_[0], buf, sizeof buf) > 0) {}
+                } else if (on_io_) {
+                    on_io_(events[i]);
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                tasks.swap(inbox_);
+            }
+            for (Task& t : tasks) t();
+            tasks.clear();
+
+            const auto now = Clock::now();
+            while (!timers_.empty() && timers_.top().when <= now) {
+                Task t = std::move(const_cast<Timer&>(timers_.top()).task);
+                timers_.pop();
+                t();
+            }
+        }
+    }
+
+private:
+    struct Timer {
+        Clock::time_point when;
+        uint64_t seq;           // FIFO among equal deadlines
+        Task task;
+        bool operator>(const Timer& o) const { return when != o.when ? when > o.when : seq > o.seq; }
+    };
+
+    void notify() {
+        char c = 1;
+        [[maybe_unused]] auto r = ::write(wake_[1], &c, 1);
+    }
+
+    Poller poller_;
+    int wake_[2] = { -1, -1 };
+    std::function<void(const IoEvent&)> on_io_;
+    std::mutex mu_;
+    std::vector<Task> inbox_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    uint64_t seq_ = 0;
+    std::atomic<bool> stopping_{false};
+};
@@ -0,0 +1,377 @@
+// executor.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Work-stealing executor for coroutines, and the pooled frames they run in.
+ *
+ * Each worker owns a Chase-Lev deque of ready coroutine handles. It pushes
+ * and pops at the bottom (LIFO, so a coroutine woken by another tends to
+ * run while their shared data is still in cache); idle workers steal from
+ * the top of a random victim's deque. Handles scheduled from outside the
+ * pool go through a locked injection queue. Resuming a handle is one
+ * indirect call, so switching between sessions costs nanoseconds, not the
+ * microseconds of a thread context switch.
+ *
+ * Task frames come from FramePool: per-thread free lists in 64-byte size
+ * classes, carved out of 256 KB slabs. A million spawns cost a few thousand
+ * allocations, and a frame freed on another thread just joins that
+ * thread's list. Slabs are never returned, so pooled memory stays at the
+ * high-water mark of live frames.
+ */
+
+// ---------- Frame pool ----------
+class FramePool {
+public:
+    static constexpr size_t GRAIN = 64;
+    static constexpr size_t CLASSES = 32;       // pooled up to 2 KB; larger frames use operator new
+    static constexpr size_t SLAB = 256 << 10;
+
+    static void* allocate(size_t n) {
+        if (n > GRAIN * CLASSES) return ::operator new(n);
+        Local& l = local();
+        const size_t c = (n - 1) / GRAIN;
+        if (Node* p = l.free[c]) {
+            l.free[c] = p->next;
+            return p;
+        }
+        return l.carve((c + 1) * GRAIN);
+    }
+
+    static void deallocate(void* p, size_t n) {
+        if (n > GRAIN * CLASSES) return ::operator delete(p);
+        Local& l = local();
+        const size_t c = (n - 1) / GRAIN;
+        l.free[c] = ::new (p) Node{ l.free[c] };
+    }
+
+    // Bytes held in slabs by every thread, free or in use.
+    static size_t reserved() { return global().reserved.load(std::memory_order_relaxed); }
+
+private:
+    struct Node { Node* next; };
+
+    // Slabs outlive the threads that carved them: frames migrate.
+    struct Global {
+        std::mutex mu;
+        std::vector<std::unique_ptr<unsigned char[]>> slabs;
+        std::atomic<size_t> reserved{0};
+    };
+
+    struct Local {
+        Node* free[CLASSES] = {};
+        unsigned char* cur = nullptr;
+        size_t left = 0;
+
+        void* carve(size_t size) {
+            if (left < size) {
+                Global& g = global();
+                auto slab = std::make_unique<unsigned char[]>(SLAB);
+                cur = slab.get();
+                left = SLAB;
+                std::lock_guard<std::mutex> lk(g.mu);
+                g.slabs.push_back(std::move(slab));
+                g.reserved.fetch_add(SLAB, std::memory_order_relaxed);
+            }
+            void* p = cur;
+            cur += size;
+            left -= size;
+            return p;
+        }
+    };
+
+    static Global& global() {
+        static Global g;
+        return g;
+    }
+    static Local& local() {
+        thread_local Local l;
+        return l;
+    }
+};
+
+// ---------- Work-stealing deque ----------
+// Chase-Lev, with the memory orderings of Le et al. (PPoPP '13). push() and
+// pop() are for the owning thread only; steal() is for anyone.
+class WorkDeque {
+public:
+    explicit WorkDeque(size_t capacity = 1024) {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        rings_.push_back(std::make_unique<Ring>(cap));
+        ring_.store(rings_.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkDeque(const WorkDeque&) = delete;
+    WorkDeque& operator=(const WorkDeque&) = delete;
+
+    void push(void* item) {
+        const int64_t b = bottom_.load(std::memory_order_relaxed);
+        const int64_t t = top_.load(std::memory_order_acquire);
+        Ring* r = ring_.load(std::memory_order_relaxed);
+        if (b - t > (int64_t)r->mask) r = grow(r, t, b);
+        r->at(b).store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    void* pop() {
+        const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Ring* r = ring_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        void* item = r->at(b).load(std::memory_order_relaxed);
+        if (t == b) {
+            // last item: race the thieves for it
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                item = nullptr;
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    void* steal() {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+        void* item = ring_.load(std::memory_order_acquire)->at(t).load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return item;
+    }
+
+    bool empty() const {
+        return top_.load(std::memory_order_relaxed) >= bottom_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Ring {
+        explicit Ring(size_t cap) : mask(cap - 1), slots(new std::atomic<void*>[cap]) {}
+        std::atomic<void*>& at(int64_t i) { return slots[(size_t)i & mask]; }
+        size_t mask;
+        std::unique_ptr<std::atomic<void*>[]> slots;
+    };
+
+    // Old rings stay alive until the deque dies: a thief may still be reading one.
+    Ring* grow(Ring* old, int64_t t, int64_t b) {
+        rings_.push_back(std::make_unique<Ring>((old->mask + 1) * 2));
+        Ring* r = rings_.back().get();
+        for (int64_t i = t; i < b; ++i) r->at(i).store(old->at(i).load(std::memory_order_relaxed), std::memory_order_relaxed);
+        ring_.store(r, std::memory_order_release);
+        return r;
+    }
+
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    std::atomic<Ring*> ring_{nullptr};
+    std::vector<std::unique_ptr<Ring>> rings_;
+};
+
+// ---------- Task ----------
+class Executor;
+
+// A fire-and-forget coroutine. It starts suspended; Executor::spawn() takes
+// it over, and its frame goes back to the pool when it finishes.
+class Task {
+public:
+    struct promise_type {
+        Executor* exec = nullptr;
+
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct Final {
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<promise_type> h) noexcept;
+            void await_resume() noexcept {}
+        };
+        Final final_suspend() noexcept { return {}; }
+
+        void return_void() {}
+        // A spawned task has nobody to rethrow to.
+        void unhandled_exception() { std::terminate(); }
+
+        static void* operator new(size_t n) { return FramePool::allocate(n); }
+        static void operator delete(void* p, size_t n) { FramePool::deallocate(p, n); }
+    };
+
+    Task(Task&& o) noexcept : h_(std::exchange(o.h_, nullptr)) {}
+    Task& operator=(Task&& o) noexcept {
+        if (this != &o) {
+            if (h_) h_.destroy();
+            h_ = std::exchange(o.h_, nullptr);
+        }
+        return *this;
+    }
+    ~Task() { if (h_) h_.destroy(); }
+
+private:
+    friend class Executor;
+    explicit Task(std::coroutine_handle<promise_type> h) : h_(h) {}
+    std::coroutine_handle<promise_type> h_;
+};
+
+// ---------- Executor ----------
+class Executor {
+public:
+    explicit Executor(int threads = 0) {
+        const int n = threads > 0 ? threads : (int)std::max(1u, std::thread::hardware_concurrency());
+        for (int i = 0; i < n; ++i) workers_.push_back(std::make_unique<Worker>(this, (uint64_t)i));
+        for (auto& w : workers_) w->thread = std::thread([this, w = w.get()] { run(*w); });
+    }
+
+    ~Executor() {
+        stopping_.store(true);
+        epoch_.fetch_add(1);
+        epoch_.notify_all();
+        for (auto& w : workers_) w->thread.join();
+    }
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    void spawn(Task t) {
+        auto h = std::exchange(t.h_, nullptr);
+        h.promise().exec = this;
+        live_.fetch_add(1, std::memory_order_relaxed);
+        schedule(h);
+    }
+
+    // Any thread: resume `h` on a worker soon. From a worker it goes on that
+    // worker's own deque.
+    void schedule(std::coroutine_handle<> h) {
+        if (tls_worker_ && tls_worker_->owner == this) {
+            tls_worker_->deque.push(h.address());
+        } else {
+            std::lock_guard<std::mutex> lk(inject_mu_);
+            inject_.push_back(h.address());
+            injected_.fetch_add(1, std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_relaxed) > 0) {
+            epoch_.fetch_add(1);
+            epoch_.notify_one();
+        }
+    }
+
+    // Blocks until every spawned task has finished.
+    void wait() {
+        for (int64_t n = live_.load(); n != 0; n = live_.load()) live_.wait(n);
+    }
+
+    size_t threads() const { return workers_.size(); }
+    int64_t live() const { return live_.load(std::memory_order_relaxed); }
+
+    uint64_t resumes() const {
+        uint64_t n = 0;
+        for (auto& w : workers_) n += w->resumes.load(std::memory_order_relaxed);
+        return n;
+    }
+    uint64_t steals() const {
+        uint64_t n = 0;
+        for (auto& w : workers_) n += w->steals.load(std::memory_order_relaxed);
+        return n;
+    }
+
+private:
+    friend struct Task::promise_type::Final;
+
+    struct alignas(64) Worker {
+        Worker(Executor* e, uint64_t i) : owner(e), index(i), rng(0x9E3779B97F4A7C15ull * (i + 1)) {}
+        Executor* owner;
+        uint64_t index;
+        uint64_t rng;                   // xorshift, for picking victims
+        WorkDeque deque;
+        std::thread thread;
+        std::atomic<uint64_t> resumes{0};
+        std::atomic<uint64_t> steals{0};
+    };
+
+    void finished() {
+        if (live_.fetch_sub(1) == 1) live_.notify_all();
+    }
+
+    void* find_work(Worker& w) {
+        if (void* h = w.deque.pop()) return h;
+        if (injected_.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lk(inject_mu_);
+            if (!inject_.empty()) {
+                void* h = inject_.front();
+                inject_.pop_front();
+                injected_.fetch_sub(1, std::memory_order_relaxed);
+                return h;
+            }
+        }
+        const size_t n = workers_.size();
+        for (size_t tries = 0; tries < 2 * n && n > 1; ++tries) {
+            w.rng ^= w.rng << 13; w.rng ^= w.rng >> 7; w.rng ^= w.rng << 17;
+            Worker& victim = *workers_[w.rng % n];
+            if (&victim == &w) continue;
+            if (void* h = victim.deque.steal()) {
+                w.steals.store(w.steals.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return h;
+            }
+        }
+        return nullptr;
+    }
+
+    bool work_visible() const {
+        if (injected_.load(std::memory_order_relaxed) > 0) return true;
+        for (auto& w : workers_) if (!w->deque.empty()) return true;
+        return false;
+    }
+
+    void run(Worker& w) {
+        tls_worker_ = &w;
+        uint64_t resumed = 0;
+        while (!stopping_.load(std::memory_order_relaxed)) {
+            if (void* h = find_work(w)) {
+                w.resumes.store(++resumed, std::memory_order_relaxed);
+                std::coroutine_handle<>::from_address(h).resume();
+                continue;
+            }
+            // Nothing anywhere: sleep until a schedule() bumps the epoch.
+            const uint32_t e = epoch_.load();
+            sleepers_.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!work_visible() && !stopping_.load()) epoch_.wait(e);
+            sleepers_.fetch_sub(1);
+        }
+        tls_worker_ = nullptr;
+    }
+
+    static inline thread_local Worker* tls_worker_ = nullptr;
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex inject_mu_;
+    std::deque<void*> inject_;
+    std::atomic<int64_t> injected_{0};
+    alignas(64) std::atomic<int64_t> live_{0};
+    alignas(64) std::atomic<uint32_t> epoch_{0};
+    std::atomic<int> sleepers_{0};
+    std::atomic<bool> stopping_{false};
+};
+
+inline void Task::promise_type::Final::await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+    Executor* e = h.promise().exec;
+    h.destroy();
+    if (e) e->finished();
+}
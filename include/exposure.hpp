@@ -0,0 +1,89 @@
+// exposure.hpp
+#pragma once
+#include <array>
+#include <cstdint>
+#include "bet.hpp"
+#include "roulette.hpp"
+
+/**
+ * House exposure for one table's open bets: for every pocket, what the
+ * house pays out (stake + winnings) if the ball lands there.
+ *
+ * Each bet adds stake * (odds + 1) to the pockets in its coverage mask, so
+ * placing or removing a bet touches at most 18 entries. The worst pocket is
+ * tracked alongside: raising a pocket can only raise the max, and lowering
+ * the worst pocket triggers one rescan of the wheel's 37 to 39 entries.
+ * Every query is constant time. Coverage is masked to the wheel's pockets,
+ * so a European table never carries liability on "00".
+ *
+ * Net liability (what the house actually loses) is payout minus everything
+ * staked, since losing stakes stay with the house.
+ */
+
+class Exposure {
+public:
+    static constexpr int POCKETS = 39;     // the most any WheelType has
+
+    explicit Exposure(WheelType type = WheelType::American)
+    : pockets_(pocket_count(type)), mask_((uint64_t{1} << pockets_) - 1) {}
+
+    int pockets() const { return pockets_; }
+    double payout(int index) const { return payout_[index]; }
+    double staked() const { return staked_; }
+    double max_payout() const { return max_; }
+    int worst_pocket() const { return worst_; }                 // -1 when no bets are open
+    double net(int index) const { return payout_[index] - staked_; }
+    double max_net() const { return max_ - staked_; }
+
+    // Worst-case net liability if `bet` were added; O(pockets it covers).
+    double max_net_with(const Bet& bet) const {
+        const double pay = bet.amount * (bet.payout_odds + 1.0);
+        double m = max_;
+        for (uint64_t t = coverage_mask(bet) & mask_; t; t &= t - 1) {
+            const double v = payout_[__builtin_ctzll(t)] + pay;
+            if (v > m) m = v;
+        }
+        return m - (staked_ + bet.amount);
+    }
+
+    void add(const Bet& bet) {
+        const double pay = bet.amount * (bet.payout_odds + 1.0);
+        staked_ += bet.amount;
+        for (uint64_t t = coverage_mask(bet) & mask_; t; t &= t - 1) {
+            const int x = __builtin_ctzll(t);
+            payout_[x] += pay;
+            if (payout_[x] > max_ || worst_ < 0) { max_ = payout_[x]; worst_ = x; }
+        }
+    }
+
+    // `bet` must have been add()ed.
+    void remove(const Bet& bet) {
+        const double pay = bet.amount * (bet.payout_odds + 1.0);
+        const uint64_t m = coverage_mask(bet) & mask_;
+        staked_ -= bet.amount;
+        for (uint64_t t = m; t; t &= t - 1) payout_[__builtin_ctzll(t)] -= pay;
+        if (worst_ >= 0 && ((m >> worst_) & 1)) rescan();
+    }
+
+    void clear() {
+        payout_.fill(0.0);
+        staked_ = 0.0;
+        max_ = 0.0;
+        worst_ = -1;
+    }
+
+private:
+    void rescan() {
+        max_ = 0.0;
+        worst_ = -1;
+        for (int x = 0; x < pockets_; ++x)
+            if (payout_[x] > max_) { max_ = payout_[x]; worst_ = x; }
+    }
+
+    int pockets_;
+    uint64_t mask_;
+    std::array<double, POCKETS> payout_{};
+    double staked_ = 0.0;
+    double max_ = 0.0;
+    int worst_ = -1;
+};
@@ -0,0 +1,359 @@
+// floor_sim.hpp
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+#include "bet.hpp"
+#include "roulette.hpp"
+#include "session.hpp"
+#include "timing_wheel.hpp"
+
+/**
+ * Discrete-event simulation of a whole casino floor, for staffing and hold
+ * forecasts.
+ *
+ * Tables spin a Wheel at their own cadence. Players arrive as a Poisson
+ * stream whose rate follows the hour of day, pick a table they can afford
+ * with a free seat (or walk away: a balk), bet a Bet of their liking every
+ * spin, and leave when their time is up or their bankroll is gone.
+ * Occasionally they switch tables. Dealers work a shift and then take a
+ * break. A relief dealer from the pool takes over after a short changeover,
+ * and when the pool is empty the table closes until a dealer comes back
+ * from break.
+ *
+ * Events run off a TimingWheel in milliseconds. Table and player state are
+ * parallel arrays indexed by id, and seats are one flat tables x seats
+ * array, so a spin settles its players from a couple of cache lines. Stale
+ * events (a player who already left, a spin chain cut by a dealer swap)
+ * are recognised by a generation number rather than cancelled.
+ */
+
+struct FloorConfig {
+    int tables = 200;
+    int seats = 8;                      // per table
+    double american_share = 0.5;        // the rest are single-zero
+    double days = 365.0;
+    double spins_per_hour = 40.0;
+    double spin_jitter = 0.2;           // spin interval varies by up to +-20%
+    double arrivals_per_hour = 900.0;   // floor-wide, at the busiest hour
+    // arrival rate by hour of day, relative to the busiest
+    std::array<double, 24> profile = { 0.55, 0.45, 0.35, 0.25, 0.15, 0.10, 0.10, 0.12, 0.15, 0.20, 0.25, 0.30,
+                                       0.35, 0.40, 0.45, 0.50, 0.55, 0.65, 0.75, 0.85, 0.95, 1.00, 0.90, 0.70 };
+    double session_minutes = 90.0;      // mean planned stay
+    double switch_chance = 0.01;        // per spin, for each seated player
+    double median_bankroll = 400.0;
+    double shift_minutes = 60.0;        // dealer time at a table between breaks
+    double break_minutes = 20.0;
+    double changeover_minutes = 1.0;    // no spins while dealers swap
+    int relief_dealers = 70;
+    uint64_t seed = 1;
+};
+
+struct FloorReport {
+    struct Hour {
+        uint64_t arrivals = 0, balked = 0;
+        double handle = 0.0, paid = 0.0;
+        double seated = 0.0, busy_tables = 0.0, closed_tables = 0.0;    // sums over samples
+        uint64_t samples = 0;
+    };
+
+    double days = 0.0;
+    uint64_t events = 0;
+    uint64_t spins = 0, bets = 0;
+    uint64_t arrivals = 0, balked = 0, broke = 0, switches = 0, sessions = 0;
+    double handle = 0.0, paid = 0.0;
+    double handle_by_wheel[2] = {};     // European, American
+    double paid_by_wheel[2] = {};
+    uint64_t breaks = 0, relief_shortages = 0;
+    double closed_table_hours = 0.0;    // changeovers and tables left without a dealer
+    std::array<Hour, 24> by_hour{};
+};
+
+class FloorSim {
+public:
+    explicit FloorSim(const FloorConfig& cfg) : cfg_(cfg), rng_(cfg.seed) {
+        const size_t n = (size_t)cfg_.tables;
+        std::bernoulli_distribution american(cfg_.american_share);
+        for (size_t t = 0; t < n; ++t) {
+            const bool us = american(rng_);
+            wheel_.emplace_back(us ? Wheel::Type::American : Wheel::Type::European, rng_());
+            american_.push_back(us);
+            static const double MIN_BETS[10] = { 5, 5, 5, 5, 10, 10, 10, 25, 25, 100 };
+            min_bet_.push_back(MIN_BETS[t % 10]);
+        }
+        dealer_.assign(n, 1);
+        open_.assign(n, 1);
+        spin_gen_.assign(n, 0);
+        seated_.assign(n, 0);
+        closed_since_.assign(n, 0);
+        seat_.assign(n * (size_t)cfg_.seats, NONE);
+        relief_free_ = cfg_.relief_dealers;
+    }
+
+    FloorReport run() {
+        const uint64_t end = (uint64_t)(cfg_.days * DAY);
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        wheel_events_.schedule(0, Event{ Kind::Arrive, 0, 0 });
+        wheel_events_.schedule(0, Event{ Kind::Sample, 0, 0 });
+        for (uint32_t t = 0; t < (uint32_t)cfg_.tables; ++t) {
+            wheel_events_.schedule((uint64_t)(u(rng_) * spin_interval()), Event{ Kind::Spin, t, 0 });
+            wheel_events_.schedule((uint64_t)(u(rng_) * cfg_.shift_minutes * MINUTE), Event{ Kind::Break, t, 0 });
+        }
+        report_.days = cfg_.days;
+        report_.events = wheel_events_.run_until(end, [this](uint64_t now, const Event& e) { handle(now, e); });
+        for (uint32_t t = 0; t < (uint32_t)cfg_.tables; ++t)
+            if (!open_[t]) report_.closed_table_hours += (double)(end - closed_since_[t]) / HOUR;
+        return report_;
+    }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+    static constexpr uint64_t MINUTE = 60'000, HOUR = 60 * MINUTE, DAY = 24 * HOUR;
+
+    enum class Kind : uint8_t { Arrive, Spin, Leave, Break, Return, Resume, Sample };
+    struct Event {
+        Kind kind;
+        uint32_t id;                    // table or player
+        uint32_t gen;                   // stale if it no longer matches
+    };
+
+    void handle(uint64_t now, const Event& e) {
+        switch (e.kind) {
+            case Kind::Arrive: return arrive(now);
+            case Kind::Spin:   return spin(now, e.id, e.gen);
+            case Kind::Leave:  if (gen_[e.id] == e.gen) leave(e.id); return;
+            case Kind::Break:  return dealer_break(now, e.id);
+            case Kind::Return: return dealer_return(now);
+            case Kind::Resume: return resume(now, e.id);
+            case Kind::Sample: return sample(now);
+        }
+    }
+
+    double spin_interval() const { return HOUR / cfg_.spins_per_hour; }
+    static size_t hour_of(uint64_t now) { return (size_t)(now / HOUR % 24); }
+
+    // ---------- tables ----------
+    void spin(uint64_t now, uint32_t t, uint32_t gen) {
+        if (gen != spin_gen_[t] || !open_[t]) return;
+        const int idx = wheel_[t].spin_index();
+        ++report_.spins;
+        FloorReport::Hour& h = report_.by_hour[hour_of(now)];
+        std::bernoulli_distribution moves(cfg_.switch_chance);
+        for (int s = 0; s < cfg_.seats; ++s) {
+            const uint32_t p = seat_[t * (size_t)cfg_.seats + s];
+            if (p == NONE) continue;
+            const double amount = min_bet_[t] * chips_[p];
+            if (amount > bankroll_[p]) {
+                ++report_.broke;
+                leave(p);
+                continue;
+            }
+            const double paid = (mask_[p] >> idx) & 1 ? amount * (odds_[p] + 1.0) : 0.0;
+            bankroll_[p] += paid - amount;
+            ++report_.bets;
+            report_.handle += amount;
+            report_.paid += paid;
+            report_.handle_by_wheel[american_[t]] += amount;
+            report_.paid_by_wheel[american_[t]] += paid;
+            h.handle += amount;
+            h.paid += paid;
+            if (moves(rng_)) {
+                const uint32_t to = pick_table(bankroll_[p], t);
+                if (to != NONE) {
+                    stand(p);
+                    sit(p, to);
+                    ++report_.switches;
+                }
+            }
+        }
+        const double jitter = std::uniform_real_distribution<double>(-cfg_.spin_jitter, cfg_.spin_jitter)(rng_);
+        wheel_events_.schedule(now + (uint64_t)(spin_interval() * (1.0 + jitter)), Event{ Kind::Spin, t, gen });
+    }
+
+    void close(uint64_t now, uint32_t t) {
+        open_[t] = 0;
+        ++spin_gen_[t];                 // cuts the running spin chain
+        closed_since_[t] = now;
+    }
+
+    void resume(uint64_t now, uint32_t t) {
+        open_[t] = 1;
+        report_.closed_table_hours += (double)(now - closed_since_[t]) / HOUR;
+        wheel_events_.schedule(now + (uint64_t)spin_interval(), Event{ Kind::Spin, t, spin_gen_[t] });
+    }
+
+    // ---------- dealers ----------
+    void dealer_break(uint64_t now, uint32_t t) {
+        ++report_.breaks;
+        close(now, t);
+        wheel_events_.schedule(now + (uint64_t)(cfg_.break_minutes * MINUTE), Event{ Kind::Return, 0, 0 });
+        if (relief_free_ > 0) {
+            --relief_free_;
+            relieve(now, t);
+        } else {
+            ++report_.relief_shortages;
+            dealer_[t] = 0;
+            waiting_.push_back(t);
+        }
+    }
+
+    void dealer_return(uint64_t now) {
+        if (waiting_.empty()) {
+            ++relief_free_;
+            return;
+        }
+        const uint32_t t = waiting_.front();
+        waiting_.pop_front();
+        dealer_[t] = 1;
+        relieve(now, t);
+    }
+
+    void relieve(uint64_t now, uint32_t t) {
+        const uint64_t back = now + (uint64_t)(cfg_.changeover_minutes * MINUTE);
+        wheel_events_.schedule(back, Event{ Kind::Resume, t, 0 });
+        wheel_events_.schedule(back + (uint64_t)(cfg_.shift_minutes * MINUTE), Event{ Kind::Break, t, 0 });
+    }
+
+    // ---------- players ----------
+    void arrive(uint64_t now) {
+        const double peak = *std::max_element(cfg_.profile.begin(), cfg_.profile.end());
+        const double rate = cfg_.arrivals_per_hour * peak / HOUR;       // per ms
+        if (rate > 0.0)
+            wheel_events_.schedule(now + 1 + (uint64_t)std::exponential_distribution<double>(rate)(rng_),
+                                   Event{ Kind::Arrive, 0, 0 });
+        // thinning: the candidate stream runs at the peak rate
+        const size_t hour = hour_of(now);
+        if (std::uniform_real_distribution<double>(0.0, peak)(rng_) >= cfg_.profile[hour]) return;
+
+        ++report_.arrivals;
+        ++report_.by_hour[hour].arrivals;
+        const double bankroll =
+            std::lognormal_distribution<double>(std::log(cfg_.median_bankroll), 0.8)(rng_);
+        const uint32_t t = pick_table(bankroll, NONE);
+        if (t == NONE) {
+            ++report_.balked;
+            ++report_.by_hour[hour].balked;
+            return;
+        }
+
+        uint32_t p;
+        if (!free_.empty()) {
+            p = free_.back();
+            free_.pop_back();
+        } else {
+            p = (uint32_t)bankroll_.size();
+            bankroll_.push_back(0.0);
+            chips_.push_back(1);
+            mask_.push_back(0);
+            odds_.push_back(0.0);
+            table_.push_back(NONE);
+            seat_ix_.push_back(0);
+            gen_.push_back(0);
+        }
+        const Decision d = Decision::place(favourite_bet());
+        bankroll_[p] = bankroll;
+        chips_[p] = (uint8_t)(1 + std::geometric_distribution<int>(0.5)(rng_) % 8);
+        mask_[p] = d.mask;
+        odds_[p] = d.odds;
+        sit(p, t);
+        const double stay = std::exponential_distribution<double>(1.0 / cfg_.session_minutes)(rng_);
+        wheel_events_.schedule(now + (uint64_t)(stay * MINUTE), Event{ Kind::Leave, p, gen_[p] });
+    }
+
+    void leave(uint32_t p) {
+        stand(p);
+        ++gen_[p];                      // voids the pending Leave
+        free_.push_back(p);
+        ++report_.sessions;
+    }
+
+    void sit(uint32_t p, uint32_t t) {
+        uint32_t* row = &seat_[t * (size_t)cfg_.seats];
+        int s = 0;
+        while (row[s] != NONE) ++s;     // pick_table() checked there is room
+        row[s] = p;
+        table_[p] = t;
+        seat_ix_[p] = (uint8_t)s;
+        if (seated_[t]++ == 0) ++busy_tables_;
+        ++players_seated_;
+    }
+
+    void stand(uint32_t p) {
+        const uint32_t t = table_[p];
+        seat_[t * (size_t)cfg_.seats + seat_ix_[p]] = NONE;
+        table_[p] = NONE;
+        if (--seated_[t] == 0) --busy_tables_;
+        --players_seated_;
+    }
+
+    // A staffed table with a free seat and a minimum the bankroll can stand
+    // (ten bets' worth); a few random looks, as a player walking the floor.
+    uint32_t pick_table(double bankroll, uint32_t except) {
+        std::uniform_int_distribution<uint32_t> any(0, (uint32_t)cfg_.tables - 1);
+        for (int tries = 0; tries < 12; ++tries) {
+            const uint32_t t = any(rng_);
+            if (t != except && dealer_[t] && seated_[t] < cfg_.seats && min_bet_[t] * 10.0 <= bankroll) return t;
+        }
+        return NONE;
+    }
+
+    Bet favourite_bet() {
+        std::uniform_int_distribution<int> pct(0, 99), third(1, 3), row(0, 10), col(1, 2);
+        const int r = pct(rng_);
+        if (r < 50) {
+            static const Bet::Type EVEN_MONEY[] = { Bet::Type::Red, Bet::Type::Black, Bet::Type::Odd,
+                                                    Bet::Type::Even, Bet::Type::High, Bet::Type::Low };
+            return Bet(EVEN_MONEY[r % 6], "", 1.0);
+        }
+        if (r < 70) return Bet(r % 2 ? Bet::Type::Dozen : Bet::Type::Column, std::to_string(third(rng_)), 1.0);
+        if (r < 85) return Bet(Bet::Type::Straight, std::to_string(std::uniform_int_distribution<int>(0, 36)(rng_)), 1.0);
+        const int n = row(rng_) * 3 + col(rng_);                 // 1..32, not in the third column
+        if (r < 93) return Bet(Bet::Type::Split, std::to_string(n) + "-" + std::to_string(n + 1), 1.0);
+        return Bet(Bet::Type::Corner, std::to_string(n), 1.0);
+    }
+
+    // ---------- sampling ----------
+    void sample(uint64_t now) {
+        FloorReport::Hour& h = report_.by_hour[hour_of(now)];
+        h.seated += players_seated_;
+        h.busy_tables += busy_tables_;
+        h.closed_tables += (double)std::count(open_.begin(), open_.end(), 0);
+        ++h.samples;
+        wheel_events_.schedule(now + 10 * MINUTE, Event{ Kind::Sample, 0, 0 });
+    }
+
+    FloorConfig cfg_;
+    std::mt19937_64 rng_;
+    TimingWheel<Event> wheel_events_;
+    FloorReport report_;
+
+    // tables
+    std::vector<Wheel> wheel_;
+    std::vector<uint8_t> american_;
+    std::vector<double> min_bet_;
+    std::vector<uint8_t> dealer_;       // has a dealer (or one on the way)
+    std::vector<uint8_t> open_;         // spinning
+    std::vector<uint32_t> spin_gen_;
+    std::vector<uint8_t> seated_;
+    std::vector<uint64_t> closed_since_;
+    std::vector<uint32_t> seat_;        // tables x seats player ids
+    int relief_free_ = 0;
+    std::deque<uint32_t> waiting_;      // tables waiting for a dealer
+    uint64_t players_seated_ = 0;
+    uint64_t busy_tables_ = 0;
+
+    // players
+    std::vector<double> bankroll_;
+    std::vector<uint8_t> chips_;        // bet size in table minimums
+    std::vector<uint64_t> mask_;
+    std::vector<double> odds_;
+    std::vector<uint32_t> table_;
+    std::vector<uint8_t> seat_ix_;
+    std::vector<uint32_t> gen_;
+    std::vector<uint32_t> free_;
+};
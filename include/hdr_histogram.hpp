@@ -0,0 +1,108 @@
+// hdr_histogram.hpp
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/**
+ * High-dynamic-range histogram of non-negative integer values (typically
+ * nanoseconds), after Gil Tene's HdrHistogram.
+ *
+ * Values below 2^S are counted exactly; above that, each power-of-two range
+ * is split into 2^(S-1) equal buckets, so every recorded value is kept to a
+ * relative error under 2^-(S-1) (S = 11: about 0.1%, three significant
+ * digits) across the whole range. Recording is a count-leading-zeros, a
+ * shift and an increment; histograms of the same shape merge by adding
+ * counts, so each thread keeps its own and they are combined at the end.
+ */
+
+class HdrHistogram {
+public:
+    // Tracks 0 .. 2^max_bits - 1; larger values are clamped to the top.
+    explicit HdrHistogram(int sub_bucket_bits = 11, int max_bits = 40)
+    : sub_bits_(sub_bucket_bits), half_(uint64_t{1} << (sub_bucket_bits - 1)),
+      max_value_((uint64_t{1} << max_bits) - 1),
+      counts_(index_of((uint64_t{1} << max_bits) - 1) + 1, 0) {}
+
+    void record(uint64_t v, uint64_t n = 1) {
+        v = std::min(v, max_value_);
+        counts_[index_of(v)] += n;
+        total_ += n;
+        sum_ += (double)v * (double)n;
+        min_ = std::min(min_, v);
+        max_ = std::max(max_, v);
+    }
+
+    // Adds `o`'s counts; both must have been built with the same shape.
+    void merge(const HdrHistogram& o) {
+        for (size_t i = 0; i < counts_.size() && i < o.counts_.size(); ++i) counts_[i] += o.counts_[i];
+        total_ += o.total_;
+        sum_ += o.sum_;
+        min_ = std::min(min_, o.min_);
+        max_ = std::max(max_, o.max_);
+    }
+
+    void reset() {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        total_ = 0;
+        sum_ = 0.0;
+        min_ = UINT64_MAX;
+        max_ = 0;
+    }
+
+    uint64_t count() const { return total_; }
+    uint64_t min() const { return total_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return total_ ? sum_ / (double)total_ : 0.0; }
+
+    // Smallest recorded value v such that `p` percent of values are <= v,
+    // to the histogram's precision (the top of v's bucket, capped at max()).
+    uint64_t percentile(double p) const {
+        if (!total_) return 0;
+        const uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(p / 100.0 * (double)total_));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            seen += counts_[i];
+            if (seen >= rank) return std::min(highest_equivalent(i), max_);
+        }
+        return max_;
+    }
+
+    // Bucket-by-bucket walk for exporters: fn(upper bound, count) for every
+    // non-empty bucket, in increasing order.
+    template <class F>
+    void for_each_bucket(F&& fn) const {
+        for (size_t i = 0; i < counts_.size(); ++i)
+            if (counts_[i]) fn(highest_equivalent(i), counts_[i]);
+    }
+
+    // The bucket layout, for recorders that keep their own counts (one
+    // array per thread, say) and fold them into a histogram to report.
+    size_t buckets() const { return counts_.size(); }
+    size_t bucket_of(uint64_t v) const { return index_of(std::min(v, max_value_)); }
+    uint64_t bucket_value(size_t i) const { return highest_equivalent(i); }
+
+private:
+    size_t index_of(uint64_t v) const {
+        if (v < 2 * half_) return (size_t)v;
+        const int e = 63 - __builtin_clzll(v) - (sub_bits_ - 1);
+        return (size_t)((uint64_t)e * half_ + (v >> e));
+    }
+
+    uint64_t highest_equivalent(size_t i) const {
+        if (i < 2 * half_) return i;
+        const int e = (int)(i / half_) - 1;
+        const uint64_t sub = i - (uint64_t)e * half_;
+        return ((sub + 1) << e) - 1;
+    }
+
+    int sub_bits_;
+    uint64_t half_;
+    uint64_t max_value_;
+    std::vector<uint64_t> counts_;
+    uint64_t total_ = 0;
+    double sum_ = 0.0;
+    uint64_t min_ = UINT64_MAX;
+    uint64_t max_ = 0;
+};
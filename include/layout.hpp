@@ -0,0 +1,282 @@
+// layout.hpp
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "bet.hpp"
+#include "roulette.hpp"
+
+/**
+ * Chip layout search.
+ *
+ * Answers "which bets cover exactly these numbers with the fewest chips?"
+ * and "with N chips on these numbers, what layout pays best on the worst
+ * of them?". Every legal inside and outside bet is a 38-bit coverage mask
+ * (bit i = table index i, 37 = "00"); a layout is a multiset of one-chip
+ * bets (stacking allowed), and pocket x pays the sum of (odds + 1) over the
+ * bets covering it, minus the chips on the table.
+ *
+ * Both goals run depth-first branch and bound:
+ *  - branch only on bets covering the pocket that is currently the problem
+ *    (the lowest one short of the requirement, or the worst-paid one), since
+ *    any better layout has to add a bet there;
+ *  - prune when even stacking the best remaining bet on every short pocket
+ *    can't get there, when the payout still missing across the target
+ *    exceeds what the remaining chips can add, or when uncovered pockets
+ *    outnumber what the remaining chips can reach;
+ *  - skip multisets already seen (additive Zobrist hash of the bet counts).
+ * Min-chips search deepens the chip count one at a time, so the first
+ * layout found is minimal.
+ */
+
+struct LayoutQuery {
+    enum class Goal { MinChips, MaxMinPayout };
+
+    uint64_t target = 0;            // pockets to cover
+    Wheel::Type wheel = Wheel::Type::American;
+    Goal goal = Goal::MinChips;
+    bool exact = true;              // no bet may touch a pocket outside target
+    int min_profit = 0;             // MinChips: every target pocket must net at least this (chips)
+    int max_chips = 12;             // MinChips gives up past this; MaxMinPayout's budget
+    uint64_t max_nodes = 200'000;   // search budget; best layout so far is returned past it
+};
+
+struct Layout {
+    bool found = false;
+    std::vector<Bet> bets;          // one chip each; repeats mean stacked chips
+    int chips = 0;
+    int min_profit = 0;             // worst net result over the target pockets, in chips
+    uint64_t nodes = 0;
+    bool exhausted = true;          // false if max_nodes cut the search short
+};
+
+// Target mask from numbers; use 37 for "00" and 38 for "000".
+inline uint64_t pocket_mask(std::initializer_list<int> numbers) {
+    uint64_t m = 0;
+    for (int n : numbers) if (n >= 0 && n <= 38) m |= uint64_t{1} << n;
+    return m;
+}
+
+// Every bet a chip can legally sit on, with its coverage mask.
+inline std::vector<Bet> legal_bets(Wheel::Type wheel) {
+    std::vector<Bet> v;
+    auto add = [&](Bet::Type t, std::string s) { v.emplace_back(t, s, 1.0); };
+
+    add(Bet::Type::Straight, "0");
+    if (wheel != Wheel::Type::European) add(Bet::Type::Straight, "00");
+    if (wheel == Wheel::Type::TripleZero) add(Bet::Type::Straight, "000");
+    for (int n = 1; n <= 36; ++n) add(Bet::Type::Straight, std::to_string(n));
+    for (int n = 1; n <= 36; ++n) {
+        if (n % 3 != 0) add(Bet::Type::Split, std::to_string(n) + "-" + std::to_string(n + 1));
+        if (n <= 33)    add(Bet::Type::Split, std::to_string(n) + "-" + std::to_string(n + 3));
+    }
+    for (int n = 1; n <= 34; n += 3) add(Bet::Type::Street, std::to_string(n));
+    // splits and trios with the greens, as each layout has them (none on
+    // a triple-zero table, see table_coverage_mask)
+    if (wheel == Wheel::Type::American) {
+        for (const char* s : { "0-00", "0-1", "0-2", "00-2", "00-3" }) add(Bet::Type::Split, s);
+        for (const char* s : { "0-1-2", "0-00-2", "00-2-3" }) add(Bet::Type::Street, s);
+    } else if (wheel == Wheel::Type::European) {
+        for (const char* s : { "0-1", "0-2", "0-3" }) add(Bet::Type::Split, s);
+        for (const char* s : { "0-1-2", "0-2-3" }) add(Bet::Type::Street, s);
+    }
+    for (int n = 1; n <= 32; ++n) if (n % 3 != 0) add(Bet::Type::Corner, std::to_string(n));
+    for (int n = 1; n <= 31; n += 3) add(Bet::Type::SixLine, std::to_string(n));
+    for (const char* s : { "1", "2", "3" }) { add(Bet::Type::Column, s); add(Bet::Type::Dozen, s); }
+    for (Bet::Type t : { Bet::Type::Red, Bet::Type::Black, Bet::Type::Odd,
+                         Bet::Type::Even, Bet::Type::Low, Bet::Type::High })
+        add(t, "");
+    return v;
+}
+
+class LayoutSearch {
+public:
+    explicit LayoutSearch(const LayoutQuery& q) : q_(q) {
+        for (const Bet& b : legal_bets(q_.wheel)) {
+            uint64_t m = coverage_mask(b);
+            if (!(m & q_.target)) continue;
+            if (q_.exact && (m & ~q_.target)) continue;
+            cands_.push_back(Cand{ b, m, (int)b.payout_odds + 1 });
+        }
+
+        std::mt19937_64 rng(0x5eed);
+        for (Cand& c : cands_) c.zobrist = rng();
+
+        for (uint64_t t = q_.target; t; t &= t - 1) {
+            int x = __builtin_ctzll(t);
+            targets_.push_back(x);
+            for (size_t i = 0; i < cands_.size(); ++i)
+                if ((cands_[i].mask >> x) & 1) {
+                    covering_[x].push_back((int)i);
+                    max_pay_[x] = std::max(max_pay_[x], cands_[i].pay);
+                }
+        }
+        for (const Cand& c : cands_) {
+            const int cover = __builtin_popcountll(c.mask & q_.target);
+            max_cover_ = std::max(max_cover_, cover);
+            max_gain_  = std::max(max_gain_, cover * c.pay);
+        }
+
+        // min-chips tries wide bets first, they close coverage sooner;
+        // max-payout tries the bets that waste least payout off the target
+        auto key = [&](int i) {
+            const Cand& c = cands_[i];
+            const int cover = __builtin_popcountll(c.mask & q_.target);
+            return q_.goal == LayoutQuery::Goal::MinChips
+                ? cover * 64 - __builtin_popcountll(c.mask)
+                : cover * c.pay * 64 - __builtin_popcountll(c.mask & ~q_.target);
+        };
+        for (auto& list : covering_)
+            std::stable_sort(list.begin(), list.end(), [&](int a, int b) { return key(a) > key(b); });
+    }
+
+    Layout run() {
+        Layout out;
+        if (targets_.empty()) return out;
+        for (int x : targets_) if (covering_[x].empty()) return out;    // nothing legal covers x
+
+        if (q_.goal == LayoutQuery::Goal::MinChips) {
+            for (int k = 1; k <= q_.max_chips && !found_ && !over_budget(); ++k) {
+                budget_ = k;
+                seen_.clear();
+                min_chips(0, 0);
+            }
+        } else {
+            budget_ = q_.max_chips;
+            best_value_ = INT32_MIN;
+            max_payout(0, 0);
+        }
+
+        out.found = found_;
+        out.nodes = nodes_;
+        out.exhausted = !over_budget();
+        if (found_) {
+            for (int i : best_) out.bets.push_back(cands_[i].bet);
+            out.chips = (int)best_.size();
+            out.min_profit = worst_profit(best_);
+        }
+        return out;
+    }
+
+private:
+    struct Cand {
+        Bet bet;
+        uint64_t mask;
+        int pay;                // odds + 1 per chip
+        uint64_t zobrist = 0;
+    };
+
+    bool over_budget() const { return nodes_ >= q_.max_nodes; }
+
+    void push(int i) {
+        const Cand& c = cands_[i];
+        for (uint64_t t = c.mask & q_.target; t; t &= t - 1) pay_[__builtin_ctzll(t)] += c.pay;
+        stack_.push_back(i);
+    }
+    void pop() {
+        const Cand& c = cands_[stack_.back()];
+        for (uint64_t t = c.mask & q_.target; t; t &= t - 1) pay_[__builtin_ctzll(t)] -= c.pay;
+        stack_.pop_back();
+    }
+
+    int worst_profit(const std::vector<int>& bets) const {
+        std::array<int, 38> pay{};
+        for (int i : bets)
+            for (uint64_t t = cands_[i].mask & q_.target; t; t &= t - 1) pay[__builtin_ctzll(t)] += cands_[i].pay;
+        int worst = INT32_MAX;
+        for (int x : targets_) worst = std::min(worst, pay[x] - (int)bets.size());
+        return worst;
+    }
+
+    // fewer chips can't cover this many uncovered pockets
+    bool coverage_prunes(int left) const {
+        int uncovered = 0;
+        for (int x : targets_) uncovered += pay_[x] == 0;
+        return uncovered > left * max_cover_;
+    }
+
+    bool visit(uint64_t h) { return seen_.insert(h).second; }
+
+    void min_chips(int used, uint64_t h) {
+        if (found_ || over_budget()) return;
+        ++nodes_;
+
+        const int need = budget_ + q_.min_profit;      // payout each target pocket needs at budget_ chips
+        const int left = budget_ - used;
+        int short_x = -1, deficit = 0;
+        for (int x : targets_) {
+            if (pay_[x] >= need) continue;
+            if (pay_[x] + left * max_pay_[x] < need) return;    // can't get there
+            if (short_x < 0) short_x = x;
+            deficit += need - pay_[x];
+        }
+        if (short_x < 0) { found_ = true; best_ = stack_; return; }
+        if (deficit > left * max_gain_) return;                 // not enough payout left in the chips
+        if (left == 0 || coverage_prunes(left)) return;
+
+        for (int i : covering_[short_x]) {
+            uint64_t nh = h + cands_[i].zobrist;
+            if (!visit(nh)) continue;
+            push(i);
+            min_chips(used + 1, nh);
+            pop();
+            if (found_) return;
+        }
+    }
+
+    void max_payout(int used, uint64_t h) {
+        if (over_budget()) return;
+        ++nodes_;
+
+        int worst_x = -1, worst = INT32_MAX, bound = INT32_MAX, total = 0;
+        const int left = budget_ - used;
+        for (int x : targets_) {
+            if (pay_[x] < worst) { worst = pay_[x]; worst_x = x; }
+            bound = std::min(bound, pay_[x] + left * max_pay_[x]);
+            total += pay_[x];
+        }
+        // the worst pocket can't beat the average either
+        bound = std::min(bound, (total + left * max_gain_) / (int)targets_.size());
+
+        if (used > 0 && worst > 0 && worst - used > best_value_) {
+            best_value_ = worst - used;
+            best_ = stack_;
+            found_ = true;
+        }
+        if (left == 0 || bound - used <= best_value_) return;
+        if (coverage_prunes(left)) return;
+
+        for (int i : covering_[worst_x]) {
+            uint64_t nh = h + cands_[i].zobrist;
+            if (!visit(nh)) continue;
+            push(i);
+            max_payout(used + 1, nh);
+            pop();
+        }
+    }
+
+    LayoutQuery q_;
+    std::vector<Cand> cands_;
+    std::vector<int> targets_;
+    std::array<std::vector<int>, 38> covering_;
+    std::array<int, 38> max_pay_{};
+    int max_cover_ = 1;         // most target pockets one bet covers
+    int max_gain_ = 0;          // most payout one chip adds across the target
+
+    // search state
+    std::array<int, 38> pay_{};
+    std::vector<int> stack_, best_;
+    std::unordered_set<uint64_t> seen_;
+    int budget_ = 0;
+    int best_value_ = 0;
+    bool found_ = false;
+    uint64_t nodes_ = 0;
+};
+
+inline Layout find_layout(const LayoutQuery& q) {
+    return LayoutSearch(q).run();
+}
@@ -0,0 +1,271 @@
+// ledger.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "mpsc_queue.hpp"
+#include "trace.hpp"
+
+#if defined(ROULETTE_IO_URING) && __has_include(<liburing.h>)
+#include <liburing.h>
+#define LEDGER_IO_URING 1
+#endif
+
+/**
+ * Write-ahead ledger for balance mutations and bet events.
+ *
+ * Table threads append fixed 64-byte records into a lock-free queue and get
+ * the record's LSN back immediately; nothing on their side touches the disk.
+ * One writer thread drains whatever has piled up, writes it in a single
+ * call and syncs once (group commit), then publishes the new durable LSN and
+ * tells the owner through `on_durable`. Callers hold acknowledgments until
+ * durable_lsn() covers them, so at N appends per sync the cost of fsync is
+ * shared N ways.
+ *
+ * Build with -DROULETTE_IO_URING -luring to submit each batch's write and
+ * fdatasync to io_uring as one linked pair instead of two syscalls.
+ *
+ * Records carry an FNV-1a check so replay stops cleanly at a torn tail;
+ * opening the ledger truncates such a tail, so records appended after a
+ * crash follow straight on from the last intact one. A failed write or
+ * sync throws on the writer thread and ends the process, since nothing it
+ * wrote may be acknowledged.
+ */
+
+struct LedgerRecord {
+    enum class Kind : uint8_t { Sit = 1, Leave, Place, Cancel, Modify, Settle, Spin };
+
+    uint64_t lsn = 0;           // filled in by the writer
+    uint64_t ref = 0;           // bet handle; round for Settle and Spin
+    double amount = 0.0;        // stake, refund, new stake or payout; pocket index for Spin
+    double balance = 0.0;       // player's balance after the event
+    uint32_t table = 0;
+    uint32_t seat = 0;
+    Kind kind = Kind::Sit;
+    uint8_t bet_type = 0;       // Bet::Type for Place
+    uint16_t reserved = 0;
+    uint32_t check = 0;
+    char text[16] = {};         // bet selection, or player name for Sit (truncated)
+};
+static_assert(sizeof(LedgerRecord) == 64, "ledger records are a fixed 64 bytes on disk");
+
+inline uint32_t record_check(const LedgerRecord& r) {
+    LedgerRecord c = r;
+    c.check = 0;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(&c);
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < sizeof c; ++i) h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+inline void set_record_text(LedgerRecord& r, const std::string& s) {
+    std::memset(r.text, 0, sizeof r.text);
+    std::memcpy(r.text, s.data(), std::min(s.size(), sizeof r.text - 1));
+}
+
+struct LedgerConfig {
+    std::string path;
+    size_t queue_capacity = 1 << 18;                // records in flight before append() has to wait
+    std::function<void(uint64_t)> on_durable;       // writer thread, after every sync
+    std::function<void(size_t, std::chrono::nanoseconds)> on_commit;   // writer thread: records and write+sync time
+};
+
+// Calls fn(const LedgerRecord&) for every intact record after `after_lsn`,
+// in order; stops at the first torn or corrupt one. Returns the last LSN seen.
+template <class F>
+uint64_t replay_ledger(const std::string& path, uint64_t after_lsn, F&& fn) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return after_lsn;
+    uint64_t last = after_lsn;
+    ::lseek(fd, (off_t)(after_lsn * sizeof(LedgerRecord)), SEEK_SET);
+    std::vector<LedgerRecord> buf(4096);
+    for (bool done = false; !done;) {
+        ssize_t n = ::read(fd, buf.data(), buf.size() * sizeof(LedgerRecord));
+        if (n <= 0) break;
+        const size_t count = (size_t)n / sizeof(LedgerRecord);
+        for (size_t i = 0; i < count; ++i) {
+            const LedgerRecord& r = buf[i];
+            if (r.lsn != last + 1 || r.check != record_check(r)) { done = true; break; }
+            last = r.lsn;
+            fn(r);
+        }
+        if (count * sizeof(LedgerRecord) != (size_t)n) break;
+    }
+    ::close(fd);
+    return last;
+}
+
+class Ledger {
+public:
+    explicit Ledger(const LedgerConfig& cfg) : cfg_(cfg), queue_(cfg.queue_capacity) {
+        fd_ = ::open(cfg_.path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0) throw std::runtime_error("ledger open failed: " + std::string(std::strerror(errno)));
+        // Cut the file back to its last intact record: a torn, zeroed or
+        // corrupt tail would otherwise stop replay before everything
+        // appended after it.
+        base_lsn_ = replay_ledger(cfg_.path, 0, [](const LedgerRecord&) {});
+        off_ = (off_t)(base_lsn_ * sizeof(LedgerRecord));
+        if (::lseek(fd_, 0, SEEK_END) != off_ && (::ftruncate(fd_, off_) != 0 || !sync()))
+            throw std::runtime_error("ledger truncate failed: " + std::string(std::strerror(errno)));
+        durable_.store(base_lsn_);
+#if defined(LEDGER_IO_URING)
+        if (io_uring_queue_init(8, &ring_, 0) != 0) throw std::runtime_error("io_uring init failed");
+#endif
+        writer_ = std::thread([this] { write_loop(); });
+    }
+
+    ~Ledger() {
+        stopping_.store(true);
+        wake();
+        writer_.join();
+#if defined(LEDGER_IO_URING)
+        io_uring_queue_exit(&ring_);
+#endif
+        ::close(fd_);
+    }
+
+    Ledger(const Ledger&) = delete;
+    Ledger& operator=(const Ledger&) = delete;
+
+    // Any thread; never waits on the disk. Returns the record's LSN. Only
+    // if queue_capacity records are already waiting does it yield until
+    // the writer catches up.
+    uint64_t append(LedgerRecord r) {
+        uint64_t ticket;
+        while (!queue_.try_push(r, &ticket)) {
+            wake();
+            std::this_thread::yield();
+        }
+        wake();
+        return base_lsn_ + ticket + 1;
+    }
+
+    // Every record with lsn <= this is on stable storage.
+    uint64_t durable_lsn() const { return durable_.load(std::memory_order_acquire); }
+
+    // Blocks until `lsn` is durable; for shutdown paths and tools, not tables.
+    void wait_durable(uint64_t lsn) {
+        for (uint64_t d; (d = durable_.load(std::memory_order_acquire)) < lsn;)
+            durable_.wait(d, std::memory_order_acquire);
+    }
+
+    uint64_t syncs() const { return syncs_.load(std::memory_order_relaxed); }
+
+private:
+    // Pairs with the writer's store-then-check before it sleeps; the flag
+    // is only written when the writer is actually asleep.
+    void wake() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed) && sleeping_.exchange(false, std::memory_order_seq_cst))
+            sleeping_.notify_one();
+    }
+
+    void write_loop() {
+        Trace::name_thread("ledger");
+        std::vector<LedgerRecord> batch;
+        batch.reserve(queue_.capacity());
+        uint64_t lsn = base_lsn_;
+        for (;;) {
+            batch.clear();
+            queue_.drain([&](LedgerRecord&& r) {
+                r.lsn = ++lsn;
+                r.check = record_check(r);
+                batch.push_back(r);
+            });
+
+            if (batch.empty()) {
+                if (stopping_.load()) return;
+                sleeping_.store(true, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (queue_.size_approx() == 0 && !stopping_.load()) sleeping_.wait(true, std::memory_order_seq_cst);
+                sleeping_.store(false, std::memory_order_relaxed);
+                continue;
+            }
+
+            TraceSpan span("ledger commit");
+            const auto t0 = std::chrono::steady_clock::now();
+            commit(batch.data(), batch.size() * sizeof(LedgerRecord));
+            if (cfg_.on_commit) cfg_.on_commit(batch.size(), std::chrono::steady_clock::now() - t0);
+            syncs_.fetch_add(1, std::memory_order_relaxed);
+            durable_.store(lsn, std::memory_order_release);
+            durable_.notify_all();
+            if (cfg_.on_durable) cfg_.on_durable(lsn);
+        }
+    }
+
+    // Writes `len` bytes at the end of the file and makes them durable.
+    void commit(const void* data, size_t len) {
+        const char* p = static_cast<const char*>(data);
+#if defined(LEDGER_IO_URING)
+        io_uring_sqe* w = io_uring_get_sqe(&ring_);
+        io_uring_prep_write(w, fd_, p, (unsigned)len, (uint64_t)off_);
+        io_uring_sqe_set_data64(w, 1);
+        w->flags |= IOSQE_IO_LINK;
+        io_uring_sqe* s = io_uring_get_sqe(&ring_);
+        io_uring_prep_fsync(s, fd_, IORING_FSYNC_DATASYNC);
+        io_uring_sqe_set_data64(s, 2);
+        io_uring_submit_and_wait(&ring_, 2);
+        size_t written = 0;
+        bool synced = false;
+        for (int i = 0; i < 2; ++i) {
+            io_uring_cqe* cqe;
+            if (io_uring_wait_cqe(&ring_, &cqe) != 0) break;
+            if (cqe->user_data == 1 && cqe->res > 0) written = (size_t)cqe->res;
+            if (cqe->user_data == 2) synced = cqe->res == 0;
+            io_uring_cqe_seen(&ring_, cqe);
+        }
+        off_ += (off_t)written;
+        if (written == len && synced) return;
+        p += written;           // short write broke the link; finish the slow way
+        len -= written;
+#endif
+        while (len > 0) {
+            ssize_t n = ::pwrite(fd_, p, len, off_);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("ledger write failed: " + std::string(std::strerror(errno)));
+            }
+            p += n;
+            len -= (size_t)n;
+            off_ += n;
+        }
+        // After a failed sync the kernel may already have dropped the dirty
+        // pages, so retrying proves nothing: nothing in the batch may be
+        // acknowledged, and the writer stops here.
+        if (!sync()) throw std::runtime_error("ledger sync failed: " + std::string(std::strerror(errno)));
+    }
+
+    bool sync() {
+#if defined(__APPLE__)
+        return ::fcntl(fd_, F_FULLFSYNC) != -1;     // plain fsync on macOS stops at the drive cache
+#elif defined(__linux__)
+        return ::fdatasync(fd_) == 0;
+#else
+        return ::fsync(fd_) == 0;
+#endif
+    }
+
+    LedgerConfig cfg_;
+    MpscQueue<LedgerRecord> queue_;
+    int fd_ = -1;
+    off_t off_ = 0;
+    uint64_t base_lsn_ = 0;                 // records already in the file at open
+    alignas(64) std::atomic<uint64_t> durable_{0};
+    alignas(64) std::atomic<bool> sleeping_{false};
+    std::atomic<bool> stopping_{false};
+    std::atomic<uint64_t> syncs_{0};
+    std::thread writer_;
+#if defined(LEDGER_IO_URING)
+    io_uring ring_;
+#endif
+};
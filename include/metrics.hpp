@@ -0,0 +1,373 @@
+// metrics.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "hdr_histogram.hpp"
+
+/**
+ * Counters, gauges and latency histograms, exposed in the Prometheus text
+ * format.
+ *
+ * Hot paths write only to their own thread's shard: a counter add is a
+ * relaxed load and store to a line no other thread writes, a histogram
+ * record is the same on one HDR bucket, so neither ever bounces a cache
+ * line or takes a lock. A scrape sums the shards. Shards are made on a
+ * thread's first write, live as long as the registry, and keep counting
+ * after the thread exits.
+ *
+ * Register everything before the threads that record start; ids are plain
+ * indexes. Gauges are callbacks run at scrape time. Histograms take
+ * nanoseconds (or any integer) and are reported as summaries: quantiles
+ * from the HDR buckets (within 1%), exact _sum and _count.
+ *
+ * MetricsExporter serves the text on http://127.0.0.1:<port>/metrics
+ * and/or rewrites a file every so often.
+ */
+
+class MetricsRegistry {
+public:
+    static constexpr size_t MAX_COUNTERS = 256;
+    static constexpr size_t MAX_HISTOGRAMS = 32;
+
+    struct Counter { uint32_t id; };
+    struct Histogram { uint32_t id; };
+
+    MetricsRegistry() : layout_(HIST_SUB_BITS, HIST_MAX_BITS), generation_(next_generation()) {}
+
+    ~MetricsRegistry() {
+        for (auto& s : shards_)
+            for (auto& h : s->hist) delete[] h.buckets.load(std::memory_order_relaxed);
+    }
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    // `labels` is the inside of the braces, e.g. result="accepted".
+    Counter counter(const std::string& name, const std::string& help, const std::string& labels = {}) {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (counters_ == MAX_COUNTERS) throw std::length_error("too many counters");
+        series_.push_back(Series{ family(name, help, "counter"), labels, Kind::Counter, (uint32_t)counters_, 0.0, {} });
+        return Counter{ (uint32_t)counters_++ };
+    }
+
+    // Recorded values are multiplied by `scale` on the way out (1e-9 turns
+    // nanoseconds into the seconds Prometheus expects).
+    Histogram histogram(const std::string& name, const std::string& help, const std::string& labels = {},
+                        double scale = 1e-9) {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (histograms_ == MAX_HISTOGRAMS) throw std::length_error("too many histograms");
+        series_.push_back(Series{ family(name, help, "summary"), labels, Kind::Histogram, (uint32_t)histograms_, scale, {} });
+        return Histogram{ (uint32_t)histograms_++ };
+    }
+
+    void gauge(const std::string& name, const std::string& help, std::function<double()> read,
+               const std::string& labels = {}) {
+        std::lock_guard<std::mutex> lk(mu_);
+        series_.push_back(Series{ family(name, help, "gauge"), labels, Kind::Gauge, 0, 0.0, std::move(read) });
+    }
+
+    // ---------- hot path ----------
+    void add(Counter c, uint64_t n = 1) {
+        std::atomic<uint64_t>& v = shard().counters[c.id];
+        v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void record(Histogram h, uint64_t value) {
+        HistShard& hs = shard().hist[h.id];
+        std::atomic<uint64_t>* b = hs.buckets.load(std::memory_order_relaxed);
+        if (!b) {
+            b = new std::atomic<uint64_t>[layout_.buckets()]();
+            hs.buckets.store(b, std::memory_order_release);
+        }
+        std::atomic<uint64_t>& n = b[layout_.bucket_of(value)];
+        n.store(n.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        hs.sum.store(hs.sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    // ---------- reading (any thread) ----------
+    uint64_t value(Counter c) const {
+        std::lock_guard<std::mutex> lk(mu_);
+        uint64_t n = 0;
+        for (auto& s : shards_) n += s->counters[c.id].load(std::memory_order_relaxed);
+        return n;
+    }
+
+    HdrHistogram snapshot(Histogram h) const {
+        std::lock_guard<std::mutex> lk(mu_);
+        return merged(h.id);
+    }
+
+    // Everything in the Prometheus text exposition format (version 0.0.4).
+    std::string expose() const {
+        std::lock_guard<std::mutex> lk(mu_);
+        std::string out;
+        char line[512];
+        for (size_t f = 0; f < families_.size(); ++f) {
+            const Family& fam = families_[f];
+            out += "# HELP " + fam.name + " " + fam.help + "\n";
+            out += "# TYPE " + fam.name + " " + fam.type + "\n";
+            for (const Series& s : series_) {
+                if (s.family != f) continue;
+                const std::string braces = s.labels.empty() ? "" : "{" + s.labels + "}";
+                switch (s.kind) {
+                    case Kind::Counter: {
+                        uint64_t n = 0;
+                        for (auto& sh : shards_) n += sh->counters[s.index].load(std::memory_order_relaxed);
+                        std::snprintf(line, sizeof line, "%s%s %llu\n", fam.name.c_str(), braces.c_str(),
+                                      (unsigned long long)n);
+                        out += line;
+                        break;
+                    }
+                    case Kind::Gauge:
+                        std::snprintf(line, sizeof line, "%s%s %.17g\n", fam.name.c_str(), braces.c_str(), s.read());
+                        out += line;
+                        break;
+                    case Kind::Histogram: {
+                        const HdrHistogram h = merged(s.index);
+                        uint64_t sum = 0;
+                        for (auto& sh : shards_) sum += sh->hist[s.index].sum.load(std::memory_order_relaxed);
+                        const std::string sep = s.labels.empty() ? "" : s.labels + ",";
+                        for (double q : { 0.5, 0.9, 0.99, 0.999, 1.0 }) {
+                            std::snprintf(line, sizeof line, "%s{%squantile=\"%g\"} %.9g\n", fam.name.c_str(),
+                                          sep.c_str(), q, h.percentile(q * 100.0) * s.scale);
+                            out += line;
+                        }
+                        std::snprintf(line, sizeof line, "%s_sum%s %.9g\n%s_count%s %llu\n", fam.name.c_str(),
+                                      braces.c_str(), sum * s.scale, fam.name.c_str(), braces.c_str(),
+                                      (unsigned long long)h.count());
+                        out += line;
+                        break;
+                    }
+                }
+            }
+        }
+        return out;
+    }
+
+    // Writes expose() to `path` through a rename, so readers never see half a file.
+    bool dump(const std::string& path) const {
+        const std::string text = expose();
+        const std::string tmp = path + ".tmp";
+        std::FILE* f = std::fopen(tmp.c_str(), "w");
+        if (!f) return false;
+        const bool ok = std::fwrite(text.data(), 1, text.size(), f) == text.size();
+        if (std::fclose(f) != 0 || !ok) return false;
+        return std::rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+private:
+    static constexpr int HIST_SUB_BITS = 8;     // 2^-7 relative precision
+    static constexpr int HIST_MAX_BITS = 40;    // ~18 minutes in ns
+
+    enum class Kind : uint8_t { Counter, Gauge, Histogram };
+
+    struct Family {
+        std::string name, help, type;
+    };
+    struct Series {
+        size_t family;
+        std::string labels;
+        Kind kind;
+        uint32_t index;                 // counter or histogram id
+        double scale;
+        std::function<double()> read;   // gauges
+    };
+
+    struct HistShard {
+        std::atomic<std::atomic<uint64_t>*> buckets{nullptr};  // made by the owner on first record
+        std::atomic<uint64_t> sum{0};
+    };
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> counters[MAX_COUNTERS] = {};
+        HistShard hist[MAX_HISTOGRAMS];
+    };
+
+    // The thread's shard; a thread-local cache makes the common case (one
+    // registry per process) a compare and a load.
+    Shard& shard() {
+        struct Cache { uint64_t generation = 0; Shard* shard = nullptr; };
+        thread_local Cache cache;
+        if (cache.generation == generation_) return *cache.shard;
+        std::lock_guard<std::mutex> lk(mu_);
+        const std::thread::id me = std::this_thread::get_id();
+        Shard* s = nullptr;
+        for (size_t i = 0; i < owners_.size(); ++i) if (owners_[i] == me) s = shards_[i].get();
+        if (!s) {
+            shards_.push_back(std::make_unique<Shard>());
+            owners_.push_back(me);
+            s = shards_.back().get();
+        }
+        cache = Cache{ generation_, s };
+        return *s;
+    }
+
+    // lock held
+    HdrHistogram merged(uint32_t id) const {
+        HdrHistogram h(HIST_SUB_BITS, HIST_MAX_BITS);
+        for (auto& s : shards_) {
+            const std::atomic<uint64_t>* b = s->hist[id].buckets.load(std::memory_order_acquire);
+            if (!b) continue;
+            for (size_t i = 0; i < layout_.buckets(); ++i) {
+                const uint64_t n = b[i].load(std::memory_order_relaxed);
+                if (n) h.record(layout_.bucket_value(i), n);
+            }
+        }
+        return h;
+    }
+
+    // lock held
+    size_t family(const std::string& name, const std::string& help, const char* type) {
+        for (size_t i = 0; i < families_.size(); ++i) {
+            if (families_[i].name != name) continue;
+            if (families_[i].type != type) throw std::invalid_argument("metric " + name + " registered as two types");
+            return i;
+        }
+        families_.push_back(Family{ name, help, type });
+        return families_.size() - 1;
+    }
+
+    static uint64_t next_generation() {
+        static std::atomic<uint64_t> g{0};
+        return ++g;
+    }
+
+    const HdrHistogram layout_;         // bucket math only; never recorded into
+    const uint64_t generation_;         // tells this registry's shards from a dead one's
+    mutable std::mutex mu_;
+    std::vector<Family> families_;
+    std::vector<Series> series_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::vector<std::thread::id> owners_;
+    size_t counters_ = 0;
+    size_t histograms_ = 0;
+};
+
+// Times a scope into a histogram.
+class ScopedTimer {
+public:
+    ScopedTimer(MetricsRegistry& m, MetricsRegistry::Histogram h)
+    : m_(m), h_(h), t0_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        m_.record(h_, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - t0_).count());
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    MetricsRegistry& m_;
+    MetricsRegistry::Histogram h_;
+    std::chrono::steady_clock::time_point t0_;
+};
+
+// ---------- Exposition ----------
+// One thread: answers GET /metrics on 127.0.0.1:port (port 0 = no HTTP)
+// and rewrites `path` every `every` (empty = no file).
+class MetricsExporter {
+public:
+    MetricsExporter(const MetricsRegistry& m, uint16_t port, std::string path,
+                    std::chrono::milliseconds every = std::chrono::seconds(10))
+    : m_(m), path_(std::move(path)), every_(every) {
+        if (port) {
+            fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+            int one = 1;
+            ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (::bind(fd_, (sockaddr*)&addr, sizeof addr) != 0 || ::listen(fd_, 16) != 0) {
+                ::close(fd_);
+                throw std::runtime_error("metrics listen failed: " + std::string(std::strerror(errno)));
+            }
+            socklen_t len = sizeof addr;
+            ::getsockname(fd_, (sockaddr*)&addr, &len);
+            port_ = ntohs(addr.sin_port);
+        }
+        thread_ = std::thread([this] { run(); });
+    }
+
+    ~MetricsExporter() {
+        stopping_.store(true);
+        thread_.join();
+        if (fd_ >= 0) ::close(fd_);
+        if (!path_.empty()) m_.dump(path_);     // final numbers
+    }
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    uint16_t port() const { return port_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void run() {
+        Clock::time_point next_dump = Clock::now() + every_;
+        while (!stopping_.load()) {
+            int timeout = 200;          // also how soon stop is noticed
+            if (!path_.empty()) {
+                const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(next_dump - Clock::now());
+                timeout = (int)std::clamp<int64_t>(left.count(), 0, timeout);
+            }
+            pollfd p{ fd_, POLLIN, 0 };
+            if (::poll(&p, fd_ >= 0 ? 1 : 0, timeout) > 0 && (p.revents & POLLIN)) serve();
+            if (!path_.empty() && Clock::now() >= next_dump) {
+                m_.dump(path_);
+                next_dump = Clock::now() + every_;
+            }
+        }
+    }
+
+    void serve() {
+        const int c = ::accept(fd_, nullptr, nullptr);
+        if (c < 0) return;
+        timeval tv{ 1, 0 };
+        ::setsockopt(c, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+        ::setsockopt(c, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof tv);
+        std::string req;
+        char buf[1024];
+        while (req.find("\r\n\r\n") == std::string::npos && req.size() < 8192) {
+            const ssize_t n = ::read(c, buf, sizeof buf);
+            if (n <= 0) break;
+            req.append(buf, (size_t)n);
+        }
+        std::string body, status = "200 OK";
+        if (req.rfind("GET /metrics", 0) == 0) body = m_.expose();
+        else { status = "404 Not Found"; body = "try /metrics\n"; }
+        std::string resp = "HTTP/1.1 " + status + "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                           std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+        for (size_t off = 0; off < resp.size();) {
+            const ssize_t n = ::write(c, resp.data() + off, resp.size() - off);
+            if (n <= 0) break;
+            off += (size_t)n;
+        }
+        ::close(c);
+    }
+
+    const MetricsRegistry& m_;
+    std::string path_;
+    std::chrono::milliseconds every_;
+    int fd_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+};
@@ -0,0 +1,98 @@
+// mpsc_queue.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+
+/**
+ * Bounded lock-free multi-producer / single-consumer queue.
+ *
+ * Producers take a permit from `free_` (full queue = no permit = push
+ * fails, which is the backpressure signal), then a ticket from `tail_`, and
+ * publish by bumping the cell's sequence number. Both are single atomic
+ * RMWs, so a push is wait-free unless a producer lands on a cell whose
+ * previous occupant the consumer is still reading, where it spins briefly.
+ *
+ * The consumer walks cells in ticket order and stops at the first one not
+ * yet published, so drain() hands over whole batches without taking locks.
+ */
+
+template <class T>
+class MpscQueue {
+public:
+    explicit MpscQueue(size_t capacity) {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        cap_ = cap;
+        mask_ = cap - 1;
+        cells_ = std::make_unique<Cell[]>(cap);
+        for (size_t i = 0; i < cap; ++i) cells_[i].seq.store(i, std::memory_order_relaxed);
+        free_.store((int64_t)cap, std::memory_order_relaxed);
+    }
+
+    ~MpscQueue() { drain([](T&&) {}); }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Any thread. Returns false (and leaves `v` alone) when the queue is full.
+    // `ticket`, if given, receives the item's position in consumption order.
+    bool try_push(T& v, uint64_t* ticket = nullptr) {
+        if (free_.fetch_sub(1, std::memory_order_acquire) <= 0) {
+            free_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        const uint64_t pos = tail_.fetch_add(1, std::memory_order_relaxed);
+        if (ticket) *ticket = pos;
+        Cell& c = cells_[pos & mask_];
+        while (c.seq.load(std::memory_order_acquire) != pos) std::this_thread::yield();
+        ::new (c.storage) T(std::move(v));
+        c.seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+    bool try_push(T&& v) { return try_push(v); }
+
+    // Consumer thread only. Calls f(T&&) for every published item, up to
+    // `max`, in enqueue order; returns how many.
+    template <class F>
+    size_t drain(F&& f, size_t max = SIZE_MAX) {
+        size_t n = 0;
+        while (n < max) {
+            Cell& c = cells_[head_ & mask_];
+            if (c.seq.load(std::memory_order_acquire) != head_ + 1) break;
+            T* item = std::launder(reinterpret_cast<T*>(c.storage));
+            f(std::move(*item));
+            item->~T();
+            c.seq.store(head_ + cap_, std::memory_order_release);
+            ++head_;
+            ++n;
+        }
+        if (n) free_.fetch_add((int64_t)n, std::memory_order_release);
+        return n;
+    }
+
+    size_t capacity() const { return cap_; }
+
+    // Items pushed but not yet drained; exact only when producers are idle.
+    size_t size_approx() const {
+        int64_t f = free_.load(std::memory_order_relaxed);
+        return f >= (int64_t)cap_ ? 0 : cap_ - (size_t)std::max<int64_t>(f, 0);
+    }
+
+private:
+    struct Cell {
+        std::atomic<uint64_t> seq;
+        alignas(T) unsigned char storage[sizeof(T)];    // T needn't be default-constructible
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t cap_ = 0;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<int64_t> free_{0};     // permits left for producers
+    alignas(64) std::atomic<uint64_t> tail_{0};    // next producer ticket
+    alignas(64) uint64_t head_ = 0;                // next ticket to consume
+};
@@ -0,0 +1,294 @@
+// optimizer.hpp
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "roulette.hpp"
+#include "session.hpp"
+
+/**
+ * Parameter search for betting progressions.
+ *
+ * A real-coded genetic algorithm (tournament selection, blend crossover,
+ * gaussian mutation, elitism) over base unit, cap, stop-loss and target.
+ *
+ * Every candidate plays the same block of pre-drawn spins (common random
+ * numbers), so fitness differences come from the parameters and not from
+ * luck, and a parameter set always scores the same. That makes fitness
+ * cacheable: parameters are snapped to each range's step and the result is
+ * memoized by hash. Each generation's uncached candidates are cut into
+ * (candidate, session chunk) tasks pulled by all cores.
+ */
+
+struct ProgressionParams {
+    double base_unit = 10.0;    // opening stake, and the stake after a win
+    double cap       = 320.0;   // largest stake the progression will place
+    double stop_loss = 500.0;   // leave after losing this much
+    double target    = 200.0;   // leave after winning this much
+};
+
+// Negative progression on an even-money bet: double after a loss up to the
+// cap, back to the base unit after a win.
+class Progression {
+public:
+    explicit Progression(const ProgressionParams& p, Bet::Type type = Bet::Type::Red)
+    : params_(p), bet_(Decision::place(Bet(type, "", 0.0))), stake_(p.base_unit) {}
+
+    Decision decide(double /*bankroll*/) {
+        Decision d = bet_;
+        d.amount = stake_;
+        return d;
+    }
+
+    void observe(int /*index*/, const Decision& d, bool won) {
+        if (d.kind != Decision::Kind::Bet) return;
+        stake_ = won ? params_.base_unit : std::min(params_.cap, stake_ * 2.0);
+    }
+
+private:
+    ProgressionParams params_;
+    Decision bet_;
+    double stake_;
+};
+
+struct ParamRange {
+    double lo, hi, step;
+};
+
+struct OptimizerConfig {
+    Wheel::Type wheel = Wheel::Type::European;
+    std::vector<double> pocket_weights;     // biased wheel, one per table index (Wheel::set_bias); empty = fair
+    double bankroll   = 1000.0;
+    int sessions      = 100000;     // sessions per evaluation
+    int max_rounds    = 200;        // spins per session
+
+    // base_unit, cap, stop_loss, target
+    std::array<ParamRange, 4> ranges = {{
+        {1.0, 100.0, 1.0}, {1.0, 1000.0, 1.0}, {10.0, 1000.0, 10.0}, {10.0, 1000.0, 10.0} }};
+
+    int population  = 48;
+    int generations = 100;
+    int patience    = 10;       // stop after this many generations without improvement
+    int elite       = 4;
+    double mutation = 0.15;     // std dev as a fraction of each range
+    int threads     = 0;        // 0 = hardware_concurrency
+    uint64_t seed   = 1;
+
+    // per-session score, averaged over sessions; default is the chance of
+    // leaving the table ahead
+    std::function<double(const SessionResult&, const ProgressionParams&, double start)> score =
+        [](const SessionResult& r, const ProgressionParams&, double start) {
+            return r.bankroll > start ? 1.0 : 0.0;
+        };
+};
+
+struct OptimizerResult {
+    ProgressionParams best;
+    double fitness = 0.0;
+    int generations = 0;
+    size_t evaluations = 0;     // distinct parameter sets simulated
+    size_t cache_hits = 0;
+};
+
+class StrategyOptimizer {
+public:
+    explicit StrategyOptimizer(const OptimizerConfig& cfg) : cfg_(cfg), rng_(cfg.seed) {
+        threads_ = cfg_.threads > 0 ? cfg_.threads
+                                    : (int)std::max(1u, std::thread::hardware_concurrency());
+        draw_spins();
+    }
+
+    OptimizerResult run() {
+        OptimizerResult res;
+        std::vector<Genome> pop(cfg_.population);
+        for (Genome& g : pop)
+            for (int d = 0; d < 4; ++d) {
+                std::uniform_real_distribution<double> u(cfg_.ranges[d].lo, cfg_.ranges[d].hi);
+                g[d] = u(rng_);
+            }
+
+        double best = -INFINITY;
+        Genome best_g{};
+        int stale = 0;
+
+        for (int gen = 0; gen < cfg_.generations && stale < cfg_.patience; ++gen) {
+            for (Genome& g : pop) snap(g);
+            std::vector<double> fit = evaluate(pop, res);
+
+            std::vector<int> order(pop.size());
+            for (size_t i = 0; i < order.size(); ++i) order[i] = (int)i;
+            std::sort(order.begin(), order.end(), [&](int a, int b) { return fit[a] > fit[b]; });
+
+            if (fit[order[0]] > best + 1e-12) { best = fit[order[0]]; best_g = pop[order[0]]; stale = 0; }
+            else ++stale;
+            res.generations = gen + 1;
+
+            pop = breed(pop, fit, order);
+        }
+
+        res.best = to_params(best_g);
+        res.fitness = best;
+        res.evaluations = cache_.size();
+        return res;
+    }
+
+    // Fitness of one parameter set on the shared spin block (uncached).
+    double fitness(const ProgressionParams& p) const {
+        return score_range(p, 0, cfg_.sessions) / cfg_.sessions;
+    }
+
+private:
+    using Genome = std::array<double, 4>;
+
+    static constexpr int BLOCK = 1024;     // sessions per spin block and per evaluation task
+
+    static ProgressionParams to_params(const Genome& g) { return { g[0], g[1], g[2], g[3] }; }
+
+    void snap(Genome& g) const {
+        for (int d = 0; d < 4; ++d) {
+            const ParamRange& r = cfg_.ranges[d];
+            double v = std::clamp(g[d], r.lo, r.hi);
+            if (r.step > 0.0) v = r.lo + std::round((v - r.lo) / r.step) * r.step;
+            g[d] = std::min(v, r.hi);
+        }
+    }
+
+    static uint64_t hash(const Genome& g) {
+        uint64_t h = 1469598103934665603ull;
+        for (double v : g) {
+            uint64_t bits;
+            std::memcpy(&bits, &v, sizeof bits);
+            h = (h ^ bits) * 1099511628211ull;
+            h ^= h >> 29;
+        }
+        return h;
+    }
+
+    // Spins come in blocks of BLOCK sessions, each seeded by its own index,
+    // so the block (and every fitness) is the same whatever the thread count.
+    void draw_spins() {
+        spins_.resize((size_t)cfg_.sessions * cfg_.max_rounds);
+        const size_t per_block = (size_t)BLOCK * cfg_.max_rounds;
+        const size_t blocks = (spins_.size() + per_block - 1) / per_block;
+        Wheel proto(cfg_.wheel, 0);
+        if (!cfg_.pocket_weights.empty()) proto.set_bias(cfg_.pocket_weights);   // throws here, not on a worker
+        std::atomic<size_t> next{0};
+        auto worker = [&] {
+            Wheel w = proto;
+            for (size_t b; (b = next.fetch_add(1, std::memory_order_relaxed)) < blocks;) {
+                w.engine().seed(cfg_.seed * 0x9E3779B97F4A7C15ull + b);
+                const size_t from = b * per_block;
+                w.spin_indices(spins_.data() + from, std::min(per_block, spins_.size() - from));
+            }
+        };
+        std::vector<std::thread> pool;
+        for (int t = 1; t < threads_; ++t) pool.emplace_back(worker);
+        worker();
+        for (auto& th : pool) th.join();
+    }
+
+    // Sum of session scores for sessions [from, to).
+    double score_range(const ProgressionParams& p, int from, int to) const {
+        const double start = cfg_.bankroll;
+        SessionLimits lim;
+        lim.max_rounds = cfg_.max_rounds;
+        lim.stop_loss  = start - p.stop_loss;
+        lim.target     = start + p.target;
+
+        double sum = 0.0;
+        for (int s = from; s < to; ++s) {
+            const uint8_t* cursor = spins_.data() + (size_t)s * cfg_.max_rounds;
+            Progression strat(p);
+            SessionResult r = run_session(strat, [&] { return *cursor++; }, start, lim);
+            sum += cfg_.score(r, p, start);
+        }
+        return sum;
+    }
+
+    // Fitness for the whole population: cached ones are looked up, the rest
+    // are split into (candidate, chunk) tasks across threads.
+    std::vector<double> evaluate(const std::vector<Genome>& pop, OptimizerResult& res) {
+        std::vector<double> fit(pop.size());
+        std::vector<Genome> todo;
+        std::unordered_map<uint64_t, size_t> slot;     // hash -> index into todo
+
+        for (const Genome& g : pop) {
+            uint64_t h = hash(g);
+            if (cache_.count(h)) { ++res.cache_hits; continue; }
+            if (slot.emplace(h, todo.size()).second) todo.push_back(g);
+        }
+
+        if (!todo.empty()) {
+            const int chunk = BLOCK;       // fixed, so partial sums add up the same on any thread count
+            const int chunks = (cfg_.sessions + chunk - 1) / chunk;
+            const size_t tasks = todo.size() * chunks;
+            std::vector<double> partial(tasks, 0.0);
+            std::atomic<size_t> next{0};
+
+            auto worker = [&] {
+                for (size_t t; (t = next.fetch_add(1, std::memory_order_relaxed)) < tasks;) {
+                    const size_t c = t / chunks;
+                    const int from = (int)(t % chunks) * chunk;
+                    partial[t] = score_range(to_params(todo[c]), from, std::min(cfg_.sessions, from + chunk));
+                }
+            };
+            std::vector<std::thread> pool;
+            for (int t = 1; t < threads_; ++t) pool.emplace_back(worker);
+            worker();
+            for (auto& th : pool) th.join();
+
+            for (size_t c = 0; c < todo.size(); ++c) {
+                double sum = 0.0;
+                for (int k = 0; k < chunks; ++k) sum += partial[c * chunks + k];
+                cache_[hash(todo[c])] = sum / cfg_.sessions;
+            }
+        }
+
+        for (size_t i = 0; i < pop.size(); ++i) fit[i] = cache_.at(hash(pop[i]));
+        return fit;
+    }
+
+    std::vector<Genome> breed(const std::vector<Genome>& pop, const std::vector<double>& fit,
+                              const std::vector<int>& order) {
+        std::vector<Genome> next;
+        next.reserve(pop.size());
+        for (int i = 0; i < std::min<int>(cfg_.elite, (int)pop.size()); ++i) next.push_back(pop[order[i]]);
+
+        std::uniform_int_distribution<size_t> pick(0, pop.size() - 1);
+        std::uniform_real_distribution<double> u01(0.0, 1.0);
+        std::normal_distribution<double> gauss(0.0, 1.0);
+
+        auto tournament = [&]() -> const Genome& {
+            size_t a = pick(rng_), b = pick(rng_);
+            return fit[a] >= fit[b] ? pop[a] : pop[b];
+        };
+
+        while (next.size() < pop.size()) {
+            const Genome& a = tournament();
+            const Genome& b = tournament();
+            Genome child;
+            for (int d = 0; d < 4; ++d) {
+                const ParamRange& r = cfg_.ranges[d];
+                double w = u01(rng_) * 1.5 - 0.25;           // BLX-0.25
+                child[d] = a[d] + w * (b[d] - a[d]);
+                child[d] += gauss(rng_) * cfg_.mutation * (r.hi - r.lo);
+            }
+            next.push_back(child);
+        }
+        return next;
+    }
+
+    OptimizerConfig cfg_;
+    int threads_ = 1;
+    std::mt19937_64 rng_;
+    std::vector<uint8_t> spins_;                    // sessions x max_rounds table indices
+    std::unordered_map<uint64_t, double> cache_;    // parameter hash -> fitness
+};
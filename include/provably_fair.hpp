@@ -0,0 +1,266 @@
+// provably_fair.hpp
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "roulette.hpp"
+#include "sha256.hpp"
+
+/**
+ * Provably fair spins.
+ *
+ * The house picks a secret server seed and publishes SHA-256(seed) before
+ * any spin. Spin n is then
+ *
+ *   HMAC-SHA256(key = server seed, msg = "<client seed>:<n>:<k>")
+ *
+ * read as eight big-endian 32-bit words; the first word below the largest
+ * multiple of the pocket count is reduced mod the pocket count (rejection
+ * sampling, so no pocket is favoured). If all eight words are rejected,
+ * k goes up by one; that happens about once in 10^60 spins. After the seed
+ * is rotated and revealed, anyone can recompute every spin made under it.
+ *
+ * The next server seed is chosen and committed one seed ahead, so a client
+ * seed is only ever paired with a server seed whose commitment was already
+ * public: the house cannot pick its seed after seeing the client's.
+ *
+ * HmacSha256 keeps the keyed inner and outer midstates, so one spin costs
+ * two SHA-256 blocks, and mac_x8() does eight nonces per pair of 8-lane
+ * compressions, which is what the bulk verifier uses.
+ */
+
+using FairSeed = Sha256Digest;
+
+constexpr size_t MAX_CLIENT_SEED = 64;
+
+class HmacSha256 {
+public:
+    HmacSha256(const void* key, size_t len) {
+        uint8_t k[64] = {};
+        if (len > 64) {
+            Sha256Digest d = sha256(key, len);
+            std::memcpy(k, d.data(), d.size());
+        } else {
+            std::memcpy(k, key, len);
+        }
+        uint8_t pad[64];
+        for (int i = 0; i < 64; ++i) pad[i] = k[i] ^ 0x36;
+        inner_.update(pad, 64);
+        for (int i = 0; i < 64; ++i) pad[i] = k[i] ^ 0x5c;
+        outer_.update(pad, 64);
+    }
+
+    Sha256Digest mac(const void* msg, size_t len) const {
+        Sha256 in = inner_;
+        in.update(msg, len);
+        const Sha256Digest d = in.final();
+        Sha256 out = outer_;
+        out.update(d.data(), d.size());
+        return out.final();
+    }
+
+    // Up to eight messages at once.
+    void mac_x8(const uint8_t* const msgs[], const size_t lens[], Sha256Digest out[], int count) const {
+        Sha256Digest inner[8];
+        sha256_x8(msgs, lens, inner, count, inner_.midstate(), 64);
+        const uint8_t* im[8];
+        size_t il[8];
+        for (int l = 0; l < count; ++l) { im[l] = inner[l].data(); il[l] = inner[l].size(); }
+        sha256_x8(im, il, out, count, outer_.midstate(), 64);
+    }
+
+private:
+    Sha256 inner_, outer_;
+};
+
+namespace fair_detail {
+
+// Appends the decimal digits of v; returns the new end.
+inline char* put_u64(char* p, uint64_t v) {
+    char tmp[20];
+    int n = 0;
+    do { tmp[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+    while (n) *p++ = tmp[--n];
+    return p;
+}
+
+// "<client>:<nonce>:<k>" into buf (client seed already cut to MAX_CLIENT_SEED); returns the length.
+inline size_t message(char* buf, const std::string& client, uint64_t nonce, uint32_t k) {
+    std::memcpy(buf, client.data(), client.size());
+    char* p = buf + client.size();
+    *p++ = ':';
+    p = put_u64(p, nonce);
+    *p++ = ':';
+    p = put_u64(p, k);
+    return (size_t)(p - buf);
+}
+
+// First acceptable word of a digest, or -1 if all eight fall in the biased tail.
+inline int pick(const Sha256Digest& d, uint32_t pockets) {
+    const uint32_t limit = (uint32_t)(0x100000000ull - 0x100000000ull % pockets);
+    for (int i = 0; i < 8; ++i) {
+        const uint32_t w = sha256_detail::load_be(d.data() + 4 * i);
+        if (w < limit) return (int)(w % pockets);
+    }
+    return -1;
+}
+
+inline int pockets_of(Wheel::Type t) { return pocket_count(t); }
+
+} // namespace fair_detail
+
+// The spin a seed pair gives at `nonce`, computed from scratch.
+inline int fair_index(const HmacSha256& key, const std::string& client_seed, uint64_t nonce, int pockets) {
+    char msg[MAX_CLIENT_SEED + 48];
+    for (uint32_t k = 0;; ++k) {
+        const size_t len = fair_detail::message(msg, client_seed, nonce, k);
+        const int idx = fair_detail::pick(key.mac(msg, len), (uint32_t)pockets);
+        if (idx >= 0) return idx;
+    }
+}
+
+inline FairSeed random_fair_seed() {
+    std::random_device rd;          // /dev/urandom on the platforms we build for
+    FairSeed s;
+    for (size_t i = 0; i < s.size(); i += 4) {
+        const uint32_t v = rd();
+        std::memcpy(s.data() + i, &v, 4);
+    }
+    return s;
+}
+
+inline std::string to_hex(const uint8_t* p, size_t n) {
+    static const char* digits = "0123456789abcdef";
+    std::string s(n * 2, '0');
+    for (size_t i = 0; i < n; ++i) { s[2 * i] = digits[p[i] >> 4]; s[2 * i + 1] = digits[p[i] & 15]; }
+    return s;
+}
+
+// Exactly 2*N hex digits into `out`; false otherwise.
+template <size_t N>
+bool from_hex(const std::string& s, std::array<uint8_t, N>& out) {
+    if (s.size() != 2 * N) return false;
+    auto nib = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    for (size_t i = 0; i < N; ++i) {
+        const int hi = nib(s[2 * i]), lo = nib(s[2 * i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return true;
+}
+
+class FairWheel {
+public:
+    FairWheel(Wheel::Type type, const FairSeed& server_seed, const FairSeed& next_seed,
+              std::string client_seed = "roulette")
+    : type_(type), seed_(server_seed), key_(seed_.data(), seed_.size()),
+      commit_(sha256(seed_.data(), seed_.size())), next_(next_seed),
+      next_commit_(sha256(next_.data(), next_.size())) { set_client_seed(std::move(client_seed)); }
+
+    Wheel::Type type() const { return type_; }
+    const Sha256Digest& commitment() const { return commit_; }     // publish before spinning
+    const Sha256Digest& next_commitment() const { return next_commit_; }   // ...and this with it
+    const std::string& client_seed() const { return client_; }
+    uint64_t nonce() const { return nonce_; }                       // the next spin's
+
+    // Takes effect from the next spin; nonces keep counting. Cut to MAX_CLIENT_SEED bytes.
+    void set_client_seed(std::string s) {
+        if (s.size() > MAX_CLIENT_SEED) s.resize(MAX_CLIENT_SEED);
+        client_ = std::move(s);
+    }
+
+    int spin_index() { return fair_index(key_, client_, nonce_++, fair_detail::pockets_of(type_)); }
+
+    // Moves on to the already committed next seed, commits `after` as the
+    // one after it, and returns the old seed, which can now be published.
+    FairSeed rotate(const FairSeed& after) {
+        FairSeed old = seed_;
+        seed_ = next_;
+        commit_ = next_commit_;
+        key_ = HmacSha256(seed_.data(), seed_.size());
+        next_ = after;
+        next_commit_ = sha256(next_.data(), next_.size());
+        nonce_ = 0;
+        return old;
+    }
+
+private:
+    Wheel::Type type_;
+    FairSeed seed_;
+    HmacSha256 key_;
+    Sha256Digest commit_;
+    FairSeed next_;
+    Sha256Digest next_commit_;
+    std::string client_;
+    uint64_t nonce_ = 0;
+};
+
+struct FairSpin {
+    uint64_t nonce;
+    int index;
+};
+
+struct FairCheck {
+    bool commitment_ok = false;
+    uint64_t checked = 0;
+    uint64_t mismatches = 0;
+    uint64_t first_bad_nonce = UINT64_MAX;
+};
+
+// Checks a revealed seed against its commitment and recomputes every spin,
+// eight nonces per HMAC pass, spread over `threads` threads.
+inline FairCheck verify_fair_spins(const FairSeed& server_seed, const Sha256Digest& commitment,
+                                   const std::string& client_seed, Wheel::Type type,
+                                   const std::vector<FairSpin>& spins, int threads) {
+    FairCheck out;
+    out.commitment_ok = sha256(server_seed.data(), server_seed.size()) == commitment;
+    out.checked = spins.size();
+    const HmacSha256 key(server_seed.data(), server_seed.size());
+    const int pockets = fair_detail::pockets_of(type);
+    const std::string client = client_seed.substr(0, MAX_CLIENT_SEED);
+
+    threads = std::max(1, threads);
+    std::vector<uint64_t> bad(threads, 0), first(threads, UINT64_MAX);
+    std::vector<std::thread> pool;
+    for (int w = 0; w < threads; ++w) {
+        pool.emplace_back([&, w] {
+            const size_t lo = spins.size() * w / threads, hi = spins.size() * (w + 1) / threads;
+            char msg[8][MAX_CLIENT_SEED + 48];
+            const uint8_t* msgs[8];
+            size_t lens[8];
+            Sha256Digest d[8];
+            for (size_t i = lo; i < hi; i += 8) {
+                const int count = (int)std::min<size_t>(8, hi - i);
+                for (int l = 0; l < count; ++l) {
+                    lens[l] = fair_detail::message(msg[l], client, spins[i + l].nonce, 0);
+                    msgs[l] = reinterpret_cast<const uint8_t*>(msg[l]);
+                }
+                key.mac_x8(msgs, lens, d, count);
+                for (int l = 0; l < count; ++l) {
+                    int idx = fair_detail::pick(d[l], (uint32_t)pockets);
+                    if (idx < 0) idx = fair_index(key, client, spins[i + l].nonce, pockets);
+                    if (idx != spins[i + l].index) {
+                        ++bad[w];
+                        first[w] = std::min(first[w], spins[i + l].nonce);
+                    }
+                }
+            }
+        });
+    }
+    for (std::thread& t : pool) t.join();
+    for (int w = 0; w < threads; ++w) {
+        out.mismatches += bad[w];
+        out.first_bad_nonce = std::min(out.first_bad_nonce, first[w]);
+    }
+    return out;
+}
@@ -0,0 +1,191 @@
+// rl_env.hpp
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "bet.hpp"
+#include "roulette.hpp"
+
+/**
+ * Batched roulette environment for reinforcement learning.
+ *
+ * Steps thousands of single-player sessions at once. State lives in
+ * structure-of-arrays buffers sized at construction; step() writes
+ * observations, rewards and done flags into those buffers and never
+ * allocates.
+ *
+ * Actions are discrete: 0 is "no bet"; action 1 + m * stakes + s bets
+ * stakes[s] on menu[m]. Each action is pre-resolved to a coverage mask and
+ * payout so the step is a spin, a shift and a couple of FMAs per env.
+ * The reward is the bankroll change. An episode ends when the bankroll
+ * can't cover the smallest stake or after max_steps; done envs are reset in
+ * place, so the observation returned for them is the first of the next
+ * episode.
+ *
+ * Envs are grouped into shards of `shard_size`, each with its own Wheel.
+ * step_shard() on distinct shards is safe from different threads, so a
+ * learner's thread pool can split a batch without locks.
+ */
+
+struct VecEnvConfig {
+    int num_envs   = 4096;
+    int shard_size = 1024;
+    Wheel::Type wheel = Wheel::Type::European;
+    double bankroll = 1000.0;
+    int max_steps   = 200;
+    std::vector<double> stakes = { 1.0, 5.0, 10.0, 25.0 };
+    std::vector<Bet> menu = {
+        Bet(Bet::Type::Red, "", 0),   Bet(Bet::Type::Black, "", 0),
+        Bet(Bet::Type::Odd, "", 0),   Bet(Bet::Type::Even, "", 0),
+        Bet(Bet::Type::Low, "", 0),   Bet(Bet::Type::High, "", 0),
+        Bet(Bet::Type::Dozen, "1", 0), Bet(Bet::Type::Dozen, "2", 0), Bet(Bet::Type::Dozen, "3", 0),
+        Bet(Bet::Type::Column, "1", 0), Bet(Bet::Type::Column, "2", 0), Bet(Bet::Type::Column, "3", 0),
+        Bet(Bet::Type::Straight, "0", 0), Bet(Bet::Type::Straight, "17", 0),
+    };
+    uint64_t seed = 1;
+};
+
+class VecEnv {
+public:
+    // observation layout, one row of OBS_DIM floats per env
+    enum Obs : int {
+        ObsBankroll,        // bankroll / starting bankroll
+        ObsLastStake,       // last stake / starting bankroll
+        ObsLastReward,      // last reward / starting bankroll
+        ObsWon, ObsLost,
+        ObsWinStreak, ObsLossStreak,    // streak / 10
+        ObsProgress,        // steps / max_steps
+        ObsRed, ObsBlack, ObsGreen, ObsOdd, ObsEven,
+        ObsDozen,           // dozen / 3 of the last pocket
+        ObsColumn,          // column / 3 of the last pocket
+        ObsNumber,          // value / 36 of the last pocket
+        OBS_DIM
+    };
+
+    explicit VecEnv(const VecEnvConfig& cfg) : cfg_(cfg), n_(cfg.num_envs) {
+        if (n_ <= 0 || cfg_.shard_size <= 0 || cfg_.stakes.empty() || cfg_.menu.empty())
+            throw std::invalid_argument("invalid env config");
+
+        for (const Bet& b : cfg_.menu)
+            for (double s : cfg_.stakes)
+                actions_.push_back(Action{ coverage_mask(b), (float)s, (float)(s * (b.payout_odds + 1.0)) });
+        min_stake_ = (float)*std::min_element(cfg_.stakes.begin(), cfg_.stakes.end());
+
+        bankroll_.assign(n_, 0.0f);
+        last_stake_.assign(n_, 0.0f);
+        win_streak_.assign(n_, 0);
+        loss_streak_.assign(n_, 0);
+        steps_.assign(n_, 0);
+        obs_.assign((size_t)n_ * OBS_DIM, 0.0f);
+        reward_.assign(n_, 0.0f);
+        done_.assign(n_, 0);
+
+        const int shards = (n_ + cfg_.shard_size - 1) / cfg_.shard_size;
+        for (int s = 0; s < shards; ++s) wheels_.emplace_back(cfg_.wheel, cfg_.seed + 0x9E3779B97F4A7C15ull * s);
+        reset();
+    }
+
+    int num_envs() const { return n_; }
+    int num_actions() const { return 1 + (int)actions_.size(); }
+    int num_shards() const { return (int)wheels_.size(); }
+
+    void reset() {
+        for (int i = 0; i < n_; ++i) reset_env(i);
+    }
+
+    // Advances every env by one action; `actions` has num_envs() entries.
+    void step(const int32_t* actions) {
+        for (int s = 0; s < num_shards(); ++s) step_shard(s, actions);
+    }
+
+    void step_shard(int shard, const int32_t* actions) {
+        Wheel& wheel = wheels_[shard];
+        const int lo = shard * cfg_.shard_size;
+        const int hi = std::min(n_, lo + cfg_.shard_size);
+        const float inv_start = 1.0f / (float)cfg_.bankroll;
+
+        for (int i = lo; i < hi; ++i) {
+            const int a = actions[i];
+            const int idx = wheel.spin_index();
+
+            Action act{};
+            if (a > 0 && a <= (int)actions_.size()) act = actions_[a - 1];
+            if (act.stake > bankroll_[i]) act = Action{};        // can't cover it: no bet
+
+            const bool placed = act.stake > 0.0f;
+            const bool won = (act.mask >> idx) & 1;
+            const float reward = (won ? act.payout : 0.0f) - act.stake;
+
+            bankroll_[i] += reward;
+            reward_[i] = reward;
+            ++steps_[i];
+            if (placed) {
+                last_stake_[i]  = act.stake;
+                win_streak_[i]  = won ? win_streak_[i] + 1 : 0;
+                loss_streak_[i] = won ? 0 : loss_streak_[i] + 1;
+            }
+
+            const bool done = bankroll_[i] < min_stake_ || steps_[i] >= cfg_.max_steps;
+            done_[i] = done;
+            if (done) { reset_env(i); continue; }
+
+            float* o = &obs_[(size_t)i * OBS_DIM];
+            const Pocket& p = wheel.pocket_by_index(idx);
+            o[ObsBankroll]   = bankroll_[i] * inv_start;
+            o[ObsLastStake]  = last_stake_[i] * inv_start;
+            o[ObsLastReward] = reward * inv_start;
+            o[ObsWon]        = placed && won;
+            o[ObsLost]       = placed && !won;
+            o[ObsWinStreak]  = win_streak_[i] * 0.1f;
+            o[ObsLossStreak] = loss_streak_[i] * 0.1f;
+            o[ObsProgress]   = (float)steps_[i] / cfg_.max_steps;
+            o[ObsRed]        = (p.attrs & RED) != 0;
+            o[ObsBlack]      = (p.attrs & BLACK) != 0;
+            o[ObsGreen]      = (p.attrs & GREEN) != 0;
+            o[ObsOdd]        = (p.attrs & ODD) != 0;
+            o[ObsEven]       = (p.attrs & EVEN) != 0;
+            o[ObsDozen]      = dozen(p) * (1.0f / 3.0f);
+            o[ObsColumn]     = column(p) * (1.0f / 3.0f);
+            o[ObsNumber]     = p.value * (1.0f / 36.0f);
+        }
+    }
+
+    // Buffers, valid until the next step()/reset().
+    const float*   observations() const { return obs_.data(); }     // num_envs x OBS_DIM
+    const float*   rewards() const      { return reward_.data(); }
+    const uint8_t* dones() const        { return done_.data(); }
+    const float*   bankrolls() const    { return bankroll_.data(); }
+
+private:
+    struct Action {
+        uint64_t mask = 0;
+        float stake = 0.0f;
+        float payout = 0.0f;    // stake * (odds + 1), returned on a win
+    };
+
+    void reset_env(int i) {
+        bankroll_[i] = (float)cfg_.bankroll;
+        last_stake_[i] = 0.0f;
+        win_streak_[i] = loss_streak_[i] = 0;
+        steps_[i] = 0;
+        float* o = &obs_[(size_t)i * OBS_DIM];
+        std::fill(o, o + OBS_DIM, 0.0f);
+        o[ObsBankroll] = 1.0f;
+    }
+
+    VecEnvConfig cfg_;
+    int n_;
+    float min_stake_ = 0.0f;
+    std::vector<Action> actions_;
+    std::vector<Wheel> wheels_;
+
+    // per-env state
+    std::vector<float> bankroll_, last_stake_;
+    std::vector<int32_t> win_streak_, loss_streak_, steps_;
+
+    // outputs
+    std::vector<float> obs_;
+    std::vector<float> reward_;
+    std::vector<uint8_t> done_;
+};
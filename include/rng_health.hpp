@@ -0,0 +1,196 @@
+// rng_health.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+#include "roulette.hpp"
+#include "wheel_geometry.hpp"
+
+/**
+ * Online health tests on a wheel's results, for catching a broken
+ * generator or a biased wheel while the table is live.
+ *
+ *   repetition count    the same pocket C times in a row (SP 800-90B 4.4.1);
+ *                       with ~5.2 bits a spin and alpha = 2^-40, C = 9.
+ *   adaptive proportion the first pocket of each window turning up too often
+ *                       in it (SP 800-90B 4.4.2, non-binary, W = 512).
+ *   pocket chi-square   goodness of fit of the last `window` spins against
+ *                       uniform, over the 37/38 pockets.
+ *   sector chi-square   the same over SECTORS arcs of the wheel order, which
+ *                       finds a tilted or worn wheel (neighbours favoured)
+ *                       with far fewer spins than the pocket test.
+ *
+ * observe() is O(1): counts and (weighted, integer) sums of squared counts
+ * are updated as a spin enters and leaves the window, so each statistic is
+ * a multiply away. It runs on the table's thread; failing() and alarms()
+ * may be read from any thread. A failing test stays failing until its
+ * statistic passes again (the run breaks, a window completes, the
+ * chi-square drops back under the cutoff); alarms() counts how often each
+ * test started failing.
+ */
+
+struct RngHealthConfig {
+    double alpha_log2 = -40.0;          // false alarm rate per sample of the two 90B tests
+    uint32_t proportion_window = 512;
+    uint32_t chi_window = 0;            // 0 = 64 spins per pocket
+    double chi_z = 4.753;               // one-sided normal quantile of the chi-square cutoffs: p = 1e-6
+};
+
+class RngHealth {
+public:
+    enum Test : uint8_t { Repetition, Proportion, PocketChi, SectorChi, TESTS };
+
+    static constexpr int SECTORS = 8;
+
+    explicit RngHealth(Wheel::Type type, const RngHealthConfig& cfg = RngHealthConfig{})
+    : RngHealth(geometry_of(type), cfg) {}
+
+    // Any registered layout (wheel_geometry.hpp), e.g. a triple-zero wheel.
+    explicit RngHealth(const WheelGeometryInfo& wheel, const RngHealthConfig& cfg = RngHealthConfig{})
+    : pockets_(wheel.pockets), cfg_(cfg),
+      window_(cfg.chi_window ? cfg.chi_window : 64u * (uint32_t)pockets_),
+      ring_(window_, 0), pocket_counts_(pockets_, 0), sector_counts_(SECTORS, 0),
+      sector_of_(pockets_, 0), sector_weight_(SECTORS, 0) {
+        const double bits = std::log2((double)pockets_);
+        repetition_cutoff_ = 1 + (uint32_t)std::ceil(-cfg_.alpha_log2 / bits);
+        proportion_cutoff_ = 1 + binomial_critical(cfg_.proportion_window - 1, 1.0 / pockets_,
+                                                   std::exp2(cfg_.alpha_log2));
+
+        // Sectors are consecutive arcs of the wheel order.
+        for (int pos = 0; pos < pockets_; ++pos)
+            sector_of_[wheel.order[pos]] = (uint8_t)(pos * SECTORS / pockets_);
+        std::vector<int> size(SECTORS, 0);
+        for (int i = 0; i < pockets_; ++i) ++size[sector_of_[i]];
+        sector_scale_ = 1;
+        for (int s = 0; s < SECTORS; ++s) sector_scale_ = std::lcm(sector_scale_, (int64_t)size[s]);
+        for (int s = 0; s < SECTORS; ++s) sector_weight_[s] = sector_scale_ / size[s];
+
+        pocket_cutoff_ = chi_square_critical(pockets_ - 1, cfg_.chi_z);
+        sector_cutoff_ = chi_square_critical(SECTORS - 1, cfg_.chi_z);
+    }
+
+    // One spin's pocket index.
+    void observe(int index) {
+        // repetition count
+        run_ = index == last_ ? run_ + 1 : 1;
+        last_ = index;
+        set(Repetition, run_ >= repetition_cutoff_);
+
+        // adaptive proportion
+        if (prop_seen_ == 0) {
+            prop_first_ = index;
+            prop_count_ = 0;
+        }
+        if (index == prop_first_ && ++prop_count_ >= proportion_cutoff_) set(Proportion, true);
+        if (++prop_seen_ == cfg_.proportion_window) {
+            if (prop_count_ < proportion_cutoff_) set(Proportion, false);
+            prop_seen_ = 0;
+        }
+
+        // sliding chi-squares: count c -> c+1 adds 2c+1 to the sum of squares
+        if (filled_ == window_) {
+            const int old = ring_[head_];
+            pocket_sq_ -= 2 * (int64_t)pocket_counts_[old]-- - 1;
+            const int so = sector_of_[old];
+            sector_sq_ -= (2 * (int64_t)sector_counts_[so]-- - 1) * sector_weight_[so];
+        } else {
+            ++filled_;
+        }
+        ring_[head_] = (uint16_t)index;
+        head_ = head_ + 1 == window_ ? 0 : head_ + 1;
+        pocket_sq_ += 2 * (int64_t)pocket_counts_[index]++ + 1;
+        const int si = sector_of_[index];
+        sector_sq_ += (2 * (int64_t)sector_counts_[si]++ + 1) * sector_weight_[si];
+        if (filled_ == window_) {
+            set(PocketChi, pocket_chi_square() > pocket_cutoff_);
+            set(SectorChi, sector_chi_square() > sector_cutoff_);
+        }
+        spins_.store(spins_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Tests failing right now, as a bit per Test.
+    uint8_t failing() const { return failing_.load(std::memory_order_relaxed); }
+    bool failing(Test t) const { return (failing() >> t) & 1; }
+    uint64_t alarms(Test t) const { return alarms_[t].load(std::memory_order_relaxed); }
+    uint64_t spins() const { return spins_.load(std::memory_order_relaxed); }
+
+    // Statistics over the current window (table thread).
+    double pocket_chi_square() const {
+        return filled_ ? (double)pocket_sq_ * pockets_ / filled_ - filled_ : 0.0;
+    }
+    double sector_chi_square() const {
+        return filled_ ? (double)sector_sq_ * pockets_ / ((double)sector_scale_ * filled_) - filled_ : 0.0;
+    }
+    double pocket_cutoff() const { return pocket_cutoff_; }
+    double sector_cutoff() const { return sector_cutoff_; }
+    uint32_t repetition_cutoff() const { return repetition_cutoff_; }
+    uint32_t proportion_cutoff() const { return proportion_cutoff_; }
+
+    static const char* test_name(Test t) {
+        switch (t) {
+            case Repetition: return "repetition";
+            case Proportion: return "proportion";
+            case PocketChi:  return "pocket_chi_square";
+            case SectorChi:  return "sector_chi_square";
+            default:         return "unknown";
+        }
+    }
+
+private:
+    void set(Test t, bool fail) {
+        const uint8_t f = failing_.load(std::memory_order_relaxed);
+        const uint8_t bit = (uint8_t)(1u << t);
+        if (fail == ((f & bit) != 0)) return;
+        if (fail) alarms_[t].store(alarms_[t].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        failing_.store(fail ? f | bit : f & ~bit, std::memory_order_relaxed);
+    }
+
+    // Smallest k with P(Bin(n, p) >= k) <= alpha.
+    static uint32_t binomial_critical(uint32_t n, double p, double alpha) {
+        double tail = 0.0;
+        for (uint32_t k = n + 1; k-- > 0;) {
+            tail += std::exp(std::lgamma(n + 1.0) - std::lgamma(k + 1.0) - std::lgamma(n - k + 1.0) +
+                             k * std::log(p) + (n - k) * std::log1p(-p));
+            if (tail > alpha) return k + 1;
+        }
+        return 0;
+    }
+
+    // Wilson-Hilferty: the chi-square(df) quantile matching normal quantile z.
+    static double chi_square_critical(int df, double z) {
+        const double a = 2.0 / (9.0 * df);
+        return df * std::pow(1.0 - a + z * std::sqrt(a), 3.0);
+    }
+
+    int pockets_;
+    RngHealthConfig cfg_;
+    uint32_t window_;
+    uint32_t repetition_cutoff_ = 0;
+    uint32_t proportion_cutoff_ = 0;
+    double pocket_cutoff_ = 0.0;
+    double sector_cutoff_ = 0.0;
+
+    int last_ = -1;
+    uint32_t run_ = 0;
+    int prop_first_ = -1;
+    uint32_t prop_count_ = 0;
+    uint32_t prop_seen_ = 0;
+
+    std::vector<uint16_t> ring_;            // the chi-square window
+    uint32_t head_ = 0;
+    uint32_t filled_ = 0;
+    std::vector<uint32_t> pocket_counts_;
+    std::vector<uint32_t> sector_counts_;
+    std::vector<uint8_t> sector_of_;        // by pocket index
+    std::vector<int64_t> sector_weight_;    // sector_scale_ / sector size
+    int64_t sector_scale_ = 1;              // lcm of the sector sizes
+    int64_t pocket_sq_ = 0;                 // sum of squared pocket counts
+    int64_t sector_sq_ = 0;                 // sum of squared sector counts, weighted
+
+    std::atomic<uint8_t> failing_{0};
+    std::atomic<uint64_t> alarms_[TESTS] = {};
+    std::atomic<uint64_t> spins_{0};
+};
@@ -1,12 +1,22 @@
 // roulette.hpp
 #pragma once
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <charconv>
+#include <memory>
 #include <random>
+#include <sstream>
+#include <stdexcept>
 #include <string_view>
 #include <cstdint>
 #include <cctype>
 #include <string>
+#include <utility>
+#include <vector>
+#include "alias_table.hpp"
 #include "bet.hpp"
+#include "chacha.hpp"
 
 
 // use binary attributes : computations are quicker
@@ -28,6 +38,7 @@ struct Pocket {
     int value;           
     bool isDoubleZero;   
     uint16_t attrs;      
+    uint8_t green = 0;   // greens by table index order: "0" is 1, "00" 2, "000" 3; 0 for numbers
 };
 
 constexpr bool is_red_number(int n) {
@@ -59,16 +70,23 @@ constexpr uint16_t build_attrs(int n, bool is00) {
 // ---------- Tables ----------
 inline const std::array<Pocket, 37> EURO_TABLE = []{
     std::array<Pocket, 37> t{};
-    t[0] = Pocket{0, false, build_attrs(0, false)};
+    t[0] = Pocket{0, false, build_attrs(0, false), 1};
     for (int i = 1; i <= 36; ++i) t[i] = Pocket{i, false, build_attrs(i, false)};
     return t;
 }();
 
 inline const std::array<Pocket, 38> AMERICAN_TABLE = []{
     std::array<Pocket, 38> t{};
-    t[0] = Pocket{0, false, build_attrs(0, false)};
+    t[0] = Pocket{0, false, build_attrs(0, false), 1};
     for (int i = 1; i <= 36; ++i) t[i] = Pocket{i, false, build_attrs(i, false)};
-    t[37] = Pocket{0, true, build_attrs(0, true)}; // "00"
+    t[37] = Pocket{0, true, build_attrs(0, true), 2}; // "00"
+    return t;
+}();
+
+inline const std::array<Pocket, 39> TRIPLE_ZERO_TABLE = []{
+    std::array<Pocket, 39> t{};
+    std::copy(AMERICAN_TABLE.begin(), AMERICAN_TABLE.end(), t.begin());
+    t[38] = Pocket{0, false, build_attrs(0, true), 3}; // "000"
     return t;
 }();
 
@@ -92,10 +110,10 @@ inline int european_value_to_index(int value) {
     return value;                    // 0..36 map directly
 }
 
-// Pretty label
+// Pretty label. Greens past "00" are labelled by their count of zeros
+// ("000"); a geometry with other names has them in WheelTables::labels.
 inline std::string pocket_label(const Pocket& p) {
-    return (p.value == 0 && p.isDoubleZero) ? "00" :
-           (p.value == 0 ? "0" : std::to_string(p.value));
+    return p.green ? std::string(p.green, '0') : std::to_string(p.value);
 }
 
 // ---------- Queries ----------
@@ -111,9 +129,10 @@ inline int  column  (const Pocket& p) { return has(p.attrs,C1)?1:has(p.attrs,C2)
 
 static inline bool parse_number_label(const std::string& s, int& out) {
     if (s == "0" || s == "00") return false;             // greens aren't part of layout combos
-    if (s.empty()) return false;
-    for (unsigned char c : s) if (!std::isdigit(c)) return false;
-    int v = std::stoi(s);
+    if (s.empty() || s.size() > 2) return false;           // 1..36; longer is junk, not a number to parse
+    int v = 0;
+    const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+    if (ec != std::errc() || end != s.data() + s.size()) return false;
     if (v < 1 || v > 36) return false;
     out = v; return true;
 }
@@ -125,6 +144,34 @@ static inline bool split_pair(const std::string& s, int& a, int& b) {
     return parse_number_label(s1, a) && parse_number_label(s2, b);
 }
 
+// Splits and trios that take in a green: "0-1", "0-00", "00-2-3", ...
+// The pockets they cover (bit 37 = "00"); 0 if the label is not one.
+inline uint64_t zero_combo_mask(Bet::Type type, const std::string& s) {
+    struct Combo { Bet::Type type; const char* label; uint64_t mask; };
+    constexpr uint64_t Z = 1, ZZ = uint64_t{1} << 37;
+    auto n = [](int x) { return uint64_t{1} << x; };
+    static const Combo COMBOS[] = {
+        { Bet::Type::Split,  "0-00",   Z | ZZ },
+        { Bet::Type::Split,  "0-1",    Z | n(1) },
+        { Bet::Type::Split,  "0-2",    Z | n(2) },
+        { Bet::Type::Split,  "0-3",    Z | n(3) },
+        { Bet::Type::Split,  "00-2",   ZZ | n(2) },
+        { Bet::Type::Split,  "00-3",   ZZ | n(3) },
+        { Bet::Type::Street, "0-1-2",  Z | n(1) | n(2) },
+        { Bet::Type::Street, "0-2-3",  Z | n(2) | n(3) },
+        { Bet::Type::Street, "0-00-2", Z | ZZ | n(2) },
+        { Bet::Type::Street, "00-2-3", ZZ | n(2) | n(3) },
+    };
+    if (s.empty() || s[0] != '0') return 0;
+    for (const Combo& c : COMBOS) if (c.type == type && s == c.label) return c.mask;
+    return 0;
+}
+
+// Whether p is in a zero_combo_mask; greens past "00" are in none.
+inline bool in_zero_combo(uint64_t m, const Pocket& p) {
+    return p.green <= 2 && ((m >> (p.green == 2 ? 37 : p.value)) & 1);
+}
+
 bool player_won(const Bet& bet, const std::string& hit_label, const Pocket& p) {
     switch (bet.type) {
         case Bet::Type::Straight:
@@ -134,12 +181,14 @@ bool player_won(const Bet& bet, const std::string& hit_label, const Pocket& p) {
         case Bet::Type::Black:  return is_black(p);
         case Bet::Type::Odd:    return !is_green(p) && !is_even(p);
         case Bet::Type::Even:   return !is_green(p) &&  is_even(p);
-        case Bet::Type::High:   return !is_green(p) && (dozen(p) == 2 || dozen(p) == 3);
-        case Bet::Type::Low:    return !is_green(p) && (dozen(p) == 1);
+        case Bet::Type::High:   return !is_green(p) && p.value >= 19;
+        case Bet::Type::Low:    return !is_green(p) && p.value <= 18;
         case Bet::Type::Dozen:  return !is_green(p) && std::to_string(dozen(p))  == bet.selection_label;
         case Bet::Type::Column: return !is_green(p) && std::to_string(column(p)) == bet.selection_label;
 
         case Bet::Type::Split: {
+            if (uint64_t m = zero_combo_mask(bet.type, bet.selection_label))
+                return in_zero_combo(m, p);
             if (is_green(p)) return false;
             int hit; if (!parse_number_label(hit_label, hit)) return false;
 
@@ -159,6 +208,8 @@ bool player_won(const Bet& bet, const std::string& hit_label, const Pocket& p) {
         }
 
         case Bet::Type::Street: {
+            if (uint64_t m = zero_combo_mask(bet.type, bet.selection_label))
+                return in_zero_combo(m, p);
             if (is_green(p)) return false;
             int anchor, hit; 
             if (!parse_number_label(bet.selection_label, anchor)) return false;
@@ -186,35 +237,185 @@ bool player_won(const Bet& bet, const std::string& hit_label, const Pocket& p) {
     return false;
 }
 
+// ---------- Coverage masks ----------
+// bit i is set when the bet wins on table index i (0..36 are the numbers,
+// 37 is "00", 38 "000"), so settling is a shift and an AND instead of label parsing.
+// Agrees with player_won() for every bet it accepts; 0 for a selection
+// that is not a place on the layout (a corner on 3, a street on 2).
+inline uint64_t number_bit(int n) { return is_grid_number(n) ? (uint64_t{1} << n) : 0; }
+
+inline uint64_t attr_mask(Attr flag) {
+    uint64_t m = 0;
+    for (int n = 1; n <= 36; ++n) if (has(build_attrs(n, false), flag)) m |= uint64_t{1} << n;
+    return m;
+}
+
+inline uint64_t coverage_mask(const Bet& bet) {
+    static const uint64_t RED_M = attr_mask(RED),  BLACK_M = attr_mask(BLACK);
+    static const uint64_t ODD_M = attr_mask(ODD),  EVEN_M  = attr_mask(EVEN);
+    static const uint64_t DOZ_M[3] = { attr_mask(D1), attr_mask(D2), attr_mask(D3) };
+    static const uint64_t COL_M[3] = { attr_mask(C1), attr_mask(C2), attr_mask(C3) };
+    const std::string& s = bet.selection_label;
+
+    auto run = [](int from, int len) {
+        uint64_t m = 0;
+        for (int n = from; n < from + len; ++n) m |= number_bit(n);
+        return m;
+    };
+
+    int a, b;
+    switch (bet.type) {
+        case Bet::Type::Straight:
+            if (s == "0")  return uint64_t{1};
+            if (s == "00") return uint64_t{1} << 37;
+            if (s == "000") return uint64_t{1} << 38;
+            return parse_number_label(s, a) ? number_bit(a) : 0;
+
+        case Bet::Type::Red:    return RED_M;
+        case Bet::Type::Black:  return BLACK_M;
+        case Bet::Type::Odd:    return ODD_M;
+        case Bet::Type::Even:   return EVEN_M;
+        case Bet::Type::High:   return run(19, 18);
+        case Bet::Type::Low:    return run(1, 18);
+        case Bet::Type::Dozen:  return (s == "1" || s == "2" || s == "3") ? DOZ_M[s[0] - '1'] : 0;
+        case Bet::Type::Column: return (s == "1" || s == "2" || s == "3") ? COL_M[s[0] - '1'] : 0;
+
+        case Bet::Type::Split: {
+            if (uint64_t m = zero_combo_mask(bet.type, s)) return m;
+            if (split_pair(s, a, b)) {
+                if (a > b) std::swap(a, b);
+            } else {
+                if (s.size() < 2) return 0;
+                if (!parse_number_label(s.substr(0, s.size() - 1), a)) return 0;
+                char orient = s.back();
+                b = (orient == 'H' || orient == 'h') ? a + 1 : a + 3;
+            }
+            // side by side in a row, or one above the other
+            const bool adjacent = (b == a + 1 && a % 3 != 0) || b == a + 3;
+            return adjacent && is_grid_number(a) && is_grid_number(b) ? number_bit(a) | number_bit(b) : 0;
+        }
+        case Bet::Type::Street:
+            if (uint64_t m = zero_combo_mask(bet.type, s)) return m;
+            return parse_number_label(s, a) && a % 3 == 1 && a <= 34 ? run(a, 3) : 0;
+        case Bet::Type::Corner:
+            return parse_number_label(s, a) && a % 3 != 0 && a <= 32 ? run(a, 2) | run(a + 3, 2) : 0;
+        case Bet::Type::SixLine:
+            return parse_number_label(s, a) && a % 3 == 1 && a <= 31 ? run(a, 6) : 0;
+    }
+    return 0;
+}
+
 
 // ---------- RNG & spin ----------
-class Wheel {
+// TripleZero is the American wheel with "000" added (table index 38).
+enum class WheelType { European, American, TripleZero };
+
+inline int pocket_count(WheelType type) {
+    return type == WheelType::European ? 37 : type == WheelType::American ? 38 : 39;
+}
+
+// coverage_mask() for a bet on a `type` table: 0 unless the layout has the
+// bet, i.e. it covers exactly pockets_covered() pockets of that wheel ("00"
+// and its splits are American only, the 0-3 split and 0-2-3 trio European
+// only, since 00 sits over 2-3 there). A triple-zero table takes its greens
+// as straight bets only.
+inline uint64_t table_coverage_mask(const Bet& bet, WheelType type) {
+    constexpr uint64_t GREENS = 1 | uint64_t{1} << 37 | uint64_t{1} << 38;
+    const uint64_t m = coverage_mask(bet) & ((uint64_t{1} << pocket_count(type)) - 1);
+    if (std::popcount(m) != pockets_covered(bet.type)) return 0;
+    if (type == WheelType::American && (m & 1) && (m >> 3 & 1)) return 0;    // 0-3, 0-2-3
+    if (type == WheelType::TripleZero && (m & GREENS) && bet.type != Bet::Type::Straight) return 0;
+    return m;
+}
+
+// A wheel over any random engine; Wheel (mt19937_64) is the default, and
+// SecureWheel (ChaCha20, chacha.hpp) the one for regulated play.
+//
+// set_bias() gives the pockets arbitrary weights (a measured or modeled
+// wheel), sampled through an alias table (alias_table.hpp) at about the
+// cost of a fair spin. The bias is configuration, like the type: copies
+// share it, and rng_state() does not carry it.
+template <class Engine>
+class BasicWheel {
 public:
-    enum class Type { European, American };
+    using Type = WheelType;
 
-    explicit Wheel(Type type, uint64_t seed = std::random_device{}())
-    : type_(type), rng_(seed) {}
+    explicit BasicWheel(Type type, uint64_t seed = std::random_device{}())
+    : type_(type), pockets_(pockets_of(type)), table_(table_of(type)), rng_(seed) {}
+    // By rvalue: ChaCha20 is over-aligned and is never passed by value (-Wpsabi).
+    BasicWheel(Type type, Engine&& engine)
+    : type_(type), pockets_(pockets_of(type)), table_(table_of(type)), rng_(std::move(engine)) {}
 
+    // The layout is looked up once, not per spin; wheel_geometry.hpp has
+    // wheels whose layout is a compile-time constant.
     int spin_index() {
-        if (type_ == Type::European) {
-            std::uniform_int_distribution<int> dist(0, 36);
-            return dist(rng_);
+        if (bias_) return (int)(*bias_)(rng_);
+        if constexpr (requires(Engine& e) { e.bounded(1u); }) {
+            return (int)rng_.bounded((uint32_t)pockets_);     // unbiased, no distribution object
         } else {
-            std::uniform_int_distribution<int> dist(0, 37);
+            std::uniform_int_distribution<int> dist(0, pockets_ - 1);
             return dist(rng_);
         }
     }
 
-    const Pocket& pocket_by_index(int idx) const {
-        return (type_ == Type::European) ? EURO_TABLE[idx] : AMERICAN_TABLE[idx];
+    // n spins into out; the same sequence as n calls to spin_index().
+    template <class T>
+    void spin_indices(T* out, size_t n) {
+        if (bias_) return bias_->fill(rng_, out, n);
+        for (size_t i = 0; i < n; ++i) out[i] = (T)spin_index();
+    }
+
+    // One weight per table index (37, 38 or 39, the greens last); throws
+    // std::invalid_argument otherwise. clear_bias() goes back to fair.
+    void set_bias(const std::vector<double>& weights) {
+        if (weights.size() != (size_t)pockets_)
+            throw std::invalid_argument("wheel bias needs one weight per pocket");
+        bias_ = std::make_shared<const AliasTable>(weights);
     }
+    void clear_bias() { bias_.reset(); }
+    const AliasTable* bias() const { return bias_.get(); }
+
+    const Pocket& pocket_by_index(int idx) const { return table_[idx]; }
 
     std::string label_by_index(int idx) const {
         const auto& p = pocket_by_index(idx);
         return std::string(pocket_label(p));
     }
 
+    Type type() const { return type_; }
+    int pockets() const { return pockets_; }
+    Engine& engine() { return rng_; }
+
+    // Engine state as text (the standard engine stream format), so a
+    // restored table continues the exact same sequence.
+    std::string rng_state() const {
+        std::ostringstream os;
+        os << rng_;
+        return os.str();
+    }
+    void set_rng_state(const std::string& state) {
+        std::istringstream is(state);
+        is >> rng_;
+        if (!is) throw std::invalid_argument("bad wheel rng state");
+    }
+
 private:
+    static int pockets_of(Type type) { return pocket_count(type); }
+    static const Pocket* table_of(Type type) {
+        switch (type) {
+            case Type::European: return EURO_TABLE.data();
+            case Type::American: return AMERICAN_TABLE.data();
+            case Type::TripleZero: break;
+        }
+        return TRIPLE_ZERO_TABLE.data();
+    }
+
     Type type_;
-    std::mt19937_64 rng_;
+    int pockets_;
+    const Pocket* table_;
+    Engine rng_;
+    std::shared_ptr<const AliasTable> bias_;    // null = fair
 };
+
+using Wheel = BasicWheel<std::mt19937_64>;
+using SecureWheel = BasicWheel<ChaCha20>;
@@ -0,0 +1,984 @@
+// server.hpp
+#pragma once
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "audit.hpp"
+#include "event_loop.hpp"
+#include "ledger.hpp"
+#include "metrics.hpp"
+#include "mpsc_queue.hpp"
+#include "rng_health.hpp"
+#include "shm_bus.hpp"
+#include "snapshot.hpp"
+#include "table.hpp"
+#include "trace.hpp"
+#include "wire.hpp"
+
+/**
+ * Multi-table game server.
+ *
+ * Tables are spread over a small pool of event-loop threads ("shards");
+ * each table lives on exactly one shard and only that thread touches it.
+ * Client connections are spread round-robin over the shards independently
+ * of where their table lives, so a bet crosses threads once on the way in
+ * (the table's intake) and replies/broadcasts cross once on the way out
+ * (batched per destination shard and posted to its loop).
+ *
+ * The intake is a bounded lock-free MPSC queue: connection shards push
+ * without locking, and only the push that finds the table idle posts a
+ * wakeup, so a burst of last-second bets costs the owner one drain. A full
+ * intake answers ERR BUSY instead of queueing without bound.
+ *
+ * With a ledger configured, a table's outgoing lines wait (in order) until
+ * the ledger has synced everything the table wrote before them, so an ACK
+ * or SETTLE is never sent for a balance change that could still be lost.
+ * The ledger's writer pokes only the shards that have lines waiting.
+ *
+ * With a snapshot path too, the server snapshots every table periodically
+ * and, on start, rebuilds tables from the latest snapshot plus the ledger
+ * tail. Recovered players get their seats back with RESUME.
+ *
+ * With an audit path, every finished round (result and settlements) goes
+ * to the hash-chained audit log; see audit.hpp and apps/audit_verify.
+ *
+ * With a bus name, every finished round is also published to a shared-memory
+ * ring (shm_bus.hpp) that other processes on the host can follow; see
+ * apps/bus_tail.
+ *
+ * With fair_rounds set, tables spin a provably fair wheel (provably_fair.hpp).
+ * Each server seed is committed a whole seed ahead (FAIR carries the
+ * current and the next commitment) and revealed (REVEAL) after fair_rounds
+ * rounds, when the next one takes over; RESULT then carries the spin's
+ * nonce. A seated player's SEED sets the client seed used from the next
+ * server seed on, which was committed before the SEED arrived; the reply
+ * names that commitment. Seeds do not survive a restart: a restarted
+ * server commits fresh ones.
+ *
+ * With spin_ahead set, each ordinary table draws its spins ahead on a
+ * background thread (Table::set_spin_ahead), so a spin is a ring pop. Fair
+ * tables draw inline: their spins follow the committed seed and nonce.
+ *
+ * With secure_rng set, ordinary tables spin a SecureWheel: ChaCha20 keyed
+ * from /dev/urandom (chacha.hpp), rekeyed every secure_reseed_every words
+ * if that is set. The key is never written to a snapshot (UnsavedSpins in
+ * spin_ahead.hpp): a restored table spins from the fresh key it started
+ * with.
+ *
+ * A connection whose first byte is the wire.hpp frame magic speaks the
+ * binary protocol for its whole life: the same commands and messages as
+ * fixed-layout frames, decoded in place in the receive buffer. Everything
+ * else is the line protocol below; commands without a binary form can be
+ * sent inside a Text frame and are answered the same way.
+ *
+ * With a metrics port and/or file, the server keeps counters and latency
+ * histograms (metrics.hpp) for bet intake (queue wait, by outcome),
+ * settlement, payout and ledger commits, and serves them as Prometheus
+ * text on 127.0.0.1:<metrics port>/metrics and/or rewrites the file every
+ * metrics_every. Counting is always on; it writes only thread-local memory.
+ * Every table also runs online health tests on its results (rng_health.hpp);
+ * roulette_rng_failing{table,test} is 1 while a test fails and
+ * roulette_rng_alarms_total{test} counts alarms raised.
+ *
+ * Intake drains, spins, settlement, payout and ledger commits are trace
+ * spans (trace.hpp); turn tracing on with Trace::enable() and dump it.
+ *
+ * Line protocol (one command per line, space separated; a line over
+ * MAX_LINE bytes drops the connection, as does a client that stops reading
+ * until MAX_OUT bytes are waiting for it):
+ *   client: JOIN <table> <name> <balance> | RESUME <table> <seat> <name>
+ *           BET <kind> <selection|-> <amount> | CANCEL <bet> | MODIFY <bet> <amount> | LEAVE
+ *           FAIR <table> | SEED <client seed>
+ *   server: JOINED <table> <seat> <balance>
+ *           ACK <round> <bet> <amount> <balance>   (BET and MODIFY)
+ *           CANCELLED <bet> <balance>
+ *           ERR <reason>                           (BUSY = intake full, retry)
+ *           PHASE <table> <round> <phase>
+ *           RESULT <table> <round> <label> [<nonce>]
+ *           FAIR <table> <commitment> <client seed> <next nonce> <next commitment>
+ *           SEED <table> <client seed> <commitment it will be used with>
+ *           REVEAL <table> <server seed>          (followed by the next FAIR)
+ *           SETTLE <table> <round> <staked> <paid> <balance>
+ */
+
+struct ServerConfig {
+    int tables  = 16;
+    int threads = 0;                    // 0 = hardware_concurrency
+    std::string host = "127.0.0.1";
+    uint16_t port = 7777;               // 0 = no TCP listener
+    std::string unix_path;              // empty = no Unix socket listener
+    Wheel::Type wheel = Wheel::Type::European;  // any WheelType, e.g. TripleZero
+    Table::Timing timing;
+    uint64_t seed = 0;                  // 0 = random_device
+    size_t intake_capacity = 4096;      // queued bets per table before ERR BUSY
+    double exposure_cap = 0.0;          // per-table worst-case net loss per round; 0 = unlimited
+    std::string ledger_path;            // empty = no write-ahead ledger
+    std::string snapshot_path;          // needs ledger_path; empty = no snapshots
+    std::chrono::seconds snapshot_every{60};
+    std::string audit_path;             // empty = no audit log
+    uint64_t fair_rounds = 0;           // provably fair wheel, new server seed every N rounds; 0 = off
+    std::string bus_name;               // shared-memory round results, e.g. "/roulette-bus"; empty = off
+    size_t bus_capacity = 1 << 16;      // rounds kept for slow readers
+    uint16_t metrics_port = 0;          // Prometheus text on 127.0.0.1; 0 = off
+    std::string metrics_path;           // metrics file, rewritten every metrics_every; empty = off
+    std::chrono::seconds metrics_every{10};
+    uint32_t spin_ahead = 0;            // spins drawn ahead per table on a background thread; 0 = inline
+    bool secure_rng = false;            // ChaCha20 wheel engine keyed from /dev/urandom
+    uint64_t secure_reseed_every = 0;   // rekey after this many 32-bit outputs; 0 = never
+};
+
+class TableServer {
+public:
+    explicit TableServer(const ServerConfig& cfg) : cfg_(cfg) {
+        register_metrics();
+        int n = cfg_.threads > 0 ? cfg_.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+        for (int i = 0; i < n; ++i) shards_.push_back(std::make_unique<Shard>(*this, i));
+
+        std::random_device rd;
+        const uint64_t base = cfg_.seed ? cfg_.seed : ((uint64_t)rd() << 32 | rd());
+        for (int t = 0; t < cfg_.tables; ++t) {
+            tables_.push_back(std::make_unique<TableSlot>(*this, (uint32_t)t, t % n,
+                                                          base + 0x9E3779B97F4A7C15ull * (t + 1)));
+            shards_[t % n]->tables.push_back(tables_.back().get());
+        }
+
+        if (!cfg_.audit_path.empty()) audit_ = std::make_unique<AuditLog>(cfg_.audit_path);
+        if (!cfg_.bus_name.empty()) bus_ = std::make_unique<SpinBusWriter>(cfg_.bus_name, cfg_.bus_capacity);
+
+        if (!cfg_.ledger_path.empty()) {
+            std::vector<TableImage> images = recover_tables(cfg_.snapshot_path, cfg_.ledger_path, cfg_.tables);
+            for (TableImage& img : images) {
+                TableSlot& slot = *tables_[img.id];
+                slot.table.restore(img);
+                slot.subs.assign(img.seats.size(), Subscriber{});
+            }
+
+            LedgerConfig lc;
+            lc.path = cfg_.ledger_path;
+            lc.on_durable = [this](uint64_t) { ledger_synced(); };
+            lc.on_commit = [this](size_t records, std::chrono::nanoseconds took) {
+                metrics_.add(m_.ledger_commits);
+                metrics_.add(m_.ledger_records, records);
+                metrics_.record(m_.ledger_commit, (uint64_t)took.count());
+                metrics_.record(m_.ledger_batch, records);
+            };
+            ledger_ = std::make_unique<Ledger>(lc);
+            for (auto& t : tables_) t->table.set_ledger(ledger_.get());
+            if (!cfg_.snapshot_path.empty())
+                snapshots_ = std::make_unique<SnapshotWriter>(cfg_.snapshot_path, ledger_.get());
+        }
+    }
+
+    ~TableServer() { stop(); }
+
+    // Opens the listeners and starts the shard threads.
+    void start() {
+        if (cfg_.port) listen_tcp();
+        if (!cfg_.unix_path.empty()) listen_unix();
+
+        Shard& acceptor = *shards_[0];
+        for (int fd : { tcp_fd_, unix_fd_ })
+            if (fd >= 0) acceptor.loop.poller().add(fd, LISTEN_TAG);
+
+        for (auto& t : tables_) {
+            TableSlot* slot = t.get();
+            shards_[slot->owner]->loop.post([slot] { slot->schedule(slot->table.open(Table::Clock::now(), *slot)); });
+        }
+        if (snapshots_) schedule_snapshot();
+        if (cfg_.metrics_port || !cfg_.metrics_path.empty())
+            exporter_ = std::make_unique<MetricsExporter>(metrics_, cfg_.metrics_port, cfg_.metrics_path,
+                                                          cfg_.metrics_every);
+        for (auto& s : shards_)
+            s->thread = std::thread([sh = s.get()] {
+                Trace::name_thread("shard " + std::to_string(sh->index));
+                sh->loop.run();
+            });
+    }
+
+    void stop() {
+        exporter_.reset();
+        for (auto& s : shards_) s->loop.stop();
+        for (auto& s : shards_) if (s->thread.joinable()) s->thread.join();
+        for (int* fd : { &tcp_fd_, &unix_fd_ }) if (*fd >= 0) { ::close(*fd); *fd = -1; }
+        if (!cfg_.unix_path.empty()) ::unlink(cfg_.unix_path.c_str());
+    }
+
+    uint16_t port() const { return bound_port_; }
+    int tables() const { return (int)tables_.size(); }
+    uint16_t metrics_port() const { return exporter_ ? exporter_->port() : 0; }
+    const MetricsRegistry& metrics() const { return metrics_; }
+
+private:
+    static constexpr uint64_t LISTEN_TAG = 1;
+    static constexpr size_t MAX_LINE = 4096;            // a text line longer than this drops the connection
+    static constexpr size_t MAX_READ = 64 * 1024;       // bytes taken per readable event; the rest waits
+    static constexpr size_t MAX_OUT = 1 << 20;          // unsent bytes past this drop a client that is not reading
+
+    struct Msg {
+        uint64_t conn;
+        std::string text;
+    };
+
+    struct Conn {
+        int fd = -1;
+        std::string in, out;
+        bool want_write = false;
+        int table = -1;
+        uint32_t seat = 0;
+        bool binary = false;                // wire.hpp frames instead of lines
+        bool sniffed = false;               // protocol decided by the first byte
+    };
+
+    struct TableSlot;
+
+    struct Shard {
+        Shard(TableServer& s, int i) : srv(s), index(i) {
+            loop.on_io([this](const IoEvent& ev) { srv.on_io(*this, ev); });
+        }
+        TableServer& srv;
+        int index;
+        EventLoop loop;
+        std::unordered_map<uint64_t, Conn> conns;
+        uint64_t next_conn = 16;            // tags below are reserved
+        std::thread thread;
+        std::vector<TableSlot*> tables;                 // owned by this shard
+        std::atomic<bool> awaiting_durable{false};      // some table here holds lines for the ledger
+    };
+
+    // who to notify for a seat: a connection on some shard
+    struct Subscriber {
+        int shard = -1;
+        uint64_t conn = 0;
+        bool binary = false;
+    };
+
+    struct Intake {
+        enum class Op : uint8_t { Place, Cancel, Modify };
+        Op op;
+        uint32_t seat;
+        Subscriber from;
+        Bet bet;                // Place: the bet; Modify: only amount is used
+        uint64_t handle = 0;    // Cancel / Modify
+        Table::Clock::time_point queued{};
+    };
+
+    // ---------- metrics ----------
+    struct MetricIds {
+        using C = MetricsRegistry::Counter;
+        using H = MetricsRegistry::Histogram;
+        C bets[3][7];           // by Intake::Op and Table::BetResult
+        C busy, connections, spins, settlements, staked_cents, paid_cents;
+        C ledger_commits, ledger_records;
+        H intake_wait, settle, payout, ledger_commit, ledger_batch;
+        C rng_alarms[RngHealth::TESTS];
+    };
+
+    // A table plus everything its owner thread needs to talk to the world.
+    struct TableSlot : Table::Listener {
+        TableSlot(TableServer& s, uint32_t id, int owner_shard, uint64_t seed)
+        : srv(s), table(id, s.cfg_.wheel, s.cfg_.timing, seed), owner(owner_shard),
+          outbox(s.shards_.size()), health(s.cfg_.wheel), intake(s.cfg_.intake_capacity) {
+            table.set_exposure_cap(s.cfg_.exposure_cap);
+            if (s.cfg_.secure_rng && !s.cfg_.fair_rounds) {
+                SecureWheel w(s.cfg_.wheel, ChaCha20::from_urandom(s.cfg_.secure_reseed_every));
+                if (s.cfg_.spin_ahead)
+                    table.set_spin_source(std::make_unique<UnsavedSpins<BasicSpinAhead<SecureWheel>>>(w, s.cfg_.spin_ahead));
+                else
+                    table.set_spin_source(std::make_unique<UnsavedSpins<InlineSpins<SecureWheel>>>(std::move(w)));
+            } else if (s.cfg_.spin_ahead && !s.cfg_.fair_rounds) {
+                table.set_spin_ahead(s.cfg_.spin_ahead);
+            }
+            if (s.cfg_.fair_rounds)
+                table.set_fair(std::make_unique<FairWheel>(s.cfg_.wheel, random_fair_seed(), random_fair_seed(),
+                                                           "table-" + std::to_string(id)));
+        }
+
+        TableServer& srv;
+        Table table;
+        int owner;
+        std::vector<Subscriber> subs;               // by seat
+        std::vector<std::vector<Msg>> outbox;       // by destination shard
+
+        struct Held {
+            uint64_t lsn;
+            Subscriber to;
+            std::string text;
+        };
+        std::deque<Held> held;                      // waiting for the ledger, in send order
+        std::vector<AuditSettlement> settled;       // this round's, for the audit log
+        std::string next_client_seed;               // SEED; applied at the next reveal
+        double round_staked = 0.0;                  // this round's totals, for the bus
+        double round_paid = 0.0;
+        uint32_t round_settled = 0;
+        RngHealth health;
+
+        MpscQueue<Intake> intake;
+        std::atomic<bool> drain_pending{false};     // a drain is posted and hasn't started
+
+        void schedule(Table::Clock::time_point deadline) {
+            flush();
+            srv.shards_[owner]->loop.at(deadline, [this] {
+                schedule(table.advance(Table::Clock::now(), *this));
+            });
+        }
+
+        template <class M>
+        void send(const Subscriber& to, const M& m) {
+            if (to.shard >= 0) queue(to, render(to.binary, m));
+        }
+        // Renders at most once per protocol.
+        template <class M>
+        void broadcast(const M& m) {
+            std::string text, frame;
+            for (const Subscriber& s : subs) {
+                if (s.shard < 0) continue;
+                std::string& r = s.binary ? frame : text;
+                if (r.empty()) r = render(s.binary, m);
+                queue(s, r);
+            }
+        }
+        void queue(const Subscriber& to, std::string bytes) {
+            const uint64_t lsn = table.last_lsn();
+            if (srv.ledger_ && (!held.empty() || lsn > srv.ledger_->durable_lsn()))
+                held.push_back(Held{ lsn, to, std::move(bytes) });
+            else
+                outbox[to.shard].push_back(Msg{ to.conn, std::move(bytes) });
+        }
+        // Moves the durable prefix of `held` to the outbox. If some is left,
+        // flags the shard for the next sync; the re-check after the flag
+        // covers a sync that landed before the flag was seen.
+        void release_durable() {
+            for (;;) {
+                const uint64_t d = srv.ledger_->durable_lsn();
+                while (!held.empty() && held.front().lsn <= d) {
+                    Held& h = held.front();
+                    outbox[h.to.shard].push_back(Msg{ h.to.conn, std::move(h.text) });
+                    held.pop_front();
+                }
+                if (held.empty()) return;
+                srv.shards_[owner]->awaiting_durable.store(true, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (srv.ledger_->durable_lsn() < held.front().lsn) return;
+            }
+        }
+
+        void flush() {
+            if (!held.empty()) release_durable();
+            for (size_t i = 0; i < outbox.size(); ++i) {
+                if (outbox[i].empty()) continue;
+                srv.deliver((int)i, std::move(outbox[i]));
+                outbox[i].clear();
+            }
+        }
+
+        // Table::Listener
+        void on_phase(const Table& t) override {
+            if (t.phase() == Table::Phase::Settle) return;      // SETTLE lines say it
+            broadcast(wire::Phase{ t.round(), t.id(), (uint8_t)t.phase() });
+        }
+        void on_result(const Table& t, int index) override {
+            const uint8_t was = health.failing();
+            health.observe(index);
+            if (const uint8_t raised = health.failing() & ~was)
+                for (int k = 0; k < RngHealth::TESTS; ++k)
+                    if ((raised >> k) & 1) srv.metrics_.add(srv.m_.rng_alarms[k]);
+            wire::Result r{ t.round(), t.fair() ? t.fair()->nonce() - 1 : wire::Result::NO_NONCE, t.id(),
+                            (uint8_t)index, {} };
+            const std::string label = t.wheel().label_by_index(index);
+            std::memcpy(r.label, label.data(), std::min(label.size(), sizeof r.label));     // "000" fills it
+            broadcast(r);
+        }
+        void on_settle(const Table& t, uint32_t seat, double staked, double paid) override {
+            if (srv.audit_) settled.push_back(AuditSettlement{ seat, staked, paid });
+            round_staked += staked;
+            round_paid += paid;
+            ++round_settled;
+            srv.metrics_.add(srv.m_.settlements);
+            srv.metrics_.add(srv.m_.staked_cents, (uint64_t)std::llround(staked * 100.0));
+            srv.metrics_.add(srv.m_.paid_cents, (uint64_t)std::llround(paid * 100.0));
+            send(subs[seat], wire::Settle{ t.round(), staked, paid, t.player(seat).balance(), t.id() });
+        }
+
+        void on_round_end(const Table& t) override {
+            TraceSpan span("payout");
+            ScopedTimer timer(srv.metrics_, srv.m_.payout);
+            srv.metrics_.add(srv.m_.spins);
+            srv.metrics_.record(srv.m_.settle, (uint64_t)t.last_settle_time().count());
+            const int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            if (srv.bus_) {
+                RoundRecord r;
+                r.round = t.round();
+                r.nonce = t.fair() ? t.fair()->nonce() - 1 : RoundRecord::NO_NONCE;
+                r.time_ns = now_ns;
+                r.staked = round_staked;
+                r.paid = round_paid;
+                r.table = t.id();
+                r.settlements = round_settled;
+                r.index = (uint8_t)t.last_index();
+                const std::string label = t.wheel().label_by_index(t.last_index());
+                std::memcpy(r.label, label.data(), std::min(label.size(), sizeof r.label));
+                srv.bus_->publish(r);
+            }
+            round_staked = round_paid = 0.0;
+            round_settled = 0;
+
+            if (table.fair() && t.round() % srv.cfg_.fair_rounds == 0) rotate_seed();
+            if (!srv.audit_) return;
+            AuditEntry e;
+            e.table = t.id();
+            e.round = t.round();
+            e.index = t.last_index();
+            e.time_ns = now_ns;
+            e.settlements.swap(settled);
+            srv.audit_->record(std::move(e));
+        }
+
+        std::string fair_line() const {
+            const FairWheel& f = *table.fair();
+            return fmt("FAIR %u %s %s %llu %s", table.id(), to_hex(f.commitment().data(), f.commitment().size()).c_str(),
+                       f.client_seed().c_str(), (unsigned long long)f.nonce(),
+                       to_hex(f.next_commitment().data(), f.next_commitment().size()).c_str());
+        }
+
+        // Publishes the finished server seed, moves on to the next one (whose
+        // commitment went out with the last FAIR, before any SEED for it was
+        // taken) and commits the one after.
+        void rotate_seed() {
+            FairWheel& f = *table.fair();
+            if (!next_client_seed.empty()) {
+                f.set_client_seed(std::move(next_client_seed));
+                next_client_seed.clear();
+            }
+            const FairSeed old = f.rotate(random_fair_seed());
+            broadcast(wire::Text{ fmt("REVEAL %u %s", table.id(), to_hex(old.data(), old.size()).c_str()) });
+            broadcast(wire::Text{ fair_line() });
+        }
+
+        // owner thread: takes everything queued by the connection shards.
+        // The flag drops first, so a push racing with the drain either
+        // lands in this batch or posts the next one.
+        void drain() {
+            TraceSpan span("intake");
+            drain_pending.store(false, std::memory_order_seq_cst);
+            const Table::Clock::time_point now = Table::Clock::now();
+            intake.drain([this, now](Intake&& in) {
+                srv.metrics_.record(srv.m_.intake_wait, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                            now - in.queued).count());
+                if (in.seat >= subs.size() || subs[in.seat].shard != in.from.shard ||
+                    subs[in.seat].conn != in.from.conn) {
+                    send(in.from, error("NOT_SEATED"));
+                    return;
+                }
+                BetHandle h = BetHandle::from(in.handle);
+                Table::BetResult r = Table::BetResult::Invalid;
+                switch (in.op) {
+                    case Intake::Op::Place:  r = table.place_bet(in.seat, in.bet, &h); break;
+                    case Intake::Op::Cancel: r = table.cancel_bet(in.seat, h); break;
+                    case Intake::Op::Modify: r = table.modify_bet(in.seat, h, in.bet.amount); break;
+                }
+                srv.metrics_.add(srv.m_.bets[(int)in.op][(int)r]);
+                const double balance = table.player(in.seat).balance();
+                if (r != Table::BetResult::Accepted)
+                    send(in.from, error(bet_result_name(r)));
+                else if (in.op == Intake::Op::Cancel)
+                    send(in.from, wire::Cancelled{ h.value(), balance });
+                else
+                    send(in.from, wire::BetAck{ table.round(), h.value(), in.bet.amount, balance });
+            });
+            flush();
+        }
+    };
+
+    // ---------- metrics ----------
+    void register_metrics() {
+        static const char* const ops[] = { "place", "cancel", "modify" };
+        for (int op = 0; op < 3; ++op)
+            for (int r = 0; r < 7; ++r) {
+                std::string result = bet_result_name((Table::BetResult)r);
+                for (char& ch : result) ch = (char)std::tolower((unsigned char)ch);
+                m_.bets[op][r] = metrics_.counter("roulette_bets_total", "Bet commands handled by a table, by outcome.",
+                                                  fmt("op=\"%s\",result=\"%s\"", ops[op], result.c_str()));
+            }
+        m_.busy = metrics_.counter("roulette_bets_busy_total", "Bet commands refused because the table intake was full.");
+        m_.connections = metrics_.counter("roulette_connections_total", "Connections accepted.");
+        m_.spins = metrics_.counter("roulette_rounds_total", "Rounds spun and settled.");
+        m_.settlements = metrics_.counter("roulette_settlements_total", "Per-seat settlements.");
+        m_.staked_cents = metrics_.counter("roulette_staked_cents_total", "Amount staked on settled bets, in cents.");
+        m_.paid_cents = metrics_.counter("roulette_paid_cents_total", "Amount paid out, in cents.");
+        m_.intake_wait = metrics_.histogram("roulette_bet_intake_seconds",
+                                            "Time a bet command waits in the table intake before it is applied.");
+        m_.settle = metrics_.histogram("roulette_settle_seconds", "Time to settle every open bet on a table.");
+        m_.payout = metrics_.histogram("roulette_payout_seconds",
+                                       "Time to finish a round at payout (bus, audit, seed rotation).");
+        metrics_.gauge("roulette_open_connections", "Connections currently open.",
+                       [this] { return (double)open_conns_.load(std::memory_order_relaxed); });
+        for (int t = 0; t < cfg_.tables; ++t)
+            metrics_.gauge("roulette_intake_depth", "Bet commands waiting in a table's intake.",
+                           [this, t] { return (double)tables_[t]->intake.size_approx(); }, fmt("table=\"%d\"", t));
+        for (int k = 0; k < RngHealth::TESTS; ++k) {
+            const RngHealth::Test test = (RngHealth::Test)k;
+            m_.rng_alarms[k] = metrics_.counter("roulette_rng_alarms_total", "RNG health test alarms raised, over all tables.",
+                                                fmt("test=\"%s\"", RngHealth::test_name(test)));
+            for (int t = 0; t < cfg_.tables; ++t)
+                metrics_.gauge("roulette_rng_failing", "1 while a table's RNG health test is failing.",
+                               [this, t, test] { return tables_[t]->health.failing(test) ? 1.0 : 0.0; },
+                               fmt("table=\"%d\",test=\"%s\"", t, RngHealth::test_name(test)));
+        }
+        if (cfg_.ledger_path.empty()) return;
+        m_.ledger_commits = metrics_.counter("roulette_ledger_commits_total", "Ledger group commits (write and sync).");
+        m_.ledger_records = metrics_.counter("roulette_ledger_records_total", "Ledger records made durable.");
+        m_.ledger_commit = metrics_.histogram("roulette_ledger_commit_seconds", "Ledger group commit latency.");
+        m_.ledger_batch = metrics_.histogram("roulette_ledger_batch_records", "Records per ledger group commit.", "", 1.0);
+        metrics_.gauge("roulette_ledger_durable_lsn", "Highest ledger sequence number known durable.",
+                       [this] { return ledger_ ? (double)ledger_->durable_lsn() : 0.0; });
+    }
+
+    // ---------- snapshots ----------
+    // Shard 0 starts a round of captures; each table copies itself on its
+    // own thread and the last one hands the set to the snapshot writer.
+    void schedule_snapshot() {
+        shards_[0]->loop.at(Table::Clock::now() + cfg_.snapshot_every, [this] {
+            struct Job {
+                std::vector<TableImage> images;
+                std::atomic<size_t> left;
+            };
+            auto job = std::make_shared<Job>();
+            job->images.resize(tables_.size());
+            job->left.store(tables_.size());
+            for (auto& t : tables_) {
+                TableSlot* slot = t.get();
+                shards_[slot->owner]->loop.post([this, slot, job] {
+                    job->images[slot->table.id()] = slot->table.capture();
+                    if (job->left.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                        snapshots_->submit(std::move(job->images));
+                });
+            }
+            schedule_snapshot();
+        });
+    }
+
+    // ledger writer thread, after each group commit
+    void ledger_synced() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (auto& s : shards_) {
+            if (!s->awaiting_durable.exchange(false, std::memory_order_seq_cst)) continue;
+            s->loop.post([sh = s.get()] {
+                for (TableSlot* t : sh->tables) if (!t->held.empty()) t->flush();
+            });
+        }
+    }
+
+    __attribute__((format(printf, 1, 2)))
+    static std::string fmt(const char* f, ...) {
+        char buf[256];
+        va_list ap;
+        va_start(ap, f);
+        int n = std::vsnprintf(buf, sizeof buf, f, ap);
+        va_end(ap);
+        return std::string(buf, (size_t)std::clamp(n, 0, (int)sizeof buf - 1));
+    }
+
+    // A message as bytes for one connection: a frame, or a text line.
+    template <class M>
+    static std::string render(bool binary, const M& m) {
+        if (binary) return wire::frame(m);
+        std::string line = wire::to_text(m);
+        line += '\n';
+        return line;
+    }
+
+    static wire::Error error(const char* reason) {
+        wire::Error e;
+        wire::set_str(e.reason, reason);
+        return e;
+    }
+
+    // ---------- listeners ----------
+    static void set_nonblocking(int fd) { ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK); }
+
+    void listen_tcp() {
+        tcp_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        ::setsockopt(tcp_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(cfg_.port);
+        ::inet_pton(AF_INET, cfg_.host.c_str(), &addr.sin_addr);
+        if (::bind(tcp_fd_, (sockaddr*)&addr, sizeof addr) != 0 || ::listen(tcp_fd_, 4096) != 0)
+            throw std::runtime_error("tcp listen failed: " + std::string(std::strerror(errno)));
+        socklen_t len = sizeof addr;
+        ::getsockname(tcp_fd_, (sockaddr*)&addr, &len);
+        bound_port_ = ntohs(addr.sin_port);
+        set_nonblocking(tcp_fd_);
+    }
+
+    void listen_unix() {
+        unix_fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, cfg_.unix_path.c_str(), sizeof addr.sun_path - 1);
+        ::unlink(cfg_.unix_path.c_str());
+        if (::bind(unix_fd_, (sockaddr*)&addr, sizeof addr) != 0 || ::listen(unix_fd_, 4096) != 0)
+            throw std::runtime_error("unix listen failed: " + std::string(std::strerror(errno)));
+        set_nonblocking(unix_fd_);
+    }
+
+    // shard 0: accept everything pending, hand connections out round-robin
+    void accept_all() {
+        for (int lfd : { tcp_fd_, unix_fd_ }) {
+            if (lfd < 0) continue;
+            for (;;) {
+                int fd = ::accept(lfd, nullptr, nullptr);
+                if (fd < 0) break;
+                set_nonblocking(fd);
+                int one = 1;
+                ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);   // fails harmlessly on Unix sockets
+                metrics_.add(m_.connections);
+                open_conns_.fetch_add(1, std::memory_order_relaxed);
+                Shard& to = *shards_[next_shard_++ % shards_.size()];
+                to.loop.post([&to, fd] {
+                    uint64_t id = to.next_conn++;
+                    to.conns[id].fd = fd;
+                    to.loop.poller().add(fd, id);
+                });
+            }
+        }
+    }
+
+    // ---------- connections (shard thread) ----------
+    void on_io(Shard& sh, const IoEvent& ev) {
+        if (ev.tag == LISTEN_TAG) { accept_all(); return; }
+        auto it = sh.conns.find(ev.tag);
+        if (it == sh.conns.end()) return;
+        Conn& c = it->second;
+
+        if (ev.writable) flush_conn(sh, ev.tag, c);
+        if (ev.readable) {
+            char buf[16384];
+            for (;;) {
+                ssize_t n = ::read(c.fd, buf, sizeof buf);
+                if (n > 0) {
+                    c.in.append(buf, (size_t)n);
+                    if (c.in.size() >= MAX_READ) break;     // level-triggered: the poller comes back for the rest
+                    continue;
+                }
+                if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) { close_conn(sh, ev.tag); return; }
+                break;
+            }
+            if (!c.sniffed && !c.in.empty()) {
+                c.binary = (uint8_t)c.in[0] == (uint8_t)wire::MAGIC;
+                c.sniffed = true;
+            }
+            if (c.binary) {
+                if (!handle_frames(sh, ev.tag, c)) close_conn(sh, ev.tag);
+                return;
+            }
+            size_t start = 0, nl;
+            while ((nl = c.in.find('\n', start)) != std::string::npos) {
+                handle_line(sh, ev.tag, c, c.in.substr(start, nl - start));
+                start = nl + 1;
+            }
+            c.in.erase(0, start);
+            if (c.in.size() > MAX_LINE) close_conn(sh, ev.tag);
+        } else if (ev.closed) {
+            close_conn(sh, ev.tag);
+        }
+    }
+
+    void handle_line(Shard& sh, uint64_t id, Conn& c, const std::string& line) {
+        std::istringstream is(line);
+        std::string cmd;
+        is >> cmd;
+        const Subscriber self{ sh.index, id, c.binary };
+
+        if (cmd == "JOIN") {
+            int t; std::string name; double balance;
+            if (!(is >> t >> name >> balance)) return reply(sh, id, c, error("BAD_JOIN"));
+            join(sh, id, c, t, std::move(name), balance);
+        } else if (cmd == "RESUME") {
+            int t; uint32_t seat; std::string name;
+            if (!(is >> t >> seat >> name)) return reply(sh, id, c, error("BAD_JOIN"));
+            resume(sh, id, c, t, seat, std::move(name));
+        } else if (cmd == "BET") {
+            std::string kind, sel; double amount;
+            Bet::Type type;
+            if (!(is >> kind >> sel >> amount) || !parse_bet_type(kind, type))
+                return reply(sh, id, c, error("BAD_BET"));
+            if (sel == "-") sel.clear();
+            place(sh, id, c, Bet(type, sel, amount));
+        } else if (cmd == "CANCEL" || cmd == "MODIFY") {
+            const bool cancel = cmd == "CANCEL";
+            unsigned long long bet; double amount = 0.0;
+            if (!(is >> bet) || (!cancel && !(is >> amount))) return reply(sh, id, c, error("BAD_BET"));
+            change_bet(sh, id, c, cancel ? Intake::Op::Cancel : Intake::Op::Modify, bet, amount);
+        } else if (cmd == "FAIR") {
+            int t;
+            if (!(is >> t) || t < 0 || t >= (int)tables_.size()) return reply(sh, id, c, error("BAD_TABLE"));
+            if (!cfg_.fair_rounds) return reply(sh, id, c, error("NOT_FAIR"));
+            TableSlot* slot = tables_[t].get();
+            shards_[slot->owner]->loop.post([slot, self] {
+                slot->send(self, wire::Text{ slot->fair_line() });
+                slot->flush();
+            });
+        } else if (cmd == "SEED") {
+            std::string seed;
+            if (!(is >> seed)) return reply(sh, id, c, error("BAD_SEED"));
+            if (!cfg_.fair_rounds) return reply(sh, id, c, error("NOT_FAIR"));
+            if (c.table < 0) return reply(sh, id, c, error("NOT_SEATED"));
+            seed.resize(std::min(seed.size(), MAX_CLIENT_SEED));
+            TableSlot* slot = tables_[c.table].get();
+            shards_[slot->owner]->loop.post([slot, self, seed] {
+                slot->next_client_seed = seed;
+                const Sha256Digest& next = slot->table.fair()->next_commitment();
+                slot->send(self, wire::Text{ fmt("SEED %u %s %s", slot->table.id(), seed.c_str(),
+                                                 to_hex(next.data(), next.size()).c_str()) });
+                slot->flush();
+            });
+        } else if (cmd == "LEAVE") {
+            leave(sh, id, c);
+        } else if (!cmd.empty()) {
+            reply(sh, id, c, error("UNKNOWN_COMMAND"));
+        }
+    }
+
+    // Decodes every whole frame in c.in in place. false = the stream is
+    // corrupt and the connection should go.
+    bool handle_frames(Shard& sh, uint64_t id, Conn& c) {
+        size_t start = 0;
+        wire::Frame f;
+        for (;;) {
+            const wire::Status st = wire::decode_frame(c.in.data() + start, c.in.size() - start, f);
+            if (st == wire::Status::NeedMore) break;
+            if (st != wire::Status::Ok) {
+                reply(sh, id, c, error(wire::status_name(st)));
+                return false;
+            }
+            handle_frame(sh, id, c, f);
+            start += f.size();
+        }
+        c.in.erase(0, start);
+        return true;
+    }
+
+    void handle_frame(Shard& sh, uint64_t id, Conn& c, const wire::Frame& f) {
+        switch (f.type) {
+            case wire::Type::Join: {
+                const wire::Join m = f.as<wire::Join>();
+                return join(sh, id, c, m.table, std::string(wire::get_str(m.name)), m.balance);
+            }
+            case wire::Type::Resume: {
+                const wire::Resume m = f.as<wire::Resume>();
+                return resume(sh, id, c, m.table, m.seat, std::string(wire::get_str(m.name)));
+            }
+            case wire::Type::PlaceBet: {
+                const wire::PlaceBet m = f.as<wire::PlaceBet>();
+                if (m.bet_type > (uint8_t)Bet::Type::Low) return reply(sh, id, c, error("BAD_BET"));
+                return place(sh, id, c, Bet((Bet::Type)m.bet_type, std::string(wire::get_str(m.selection)), m.amount));
+            }
+            case wire::Type::CancelBet:
+                return change_bet(sh, id, c, Intake::Op::Cancel, f.as<wire::CancelBet>().bet, 0.0);
+            case wire::Type::ModifyBet: {
+                const wire::ModifyBet m = f.as<wire::ModifyBet>();
+                return change_bet(sh, id, c, Intake::Op::Modify, m.bet, m.amount);
+            }
+            case wire::Type::Leave:
+                return leave(sh, id, c);
+            case wire::Type::Text:
+                return handle_line(sh, id, c, std::string(f.text()));
+            default:
+                return reply(sh, id, c, error("UNKNOWN_COMMAND"));
+        }
+    }
+
+    // ---------- commands (connection's shard) ----------
+    void join(Shard& sh, uint64_t id, Conn& c, int64_t t, std::string name, double balance) {
+        if (t < 0 || t >= (int64_t)tables_.size() || !std::isfinite(balance) || balance < 0 || name.empty())
+            return reply(sh, id, c, error("BAD_JOIN"));
+        if (c.table >= 0) return reply(sh, id, c, error("ALREADY_SEATED"));
+        name.resize(std::min(name.size(), sizeof(LedgerRecord::text) - 1));    // as the ledger keeps it
+        c.table = (int)t;
+        const Subscriber self{ sh.index, id, c.binary };
+        TableSlot* slot = tables_[t].get();
+        shards_[slot->owner]->loop.post([slot, self, name, balance] {
+            uint32_t seat = slot->table.sit(name, balance);
+            if (slot->subs.size() <= seat) slot->subs.resize(seat + 1);
+            slot->subs[seat] = self;
+            slot->srv.seat_assigned(self, (int)slot->table.id(), seat);
+            slot->send(self, wire::Joined{ slot->table.id(), seat, balance });
+            slot->flush();
+        });
+    }
+
+    void resume(Shard& sh, uint64_t id, Conn& c, int64_t t, uint32_t seat, std::string name) {
+        if (t < 0 || t >= (int64_t)tables_.size()) return reply(sh, id, c, error("BAD_JOIN"));
+        if (c.table >= 0) return reply(sh, id, c, error("ALREADY_SEATED"));
+        name.resize(std::min(name.size(), sizeof(LedgerRecord::text) - 1));
+        c.table = (int)t;
+        const Subscriber self{ sh.index, id, c.binary };
+        TableSlot* slot = tables_[t].get();
+        shards_[slot->owner]->loop.post([slot, self, seat, name] {
+            Table& tb = slot->table;
+            if (!tb.seated(seat) || tb.player(seat).name() != name || seat >= slot->subs.size() ||
+                slot->subs[seat].shard >= 0) {
+                slot->srv.join_failed(self, (int)tb.id());
+                slot->send(self, error("NOT_SEATED"));
+            } else {
+                slot->subs[seat] = self;
+                slot->srv.seat_assigned(self, (int)tb.id(), seat);
+                slot->send(self, wire::Joined{ tb.id(), seat, tb.player(seat).balance() });
+            }
+            slot->flush();
+        });
+    }
+
+    void place(Shard& sh, uint64_t id, Conn& c, Bet bet) {
+        if (!std::isfinite(bet.amount)) return reply(sh, id, c, error("BAD_BET"));
+        if (c.table < 0) return reply(sh, id, c, error("NOT_SEATED"));
+        Intake in{ Intake::Op::Place, c.seat, Subscriber{ sh.index, id, c.binary }, std::move(bet) };
+        if (!submit(*tables_[c.table], in)) return reply(sh, id, c, error("BUSY"));
+    }
+
+    void change_bet(Shard& sh, uint64_t id, Conn& c, Intake::Op op, uint64_t bet, double amount) {
+        if (!std::isfinite(amount)) return reply(sh, id, c, error("BAD_BET"));
+        if (c.table < 0) return reply(sh, id, c, error("NOT_SEATED"));
+        Intake in{ op, c.seat, Subscriber{ sh.index, id, c.binary }, Bet(Bet::Type::Red, "", amount), bet };
+        if (!submit(*tables_[c.table], in)) return reply(sh, id, c, error("BUSY"));
+    }
+
+    // false when the table's intake is full
+    bool submit(TableSlot& slot, Intake& in) {
+        in.queued = Table::Clock::now();
+        if (!slot.intake.try_push(in)) {
+            metrics_.add(m_.busy);
+            return false;
+        }
+        if (!slot.drain_pending.exchange(true, std::memory_order_seq_cst))
+            shards_[slot.owner]->loop.post([s = &slot] { s->drain(); });
+        return true;
+    }
+
+    // runs on the table's shard; tells the connection's shard its seat, or
+    // gives the seat back if the connection left in the meantime
+    void seat_assigned(Subscriber who, int table, uint32_t seat) {
+        Shard& sh = *shards_[who.shard];
+        sh.loop.post([this, &sh, who, table, seat] {
+            auto it = sh.conns.find(who.conn);
+            if (it != sh.conns.end() && it->second.table == table) it->second.seat = seat;
+            else release_seat(*tables_[table], seat, who);
+        });
+    }
+
+    // runs on the table's shard; undoes the connection's optimistic c.table
+    void join_failed(Subscriber who, int table) {
+        Shard& sh = *shards_[who.shard];
+        sh.loop.post([&sh, who, table] {
+            auto it = sh.conns.find(who.conn);
+            if (it != sh.conns.end() && it->second.table == table) it->second.table = -1;
+        });
+    }
+
+    void release_seat(TableSlot& slot, uint32_t seat, Subscriber who) {
+        shards_[slot.owner]->loop.post([s = &slot, seat, who] {
+            if (seat < s->subs.size() && s->subs[seat].shard == who.shard && s->subs[seat].conn == who.conn) {
+                s->table.leave(seat);
+                s->subs[seat] = Subscriber{};
+            }
+        });
+    }
+
+    void leave(Shard& sh, uint64_t id, Conn& c) {
+        if (c.table < 0) return;
+        release_seat(*tables_[c.table], c.seat, Subscriber{ sh.index, id });
+        c.table = -1;
+    }
+
+    void close_conn(Shard& sh, uint64_t id) {
+        auto it = sh.conns.find(id);
+        if (it == sh.conns.end()) return;
+        leave(sh, id, it->second);
+        sh.loop.poller().remove(it->second.fd);
+        ::close(it->second.fd);
+        sh.conns.erase(it);
+        open_conns_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // ---------- output ----------
+    template <class M>
+    void reply(Shard& sh, uint64_t id, Conn& c, const M& m) {
+        c.out += render(c.binary, m);
+        flush_conn(sh, id, c);
+    }
+
+    // called from any shard: hands a batch of lines to the shard owning the connections
+    void deliver(int shard, std::vector<Msg> msgs) {
+        Shard& sh = *shards_[shard];
+        sh.loop.post([this, &sh, msgs = std::move(msgs)] {
+            for (const Msg& m : msgs) {
+                auto it = sh.conns.find(m.conn);
+                if (it == sh.conns.end()) continue;
+                it->second.out += m.text;
+            }
+            for (const Msg& m : msgs) {
+                auto it = sh.conns.find(m.conn);
+                if (it != sh.conns.end() && !it->second.out.empty()) flush_conn(sh, m.conn, it->second);
+            }
+        });
+    }
+
+    void flush_conn(Shard& sh, uint64_t id, Conn& c) {
+        while (!c.out.empty()) {
+            ssize_t n = ::write(c.fd, c.out.data(), c.out.size());
+            if (n > 0) { c.out.erase(0, (size_t)n); continue; }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            return;     // broken pipe: the read side will see the close
+        }
+        if (c.out.size() > MAX_OUT) {
+            // not reading: hang up, and the read side closes it as for a broken pipe
+            ::shutdown(c.fd, SHUT_RDWR);
+            c.out.clear();
+            return;
+        }
+        const bool want = !c.out.empty();
+        if (want != c.want_write) {
+            c.want_write = want;
+            sh.loop.poller().modify(c.fd, id, want);
+        }
+    }
+
+    ServerConfig cfg_;
+    MetricsRegistry metrics_;                   // outlives everything that records into it
+    MetricIds m_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::vector<std::unique_ptr<TableSlot>> tables_;
+    std::unique_ptr<Ledger> ledger_;            // declared late: its writer may still poke shards
+    std::unique_ptr<SnapshotWriter> snapshots_; // waits on the ledger, so goes first
+    std::unique_ptr<AuditLog> audit_;
+    std::unique_ptr<SpinBusWriter> bus_;
+    int tcp_fd_ = -1;
+    int unix_fd_ = -1;
+    uint16_t bound_port_ = 0;
+    size_t next_shard_ = 0;
+    std::atomic<int64_t> open_conns_{0};
+    std::unique_ptr<MetricsExporter> exporter_; // reads the tables and ledger, so goes first
+};
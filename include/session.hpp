@@ -0,0 +1,72 @@
+// session.hpp
+#pragma once
+#include <cstdint>
+#include "bet.hpp"
+#include "roulette.hpp"
+
+/**
+ * Single-player session engine for strategy simulations.
+ *
+ * A strategy is anything with
+ *     Decision decide(double bankroll);
+ *     void observe(int index, const Decision& d, bool won);
+ * where `index` is the table index that hit. Settlement uses the decision's
+ * coverage mask, so no labels are built or parsed per spin.
+ */
+
+struct Decision {
+    enum class Kind : uint8_t { Bet, Skip, Stop };
+
+    Kind kind = Kind::Skip;
+    Bet::Type type = Bet::Type::Red;
+    uint64_t mask = 0;          // coverage_mask() of the bet
+    double odds = 0.0;          // payout_odds of the bet
+    double amount = 0.0;
+
+    static Decision skip() { return Decision{}; }
+    static Decision stop() { Decision d; d.kind = Kind::Stop; return d; }
+    static Decision place(const Bet& bet) {
+        return Decision{ Kind::Bet, bet.type, coverage_mask(bet), bet.payout_odds, bet.amount };
+    }
+};
+
+struct SessionResult {
+    double bankroll = 0.0;      // final bankroll
+    double wagered  = 0.0;
+    int    rounds   = 0;        // spins that had a bet on them
+};
+
+struct SessionLimits {
+    int    max_rounds = 1000;
+    double stop_loss  = 0.0;    // leave once bankroll <= this
+    double target     = 0.0;    // leave once bankroll >= this (0 = never)
+};
+
+// Plays one session. `spin` is any callable returning the next table index,
+// e.g. [&]{ return wheel.spin_index(); } or a cursor into a pre-drawn block.
+template <class Strategy, class Spin>
+SessionResult run_session(Strategy& strategy, Spin&& spin, double bankroll,
+                          const SessionLimits& limits = {}) {
+    SessionResult r;
+    for (int i = 0; i < limits.max_rounds; ++i) {
+        if (bankroll <= limits.stop_loss) break;
+        if (limits.target > 0.0 && bankroll >= limits.target) break;
+
+        Decision d = strategy.decide(bankroll);
+        if (d.kind == Decision::Kind::Stop) break;
+        if (d.kind == Decision::Kind::Bet && !(d.amount > 0.0 && d.amount <= bankroll))
+            d.kind = Decision::Kind::Skip;              // can't cover it (or NaN): sit this one out
+
+        const int idx = spin();
+        bool won = false;
+        if (d.kind == Decision::Kind::Bet) {
+            won = (d.mask >> idx) & 1;
+            bankroll += won ? d.amount * d.odds : -d.amount;
+            r.wagered += d.amount;
+            ++r.rounds;
+        }
+        strategy.observe(idx, d, won);
+    }
+    r.bankroll = bankroll;
+    return r;
+}
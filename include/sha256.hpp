@@ -0,0 +1,180 @@
+// sha256.hpp
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * SHA-256 (FIPS 180-4): a plain streaming hasher, and an 8-lane version
+ * that hashes eight independent messages at once.
+ *
+ * The 8-lane compressor keeps word j of all eight states in one vector
+ * (GCC/Clang vector extensions), so every round is a handful of 8-wide
+ * adds, rotates and bitwise ops: AVX2 on x86-64 when enabled, two NEON or
+ * SSE registers otherwise. Messages may differ in length; lanes that run
+ * out of blocks keep computing on filler and their result is taken at
+ * their own last block.
+ */
+
+using Sha256Digest = std::array<uint8_t, 32>;
+
+namespace sha256_detail {
+
+constexpr uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+constexpr uint32_t H0[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+inline uint32_t load_be(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+inline void store_be(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16); p[2] = (uint8_t)(v >> 8); p[3] = (uint8_t)v;
+}
+
+// Works for uint32_t and for the 8-lane vector type alike. A macro rather
+// than a function so no vector is ever passed by value (-Wpsabi).
+#define SHA256_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+template <class V>
+inline void compress(V s[8], V w[16]) {
+    V a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+    for (int i = 0; i < 64; ++i) {
+        V wi;
+        if (i < 16) {
+            wi = w[i];
+        } else {
+            V w15 = w[(i - 15) & 15], w2 = w[(i - 2) & 15];
+            V s0 = SHA256_ROTR(w15, 7) ^ SHA256_ROTR(w15, 18) ^ (w15 >> 3);
+            V s1 = SHA256_ROTR(w2, 17) ^ SHA256_ROTR(w2, 19) ^ (w2 >> 10);
+            wi = w[i & 15] = w[i & 15] + s0 + w[(i - 7) & 15] + s1;
+        }
+        V t1 = h + (SHA256_ROTR(e, 6) ^ SHA256_ROTR(e, 11) ^ SHA256_ROTR(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + wi;
+        V t2 = (SHA256_ROTR(a, 2) ^ SHA256_ROTR(a, 13) ^ SHA256_ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    s[0] += a; s[1] += b; s[2] += c; s[3] += d;
+    s[4] += e; s[5] += f; s[6] += g; s[7] += h;
+}
+
+#undef SHA256_ROTR
+
+// Block `b` of the padded form of a `len`-byte message that follows
+// `prefix` already-hashed bytes (a multiple of 64).
+inline void padded_block(const uint8_t* msg, size_t len, size_t b, uint8_t out[64], uint64_t prefix = 0) {
+    const size_t off = b * 64;
+    size_t n = off < len ? std::min<size_t>(64, len - off) : 0;
+    std::memcpy(out, msg + off, n);
+    std::memset(out + n, 0, 64 - n);
+    if (off + 64 > len && off <= len) out[len - off] = 0x80;
+    const size_t blocks = (len + 9 + 63) / 64;
+    if (b == blocks - 1) {
+        const uint64_t bits = (prefix + len) * 8;
+        for (int i = 0; i < 8; ++i) out[56 + i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+}
+
+} // namespace sha256_detail
+
+class Sha256 {
+public:
+    Sha256() { std::memcpy(s_, sha256_detail::H0, sizeof s_); }
+
+    // Chaining state; meaningful when the bytes fed so far fill whole blocks.
+    const uint32_t* midstate() const { return s_; }
+    uint64_t bytes() const { return total_; }
+
+    void update(const void* data, size_t len) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        total_ += len;
+        if (fill_) {
+            size_t n = std::min(len, 64 - fill_);
+            std::memcpy(buf_ + fill_, p, n);
+            fill_ += n; p += n; len -= n;
+            if (fill_ < 64) return;
+            block(buf_);
+            fill_ = 0;
+        }
+        for (; len >= 64; p += 64, len -= 64) block(p);
+        std::memcpy(buf_, p, len);
+        fill_ = len;
+    }
+
+    Sha256Digest final() {
+        const uint64_t bits = total_ * 8;
+        uint8_t pad[64] = { 0x80 };
+        update(pad, (fill_ < 56 ? 56 : 120) - fill_);
+        uint8_t be[8];
+        for (int i = 0; i < 8; ++i) be[i] = (uint8_t)(bits >> (56 - 8 * i));
+        update(be, 8);
+        Sha256Digest d;
+        for (int i = 0; i < 8; ++i) sha256_detail::store_be(d.data() + 4 * i, s_[i]);
+        return d;
+    }
+
+private:
+    void block(const uint8_t* p) {
+        uint32_t w[16];
+        for (int i = 0; i < 16; ++i) w[i] = sha256_detail::load_be(p + 4 * i);
+        sha256_detail::compress(s_, w);
+    }
+
+    uint32_t s_[8];
+    uint8_t buf_[64];
+    size_t fill_ = 0;
+    uint64_t total_ = 0;
+};
+
+inline Sha256Digest sha256(const void* data, size_t len) {
+    Sha256 h;
+    h.update(data, len);
+    return h.final();
+}
+
+// Hashes up to 8 messages in parallel; lanes past `count` are ignored.
+// With `init`, every lane continues from that midstate after `prefix`
+// bytes (a multiple of 64), e.g. a keyed HMAC pad.
+inline void sha256_x8(const uint8_t* const msgs[], const size_t lens[], Sha256Digest out[], int count,
+                      const uint32_t* init = nullptr, uint64_t prefix = 0) {
+    using namespace sha256_detail;
+    typedef uint32_t u32x8 __attribute__((vector_size(32)));
+
+    size_t blocks[8] = {}, most = 0;
+    for (int l = 0; l < count; ++l) {
+        blocks[l] = (lens[l] + 9 + 63) / 64;
+        most = std::max(most, blocks[l]);
+    }
+
+    u32x8 s[8];
+    for (int j = 0; j < 8; ++j) s[j] = u32x8{} + (init ? init[j] : H0[j]);
+
+    alignas(32) uint8_t buf[8][64];
+    for (size_t b = 0; b < most; ++b) {
+        u32x8 w[16];
+        for (int l = 0; l < 8; ++l) {
+            if (l < count && b < blocks[l]) padded_block(msgs[l], lens[l], b, buf[l], prefix);
+            else std::memset(buf[l], 0, 64);
+        }
+        for (int j = 0; j < 16; ++j)
+            for (int l = 0; l < 8; ++l) w[j][l] = load_be(buf[l] + 4 * j);
+        compress(s, w);
+
+        for (int l = 0; l < count; ++l)
+            if (b + 1 == blocks[l])
+                for (int j = 0; j < 8; ++j) store_be(out[l].data() + 4 * j, s[j][l]);
+    }
+}
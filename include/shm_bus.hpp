@@ -0,0 +1,290 @@
+// shm_bus.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+/**
+ * Shared-memory bus of round results, for other processes on the host.
+ *
+ * The server process owns a POSIX shared-memory ring (shm_open, so
+ * /dev/shm/<name> on Linux) of fixed 64-byte slots, one RoundRecord per
+ * finished round. Any number of reader processes map it and walk it at
+ * their own pace, each with its own cursor; the writer never waits for them, so a reader that
+ * falls more than a ring behind loses the oldest records and is told how
+ * many (Overrun).
+ *
+ * Each slot is a seqlock: the writer marks it busy, copies the record and
+ * publishes the record's sequence number; a reader copies the slot and
+ * keeps the copy only if the sequence was the one it wanted before and
+ * after. Writer threads of the one process claim record numbers with a
+ * fetch_add and never wait for each other; a reader whose next record is
+ * claimed but not yet written simply finds it not ready.
+ *
+ * Idle readers sleep on a futex in the shared header that the writer bumps
+ * per record, and is only woken (a syscall) when someone is waiting. Off
+ * Linux there is no cross-process futex to use, so waiting falls back to
+ * short sleeps.
+ */
+
+struct RoundRecord {
+    static constexpr uint64_t NO_NONCE = UINT64_MAX;
+
+    uint64_t round = 0;
+    uint64_t nonce = NO_NONCE;      // provably fair nonce
+    int64_t time_ns = 0;            // system clock at settlement
+    double staked = 0.0;            // all seats
+    double paid = 0.0;
+    uint32_t table = 0;
+    uint32_t settlements = 0;       // seats that had bets
+    uint8_t index = 0;              // pocket index on the table's wheel
+    char label[3] = {};             // NUL-padded, unterminated for "000"
+    uint32_t reserved = 0;
+};
+static_assert(sizeof(RoundRecord) == 56, "bus records are part of the shared layout");
+
+namespace bus_detail {
+
+constexpr uint64_t MAGIC = 0x3130535542544c52ull;     // "RLTBUS01"
+
+struct Slot {
+    std::atomic<uint64_t> seq;      // record number + 1 once written; 0 while being written
+    RoundRecord rec;
+};
+static_assert(sizeof(Slot) == 64);
+
+struct Header {
+    std::atomic<uint64_t> ready;    // MAGIC once the writer has set up the rest
+    uint64_t capacity;              // slots, a power of two
+    uint32_t record_size;
+    int32_t writer_pid;
+    alignas(64) std::atomic<uint64_t> head{0};      // record numbers handed out to writer threads
+    alignas(64) std::atomic<uint32_t> wake{0};      // futex word, bumped per record
+    std::atomic<uint32_t> waiters{0};
+    std::atomic<uint32_t> closed{0};
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "shared-memory atomics must be lock-free to work across processes");
+
+inline size_t mapping_size(uint64_t capacity) { return sizeof(Header) + capacity * sizeof(Slot); }
+
+inline Slot* slots(Header* h) { return reinterpret_cast<Slot*>(h + 1); }
+
+inline void futex_wake(std::atomic<uint32_t>* w) {
+#if defined(__linux__)
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(w), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+    (void)w;
+#endif
+}
+
+// Sleeps while *w == expected, at most `timeout`.
+inline void futex_wait(std::atomic<uint32_t>* w, uint32_t expected, std::chrono::nanoseconds timeout) {
+#if defined(__linux__)
+    timespec ts{ (time_t)(timeout.count() / 1000000000), (long)(timeout.count() % 1000000000) };
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(w), FUTEX_WAIT, expected, &ts, nullptr, 0);
+#else
+    if (w->load(std::memory_order_acquire) == expected)
+        std::this_thread::sleep_for(std::min<std::chrono::nanoseconds>(timeout, std::chrono::microseconds(50)));
+#endif
+}
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+} // namespace bus_detail
+
+class SpinBusWriter {
+public:
+    // Replaces any ring already published under `name` (a name like
+    // "/roulette-bus"); capacity is rounded up to a power of two.
+    SpinBusWriter(std::string name, size_t capacity) : name_(std::move(name)) {
+        uint64_t cap = 1024;
+        while (cap < capacity) cap <<= 1;
+        size_ = bus_detail::mapping_size(cap);
+
+        ::shm_unlink(name_.c_str());
+        int fd = ::shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd < 0) throw std::runtime_error("bus shm_open failed: " + std::string(std::strerror(errno)));
+        if (::ftruncate(fd, (off_t)size_) != 0) {
+            ::close(fd);
+            throw std::runtime_error("bus ftruncate failed: " + std::string(std::strerror(errno)));
+        }
+        void* p = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) throw std::runtime_error("bus mmap failed: " + std::string(std::strerror(errno)));
+
+        h_ = new (p) bus_detail::Header{};      // fresh pages are zero, slots included
+        h_->capacity = cap;
+        h_->record_size = sizeof(RoundRecord);
+        h_->writer_pid = (int32_t)::getpid();
+        mask_ = cap - 1;
+        h_->ready.store(bus_detail::MAGIC, std::memory_order_release);
+    }
+
+    ~SpinBusWriter() {
+        h_->closed.store(1, std::memory_order_seq_cst);
+        h_->wake.fetch_add(1, std::memory_order_seq_cst);
+        bus_detail::futex_wake(&h_->wake);
+        ::munmap(h_, size_);
+        ::shm_unlink(name_.c_str());
+    }
+
+    SpinBusWriter(const SpinBusWriter&) = delete;
+    SpinBusWriter& operator=(const SpinBusWriter&) = delete;
+
+    // Any thread of this process; never waits for readers.
+    void publish(const RoundRecord& r) {
+        using namespace bus_detail;
+        const uint64_t n = h_->head.fetch_add(1, std::memory_order_relaxed);
+        Slot& s = slots(h_)[n & mask_];
+        // only if another thread is still writing this slot's previous lap
+        while (n > mask_ && s.seq.load(std::memory_order_acquire) != n - mask_) std::this_thread::yield();
+
+        s.seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&s.rec, &r, sizeof r);
+        s.seq.store(n + 1, std::memory_order_release);
+        h_->wake.fetch_add(1, std::memory_order_seq_cst);
+        if (h_->waiters.load(std::memory_order_seq_cst)) futex_wake(&h_->wake);
+    }
+
+    uint64_t published() const { return h_->head.load(std::memory_order_acquire); }     // claimed, at least
+    size_t capacity() const { return mask_ + 1; }
+    const std::string& name() const { return name_; }
+
+private:
+    std::string name_;
+    bus_detail::Header* h_ = nullptr;
+    size_t size_ = 0;
+    uint64_t mask_ = 0;
+};
+
+class SpinBusReader {
+public:
+    enum class Status : uint8_t { Ok, Empty, Overrun, Closed };
+
+    // Starts at the newest record, or at the oldest still in the ring.
+    explicit SpinBusReader(const std::string& name, bool from_oldest = false) {
+        int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) throw std::runtime_error("bus shm_open failed: " + std::string(std::strerror(errno)));
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(bus_detail::Header)) {
+            ::close(fd);
+            throw std::runtime_error("bus " + name + " is not set up");
+        }
+        size_ = (size_t)st.st_size;
+        // read-write only because waiting registers in the header
+        void* p = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) throw std::runtime_error("bus mmap failed: " + std::string(std::strerror(errno)));
+        h_ = static_cast<bus_detail::Header*>(p);
+        if (h_->ready.load(std::memory_order_acquire) != bus_detail::MAGIC ||
+            h_->record_size != sizeof(RoundRecord) || bus_detail::mapping_size(h_->capacity) > size_) {
+            ::munmap(p, size_);
+            throw std::runtime_error("bus " + name + " has an unknown layout");
+        }
+        mask_ = h_->capacity - 1;
+        const uint64_t head = h_->head.load(std::memory_order_acquire);
+        cursor_ = from_oldest && head > mask_ ? head - mask_ - 1 : from_oldest ? 0 : head;
+    }
+
+    ~SpinBusReader() { ::munmap(h_, size_); }
+
+    SpinBusReader(const SpinBusReader&) = delete;
+    SpinBusReader& operator=(const SpinBusReader&) = delete;
+
+    // Copies the next record out. Overrun still delivers a record (the
+    // oldest left) after skipping the ones lost; see lost().
+    Status try_read(RoundRecord& out) {
+        bool skipped = false;
+        for (;;) {
+            const bus_detail::Slot& s = bus_detail::slots(h_)[cursor_ & mask_];
+            const uint64_t seq = s.seq.load(std::memory_order_acquire);
+            if (seq == cursor_ + 1) {
+                std::memcpy(&out, &s.rec, sizeof out);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (s.seq.load(std::memory_order_relaxed) == seq) {
+                    ++cursor_;
+                    return skipped ? Status::Overrun : Status::Ok;
+                }
+            }
+            // Not our record: either not written yet, or the writer has
+            // lapped us and everything more than a ring back is gone.
+            const uint64_t head = h_->head.load(std::memory_order_acquire);
+            if (head - cursor_ <= mask_ + 1 || head < cursor_)
+                return h_->closed.load(std::memory_order_acquire) ? Status::Closed : Status::Empty;
+            lost_ += head - mask_ - 1 - cursor_;
+            cursor_ = head - mask_ - 1;
+            skipped = true;
+        }
+    }
+
+    // Until a record is readable, the writer closes, or `timeout` passes;
+    // true if try_read() has something. Polls for up to `spin` first: a
+    // reader with a core to itself gets sub-microsecond wakeups by spinning
+    // as long as the gap between rounds, everyone else sleeps on the futex.
+    bool wait(std::chrono::nanoseconds timeout, std::chrono::nanoseconds spin = std::chrono::microseconds(20)) {
+        using clock = std::chrono::steady_clock;
+        const auto start = clock::now();
+        for (int i = 0;; ++i) {
+            if (readable()) return true;
+            bus_detail::cpu_relax();
+            if ((i & 63) == 63 && clock::now() - start >= std::min(spin, timeout)) break;
+        }
+        const auto deadline = start + timeout;
+        for (;;) {
+            const uint32_t w = h_->wake.load(std::memory_order_acquire);
+            h_->waiters.fetch_add(1, std::memory_order_seq_cst);
+            const bool ready = readable() || h_->closed.load(std::memory_order_seq_cst);
+            const auto left = deadline - clock::now();
+            if (!ready && left > left.zero()) bus_detail::futex_wait(&h_->wake, w, left);
+            h_->waiters.fetch_sub(1, std::memory_order_relaxed);
+            if (readable()) return true;
+            if (ready || clock::now() >= deadline) return false;
+        }
+    }
+
+    uint64_t cursor() const { return cursor_; }         // records consumed or skipped
+    uint64_t lost() const { return lost_; }             // skipped by overruns
+    uint64_t backlog() const { return h_->head.load(std::memory_order_acquire) - cursor_; }
+    bool closed() const { return h_->closed.load(std::memory_order_acquire) != 0; }
+
+    // false once the writer process is gone, even if it died without closing
+    bool writer_alive() const { return !closed() && (::kill(h_->writer_pid, 0) == 0 || errno == EPERM); }
+
+private:
+    bool readable() const {
+        const uint64_t seq = bus_detail::slots(h_)[cursor_ & mask_].seq.load(std::memory_order_acquire);
+        return seq == cursor_ + 1 || h_->head.load(std::memory_order_acquire) - cursor_ > mask_ + 1;
+    }
+
+    bus_detail::Header* h_ = nullptr;
+    size_t size_ = 0;
+    uint64_t mask_ = 0;
+    uint64_t cursor_ = 0;
+    uint64_t lost_ = 0;
+};
@@ -0,0 +1,399 @@
+// snapshot.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ledger.hpp"
+#include "table.hpp"
+
+/**
+ * Table snapshots and crash recovery.
+ *
+ * A snapshot is every table's TableImage in one compact binary file. Each
+ * table is copied on its own thread between two events (Table::capture), so
+ * no table stops and no global pause is needed; encoding and disk I/O
+ * happen on the SnapshotWriter thread. Every image remembers the last
+ * ledger LSN it reflects, and the file is only published (write, fsync,
+ * rename) once the ledger is durable past all of them.
+ *
+ * Recovery maps the latest snapshot, then replays only the ledger records
+ * newer than each table's LSN. Ledger records are fixed-size, so finding
+ * the tail is a seek, not a scan.
+ *
+ * File layout (native little-endian):
+ *   SnapHeader, then per table: SnapTable, rng text (padded to 8),
+ *   SnapSeat[seats], SnapBet[bets].
+ */
+
+namespace snapshot_detail {
+
+struct SnapHeader {
+    char magic[8];              // "RLTSNAP1"
+    uint32_t version;
+    uint32_t tables;
+    uint64_t body_bytes;
+    uint32_t check;             // FNV-1a of the body
+    uint32_t reserved;
+};
+
+struct SnapTable {
+    uint32_t id;
+    int32_t pending_index;
+    uint64_t round;
+    uint64_t lsn;
+    uint64_t spins_after;
+    uint32_t seats;
+    uint32_t bets;
+    uint32_t rng_bytes;
+    uint32_t reserved;
+};
+
+struct SnapSeat {
+    double balance;
+    uint8_t occupied;
+    char name[23];
+};
+
+struct SnapBet {
+    uint64_t handle;
+    double amount;
+    uint32_t seat;
+    uint8_t type;
+    char selection[11];
+};
+
+static_assert(sizeof(SnapBet::selection) > MAX_SELECTION, "snapshots must hold any accepted selection");
+static_assert(sizeof(LedgerRecord::text) > MAX_SELECTION, "ledger records must hold any accepted selection");
+static_assert(sizeof(SnapHeader) == 32 && sizeof(SnapTable) == 48 &&
+              sizeof(SnapSeat) == 32 && sizeof(SnapBet) == 32, "snapshot records have fixed sizes");
+
+constexpr char MAGIC[8] = { 'R', 'L', 'T', 'S', 'N', 'A', 'P', '1' };
+constexpr uint32_t VERSION = 1;
+
+inline uint32_t fnv1a(const unsigned char* p, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; ++i) h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+template <size_t N>
+void copy_text(char (&dst)[N], const std::string& s) {
+    std::memset(dst, 0, N);
+    std::memcpy(dst, s.data(), std::min(s.size(), N - 1));
+}
+
+template <class T>
+void put(std::vector<unsigned char>& out, const T& v) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(&v);
+    out.insert(out.end(), p, p + sizeof v);
+}
+
+} // namespace snapshot_detail
+
+inline std::vector<unsigned char> encode_snapshot(const std::vector<TableImage>& tables) {
+    using namespace snapshot_detail;
+    std::vector<unsigned char> out(sizeof(SnapHeader));
+    for (const TableImage& t : tables) {
+        SnapTable h{};
+        h.id = t.id;
+        h.pending_index = t.pending_index;
+        h.round = t.round;
+        h.lsn = t.lsn;
+        h.spins_after = t.spins_after;
+        h.seats = (uint32_t)t.seats.size();
+        h.bets = (uint32_t)t.bets.size();
+        h.rng_bytes = (uint32_t)t.rng.size();
+        put(out, h);
+        out.insert(out.end(), t.rng.begin(), t.rng.end());
+        out.resize((out.size() + 7) & ~size_t{7});
+        out.reserve(out.size() + t.seats.size() * sizeof(SnapSeat) + t.bets.size() * sizeof(SnapBet));
+        for (const TableImage::SeatImage& s : t.seats) {
+            SnapSeat r{};
+            r.balance = s.balance;
+            r.occupied = s.occupied;
+            copy_text(r.name, s.name);
+            put(out, r);
+        }
+        for (const TableImage::BetImage& b : t.bets) {
+            SnapBet r{};
+            r.handle = b.handle;
+            r.amount = b.amount;
+            r.seat = b.seat;
+            r.type = (uint8_t)b.type;
+            copy_text(r.selection, b.selection);
+            put(out, r);
+        }
+    }
+
+    SnapHeader hdr{};
+    std::memcpy(hdr.magic, MAGIC, sizeof MAGIC);
+    hdr.version = VERSION;
+    hdr.tables = (uint32_t)tables.size();
+    hdr.body_bytes = out.size() - sizeof hdr;
+    hdr.check = fnv1a(out.data() + sizeof hdr, hdr.body_bytes);
+    std::memcpy(out.data(), &hdr, sizeof hdr);
+    return out;
+}
+
+// Writes to `path`.tmp, syncs, and renames over `path`, so a crash leaves
+// either the old snapshot or the new one.
+inline void write_snapshot(const std::string& path, const std::vector<unsigned char>& bytes) {
+    const std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) throw std::runtime_error("snapshot open failed: " + std::string(std::strerror(errno)));
+    const unsigned char* p = bytes.data();
+    size_t left = bytes.size();
+    while (left > 0) {
+        ssize_t n = ::write(fd, p, left);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            ::close(fd);
+            throw std::runtime_error("snapshot write failed: " + std::string(std::strerror(errno)));
+        }
+        p += n;
+        left -= (size_t)n;
+    }
+    // the rename must not publish a file that isn't on disk yet
+    if (::fsync(fd) != 0) {
+        const int err = errno;
+        ::close(fd);
+        ::unlink(tmp.c_str());
+        throw std::runtime_error("snapshot sync failed: " + std::string(std::strerror(err)));
+    }
+    if (::close(fd) != 0) {
+        const int err = errno;
+        ::unlink(tmp.c_str());
+        throw std::runtime_error("snapshot close failed: " + std::string(std::strerror(err)));
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        const int err = errno;
+        ::unlink(tmp.c_str());
+        throw std::runtime_error("snapshot rename failed: " + std::string(std::strerror(err)));
+    }
+
+    const size_t slash = path.find_last_of('/');
+    const std::string dir = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+    int dfd = ::open(dir.c_str(), O_RDONLY | O_CLOEXEC);
+    if (dfd < 0) throw std::runtime_error("snapshot dir open failed: " + std::string(std::strerror(errno)));
+    const bool synced = ::fsync(dfd) == 0;
+    const int err = errno;
+    ::close(dfd);
+    if (!synced) throw std::runtime_error("snapshot dir sync failed: " + std::string(std::strerror(err)));
+}
+
+// Maps and decodes a snapshot; false if there is none or it doesn't check out.
+inline bool load_snapshot(const std::string& path, std::vector<TableImage>& out) {
+    using namespace snapshot_detail;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapHeader)) { ::close(fd); return false; }
+    const size_t size = (size_t)st.st_size;
+    void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return false;
+    const unsigned char* base = static_cast<const unsigned char*>(map);
+
+    bool ok = false;
+    SnapHeader hdr;
+    std::memcpy(&hdr, base, sizeof hdr);
+    if (std::memcmp(hdr.magic, MAGIC, sizeof MAGIC) == 0 && hdr.version == VERSION &&
+        hdr.body_bytes == size - sizeof hdr && hdr.check == fnv1a(base + sizeof hdr, hdr.body_bytes)) {
+        std::vector<TableImage> tables(hdr.tables);
+        size_t at = sizeof hdr;
+        ok = true;
+        for (TableImage& t : tables) {
+            SnapTable h;
+            if (at + sizeof h > size) { ok = false; break; }
+            std::memcpy(&h, base + at, sizeof h);
+            at += sizeof h;
+            const size_t need = ((h.rng_bytes + 7) & ~size_t{7}) + (size_t)h.seats * sizeof(SnapSeat) +
+                                (size_t)h.bets * sizeof(SnapBet);
+            if (at + need > size) { ok = false; break; }
+
+            t.id = h.id;
+            t.pending_index = h.pending_index;
+            t.round = h.round;
+            t.lsn = h.lsn;
+            t.spins_after = h.spins_after;
+            t.rng.assign(reinterpret_cast<const char*>(base + at), h.rng_bytes);
+            at += (h.rng_bytes + 7) & ~size_t{7};
+
+            t.seats.resize(h.seats);
+            for (TableImage::SeatImage& s : t.seats) {
+                SnapSeat r;
+                std::memcpy(&r, base + at, sizeof r);
+                at += sizeof r;
+                s.name.assign(r.name, strnlen(r.name, sizeof r.name));
+                s.balance = r.balance;
+                s.occupied = r.occupied != 0;
+            }
+            t.bets.reserve(h.bets);
+            for (uint32_t i = 0; i < h.bets; ++i) {
+                SnapBet r;
+                std::memcpy(&r, base + at, sizeof r);
+                at += sizeof r;
+                t.bets.push_back(TableImage::BetImage{ r.handle, r.seat, (Bet::Type)r.type,
+                                                       std::string(r.selection, strnlen(r.selection, sizeof r.selection)),
+                                                       r.amount });
+            }
+        }
+        if (ok) out = std::move(tables);
+    }
+    ::munmap(map, size);
+    return ok;
+}
+
+// Applies one ledger record to the image of the table it belongs to.
+inline void apply_record(TableImage& t, const LedgerRecord& r) {
+    using Kind = LedgerRecord::Kind;
+    auto drop_bets = [&](uint32_t seat) {
+        t.bets.erase(std::remove_if(t.bets.begin(), t.bets.end(),
+                                    [&](const TableImage::BetImage& b) { return b.seat == seat; }),
+                     t.bets.end());
+    };
+    auto find_bet = [&](uint64_t handle) {
+        return std::find_if(t.bets.begin(), t.bets.end(),
+                            [&](const TableImage::BetImage& b) { return b.handle == handle; });
+    };
+
+    t.lsn = r.lsn;
+    if (r.kind != Kind::Spin && r.seat >= t.seats.size()) t.seats.resize(r.seat + 1);
+    switch (r.kind) {
+        case Kind::Sit:
+            t.seats[r.seat] = TableImage::SeatImage{ std::string(r.text, strnlen(r.text, sizeof r.text)), r.balance, true };
+            break;
+        case Kind::Leave:
+            t.seats[r.seat].occupied = false;
+            drop_bets(r.seat);
+            break;
+        case Kind::Place:
+            if (t.pending_index >= 0) {         // betting reopened, so the drawn round settled
+                t.pending_index = -1;
+                ++t.round;
+            }
+            t.seats[r.seat].balance = r.balance;
+            t.bets.push_back(TableImage::BetImage{ r.ref, r.seat, (Bet::Type)r.bet_type,
+                                                   std::string(r.text, strnlen(r.text, sizeof r.text)), r.amount });
+            break;
+        case Kind::Cancel: {
+            t.seats[r.seat].balance = r.balance;
+            auto it = find_bet(r.ref);
+            if (it != t.bets.end()) t.bets.erase(it);
+            break;
+        }
+        case Kind::Modify: {
+            t.seats[r.seat].balance = r.balance;
+            auto it = find_bet(r.ref);
+            if (it != t.bets.end()) it->amount = r.amount;
+            break;
+        }
+        case Kind::Settle:              // one settle() pays every bet, so the book empties
+            t.seats[r.seat].balance = r.balance;
+            t.bets.clear();
+            t.pending_index = -1;
+            t.round = r.ref + 1;
+            break;
+        case Kind::Spin:
+            ++t.spins_after;
+            t.pending_index = (int)r.amount;
+            t.round = r.ref;
+            break;
+    }
+}
+
+// Latest snapshot plus the ledger tail, for `tables` tables.
+inline std::vector<TableImage> recover_tables(const std::string& snapshot_path,
+                                              const std::string& ledger_path, int tables) {
+    std::vector<TableImage> images;
+    if (!snapshot_path.empty()) load_snapshot(snapshot_path, images);
+    std::vector<TableImage> by_id(tables);
+    for (int i = 0; i < tables; ++i) by_id[i].id = (uint32_t)i;
+    for (TableImage& t : images)
+        if (t.id < (uint32_t)tables) by_id[t.id] = std::move(t);
+
+    uint64_t from = UINT64_MAX;
+    for (const TableImage& t : by_id) from = std::min(from, t.lsn);
+    replay_ledger(ledger_path, from, [&](const LedgerRecord& r) {
+        if (r.table >= (uint32_t)tables) return;
+        TableImage& t = by_id[r.table];
+        if (r.lsn > t.lsn) apply_record(t, r);
+    });
+    return by_id;
+}
+
+/**
+ * Background snapshot thread: encodes and publishes whatever set of images
+ * it was handed last, dropping older requests it hasn't got to yet.
+ */
+class SnapshotWriter {
+public:
+    SnapshotWriter(std::string path, Ledger* ledger)
+    : path_(std::move(path)), ledger_(ledger), thread_([this] { run(); }) {}
+
+    ~SnapshotWriter() {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            stopping_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    void submit(std::vector<TableImage> tables) {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            pending_ = std::move(tables);
+            has_pending_ = true;
+        }
+        cv_.notify_one();
+    }
+
+    uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+
+private:
+    void run() {
+        for (;;) {
+            std::vector<TableImage> job;
+            {
+                std::unique_lock<std::mutex> lk(mu_);
+                cv_.wait(lk, [&] { return stopping_ || has_pending_; });
+                if (!has_pending_) return;
+                job.swap(pending_);
+                has_pending_ = false;
+            }
+            uint64_t lsn = 0;
+            for (const TableImage& t : job) lsn = std::max(lsn, t.lsn);
+            if (ledger_) ledger_->wait_durable(lsn);     // never publish state the ledger could lose
+            write_snapshot(path_, encode_snapshot(job));
+            written_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    std::string path_;
+    Ledger* ledger_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::vector<TableImage> pending_;
+    bool has_pending_ = false;
+    bool stopping_ = false;
+    std::atomic<uint64_t> written_{0};
+    std::thread thread_;
+};
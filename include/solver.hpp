@@ -0,0 +1,230 @@
+// solver.hpp
+#pragma once
+#include <algorithm>
+#include <barrier>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "bet.hpp"
+#include "roulette.hpp"
+
+/**
+ * Bold-play / optimal-stake solver.
+ *
+ * Finds the stake-and-bet policy that maximizes the probability of growing
+ * a bankroll to a target (Dubins–Savage "how to gamble if you must").
+ * The bankroll is discretized in units of `unit` (the table minimum by
+ * default) so state b means b * unit dollars; 0 is ruin, N is the target.
+ *
+ * For every state the solver considers every legal stake between the table
+ * minimum and maximum and every payout class from Bet::Type, and runs value
+ * iteration until the reach-probability converges:
+ *
+ *     V[b] = max over (type, s) of  p * V[min(b + s*odds, N)] + (1-p) * V[b - s]
+ *
+ * The kernel loops over contiguous states for a fixed (type, stake), so the
+ * inner loop is two unit-stride loads, an fma and a max — the compiler
+ * vectorizes it. Blocks of states are swept top-down so a win's value is
+ * already fresh (Gauss–Seidel between blocks). States are split into
+ * per-thread ranges that only sync on a barrier between sweeps.
+ *
+ * Cost per sweep is O(N * stakes * 7): keep (table_max / unit) reasonable
+ * for large grids.
+ */
+
+struct SolverConfig {
+    Wheel::Type wheel = Wheel::Type::European;
+    double bankroll  = 100.0;
+    double target    = 200.0;
+    double table_min = 1.0;
+    double table_max = 500.0;
+    double unit      = 0.0;      // grid step; 0 = table_min
+    int    threads   = 0;        // 0 = hardware_concurrency
+    double tolerance = 1e-10;    // stop when no state moves by more than this
+    int    max_sweeps = 100000;
+};
+
+class BoldPlaySolver {
+public:
+    explicit BoldPlaySolver(const SolverConfig& cfg) : cfg_(cfg) {
+        if (cfg_.unit <= 0.0) cfg_.unit = cfg_.table_min;
+        if (cfg_.unit <= 0.0 || cfg_.target <= 0.0 || cfg_.table_max < cfg_.table_min)
+            throw std::invalid_argument("invalid solver config");
+
+        n_         = (int)std::ceil(cfg_.target / cfg_.unit - 1e-9);
+        min_stake_ = std::max(1, (int)std::ceil(cfg_.table_min / cfg_.unit - 1e-9));
+        max_stake_ = (int)std::floor(cfg_.table_max / cfg_.unit + 1e-9);
+        if (max_stake_ < min_stake_) throw std::invalid_argument("table max below table min");
+
+        const double pockets = pocket_count(cfg_.wheel);
+        // one representative per payout class; Column/Dozen and the even-money
+        // bets are identical to the solver
+        for (Bet::Type t : { Bet::Type::Straight, Bet::Type::Split, Bet::Type::Street,
+                             Bet::Type::Corner, Bet::Type::SixLine, Bet::Type::Dozen,
+                             Bet::Type::Red }) {
+            Class c;
+            c.type = t;
+            c.odds = (int)Bet(t, "", 0.0).payout_odds;
+            c.p    = pockets_covered(t) / pockets;
+            classes_.push_back(c);
+        }
+    }
+
+    // Runs value iteration to convergence and extracts the policy.
+    void solve() {
+        const int N = n_;
+        value_.assign(N + 1, 0.0);
+        value_[N] = 1.0;
+        std::vector<double> next(value_);
+
+        int nthreads = cfg_.threads > 0 ? cfg_.threads
+                                        : (int)std::max(1u, std::thread::hardware_concurrency());
+        nthreads = std::max(1, std::min(nthreads, std::max(1, (N - 1) / 4096)));
+
+        std::vector<double> deltas(nthreads, 0.0);
+        bool done = false;
+        sweeps_ = 0;
+
+        double* cur = value_.data();
+        double* nxt = next.data();
+
+        // runs once per sweep, after every worker has written its range
+        auto on_sweep = [&]() noexcept {
+            double d = *std::max_element(deltas.begin(), deltas.end());
+            ++sweeps_;
+            if (nthreads > 1) std::swap(cur, nxt);
+            done = d <= cfg_.tolerance || sweeps_ >= cfg_.max_sweeps;
+        };
+        std::barrier sync(nthreads, on_sweep);
+
+        // A single thread updates in place. With several, each one works on a
+        // private copy of the window its range can read, and publishes its
+        // range into the other buffer; ranges see each other one sweep late.
+        auto worker = [&](int t) {
+            const int lo = 1 + (int)((int64_t)(N - 1) * t / nthreads);
+            const int hi = 1 + (int)((int64_t)(N - 1) * (t + 1) / nthreads);
+            const int wlo = std::max(0, lo - max_stake_);
+            const int whi = std::min(N, hi - 1 + max_stake_ * classes_.front().odds) + 1;
+            std::vector<double> local(nthreads > 1 ? N + 1 : 0);
+
+            while (!done) {
+                double* buf = cur;
+                if (nthreads > 1) {
+                    buf = local.data();
+                    std::copy(cur + wlo, cur + whi, buf + wlo);
+                }
+                deltas[t] = sweep_range(buf, lo, hi);
+                if (nthreads > 1) std::copy(buf + lo, buf + hi, nxt + lo);
+                sync.arrive_and_wait();
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (int t = 1; t < nthreads; ++t) pool.emplace_back(worker, t);
+        worker(0);
+        for (auto& th : pool) th.join();
+
+        if (cur != value_.data()) value_.assign(cur, cur + N + 1);
+        extract_policy();
+    }
+
+    // Probability of reaching the target from `bankroll` under the optimal policy.
+    double win_probability(double bankroll) const { return value_.at(state_of(bankroll)); }
+    double win_probability() const { return win_probability(cfg_.bankroll); }
+
+    // Optimal bet at `bankroll`; amount 0 means there is nothing left to do
+    // (ruined, below the table minimum, or already at the target).
+    Bet best_bet(double bankroll) const {
+        int b = state_of(bankroll);
+        if (stake_.empty() || stake_[b] == 0) return Bet(Bet::Type::Red, "", 0.0);
+        return Bet(classes_[class_[b]].type, "", stake_[b] * cfg_.unit);
+    }
+    Bet best_bet() const { return best_bet(cfg_.bankroll); }
+
+    int states() const { return n_ + 1; }
+    int sweeps() const { return sweeps_; }
+    const std::vector<double>& values() const { return value_; }
+
+private:
+    struct Class {
+        Bet::Type type;
+        int odds;
+        double p;
+    };
+
+    int state_of(double bankroll) const {
+        int b = (int)std::floor(bankroll / cfg_.unit + 1e-9);
+        return std::clamp(b, 0, n_);
+    }
+
+    // Bellman update of v[lo, hi) in place, walking down in blocks so that
+    // wins (which move up) already see this sweep's values. Inside a block
+    // the update is Jacobi so the per-stake loop over b stays vectorizable.
+    // Returns the largest change.
+    double sweep_range(double* v, int lo, int hi) const {
+        constexpr int BLOCK = 512;
+        const int N = n_;
+        double acc[BLOCK];
+        double delta = 0.0;
+
+        for (int bhi = hi, blo; bhi > lo; bhi = blo) {
+            blo = std::max(lo, bhi - BLOCK);
+            std::copy(v + blo, v + bhi, acc);            // iterates only grow
+
+            for (const Class& c : classes_) {
+                const double p = c.p, q = 1.0 - c.p;
+                const int smax = std::min(max_stake_, bhi - 1);
+                for (int s = min_stake_; s <= smax; ++s) {
+                    const int win_shift = s * c.odds;
+                    const int b0 = std::max(blo, s);
+                    const int split = std::clamp(N - win_shift, b0, bhi);   // b >= split wins to target
+                    for (int b = b0; b < split; ++b)
+                        acc[b - blo] = std::max(acc[b - blo], p * v[b + win_shift] + q * v[b - s]);
+                    for (int b = split; b < bhi; ++b)
+                        acc[b - blo] = std::max(acc[b - blo], p + q * v[b - s]);
+                }
+            }
+
+            for (int b = blo; b < bhi; ++b) {
+                delta = std::max(delta, acc[b - blo] - v[b]);
+                v[b] = acc[b - blo];
+            }
+        }
+        return delta;
+    }
+
+    // one more Bellman pass over the converged values, remembering the argmax;
+    // ties go to the larger stake (bold play)
+    void extract_policy() {
+        const int N = n_;
+        stake_.assign(N + 1, 0);
+        class_.assign(N + 1, 0);
+        for (int b = 1; b < N; ++b) {
+            double best = 0.0;
+            for (size_t ci = 0; ci < classes_.size(); ++ci) {
+                const Class& c = classes_[ci];
+                for (int s = min_stake_; s <= std::min(max_stake_, b); ++s) {
+                    int up = std::min(N, b + s * c.odds);
+                    double v = c.p * value_[up] + (1.0 - c.p) * value_[b - s];
+                    if (v >= best - 1e-15 && v > 0.0) {
+                        best = std::max(best, v);
+                        stake_[b] = s;
+                        class_[b] = (uint8_t)ci;
+                    }
+                }
+            }
+        }
+    }
+
+    SolverConfig cfg_;
+    int n_ = 0;
+    int min_stake_ = 1;
+    int max_stake_ = 1;
+    int sweeps_ = 0;
+    std::vector<Class> classes_;
+    std::vector<double> value_;
+    std::vector<int> stake_;
+    std::vector<uint8_t> class_;
+};
@@ -0,0 +1,191 @@
+// spin_ahead.hpp
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "roulette.hpp"
+
+/**
+ * Spins drawn ahead of time on a background thread, so the table thread's
+ * spin is a pop from a ring however slow or bursty the generator is.
+ *
+ * The producer owns a copy of the wheel and draws in chunks of CHUNK spins,
+ * keeping a copy of the wheel as it stood at the start of each chunk. The
+ * ring is single-producer single-consumer; the producer sleeps when it is
+ * full and the consumer wakes it once it has drained half.
+ *
+ * The sequence is exactly the wheel's own: position() spins in, state()
+ * and offset() say where a restore must pick up (the engine at the start of
+ * the current chunk, and how many of its spins were taken), which is what
+ * TableImage's rng / spins_after already mean. reseed() drops everything
+ * drawn from the old state and starts again from the new one.
+ *
+ * pop() never generates on the caller's thread; if the ring is ever empty
+ * (the consumer outran the producer) it spins until the next one lands.
+ *
+ * Both this and InlineSpins are SpinSources, which is how a Table takes
+ * its spins from a wheel other than its own (see Table::set_spin_source).
+ */
+
+// Where a table's spins come from, and how to get back to the same place.
+struct SpinSource {
+    virtual ~SpinSource() = default;
+    virtual int pop() = 0;
+    virtual std::string state() const = 0;     // engine state a restore starts from...
+    virtual uint64_t offset() const = 0;       // ...and the spins taken since it
+    // Continues from `state` after `spins_after` spins; throws
+    // std::invalid_argument for another engine's state.
+    virtual void restore(const std::string& state, uint64_t spins_after) = 0;
+};
+
+// Spins drawn when they are needed, from any BasicWheel.
+template <class W>
+class InlineSpins : public SpinSource {
+public:
+    explicit InlineSpins(W wheel) : wheel_(std::move(wheel)) {}
+
+    int pop() override { return wheel_.spin_index(); }
+    std::string state() const override { return wheel_.rng_state(); }
+    uint64_t offset() const override { return 0; }
+    void restore(const std::string& state, uint64_t spins_after) override {
+        wheel_.set_rng_state(state);
+        for (uint64_t i = 0; i < spins_after; ++i) wheel_.spin_index();
+    }
+
+private:
+    W wheel_;
+};
+
+template <class W>
+class BasicSpinAhead : public SpinSource {
+public:
+    static constexpr uint32_t CHUNK = 256;
+
+    // Fills the ring before returning, so the first pops never wait.
+    explicit BasicSpinAhead(const W& wheel, uint32_t capacity = 4096) {
+        uint32_t cap = CHUNK;
+        while (cap < capacity) cap <<= 1;
+        ring_.assign(cap, 0);
+        states_.assign(cap / CHUNK + 1, wheel);
+        start(wheel);
+    }
+
+    ~BasicSpinAhead() override { halt(); }
+
+    BasicSpinAhead(const BasicSpinAhead&) = delete;
+    BasicSpinAhead& operator=(const BasicSpinAhead&) = delete;
+
+    // consumer thread
+    int pop() override {
+        const uint64_t h = head_.load(std::memory_order_relaxed);
+        while (tail_.load(std::memory_order_acquire) == h) std::this_thread::yield();
+        const int index = ring_[h & (ring_.size() - 1)];
+        head_.store(h + 1, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting_.load(std::memory_order_relaxed) && tail_.load(std::memory_order_relaxed) - (h + 1) <= ring_.size() / 2 &&
+            waiting_.exchange(false, std::memory_order_seq_cst))
+            wake();
+        return index;
+    }
+
+    // Consumer thread: spins popped since the last reseed, and where that
+    // leaves the engine (see above). A position on a chunk boundary counts
+    // as the end of the previous chunk, whose state is certain to be there.
+    uint64_t position() const { return head_.load(std::memory_order_relaxed); }
+    std::string state() const override { return states_[chunk_slot(chunk_of(position()))].rng_state(); }
+    uint64_t offset() const override { return position() - chunk_of(position()) * CHUNK; }
+
+    void restore(const std::string& state, uint64_t spins_after) override {
+        W w = states_[0];
+        w.set_rng_state(state);
+        for (uint64_t i = 0; i < spins_after; ++i) w.spin_index();
+        reseed(w);
+    }
+
+    // Consumer thread: forgets every spin drawn so far and continues from `wheel`.
+    void reseed(const W& wheel) {
+        halt();
+        head_.store(0);
+        tail_.store(0);
+        start(wheel);
+    }
+
+    size_t capacity() const { return ring_.size(); }
+
+private:
+    size_t chunk_slot(uint64_t chunk) const { return chunk % states_.size(); }
+    static uint64_t chunk_of(uint64_t pos) { return pos ? (pos - 1) / CHUNK : 0; }
+
+    void wake() {
+        wake_.fetch_add(1, std::memory_order_seq_cst);
+        wake_.notify_one();
+    }
+
+    void start(const W& wheel) {
+        stopping_.store(false);
+        W w = wheel;
+        fill(w, ring_.size());
+        thread_ = std::thread([this, w]() mutable { run(w); });
+    }
+
+    void halt() {
+        if (!thread_.joinable()) return;
+        stopping_.store(true);
+        wake();
+        thread_.join();
+    }
+
+    // Draws up to `n` spins, as far as the ring has room; the chunk state
+    // is saved before any of the chunk's spins are published.
+    void fill(W& w, size_t n) {
+        const uint64_t head = head_.load(std::memory_order_acquire);
+        uint64_t t = tail_.load(std::memory_order_relaxed);
+        for (; n-- > 0 && t - head < ring_.size(); ++t) {
+            if (t % CHUNK == 0) states_[chunk_slot(t / CHUNK)] = w;
+            ring_[t & (ring_.size() - 1)] = (uint16_t)w.spin_index();
+            if ((t + 1) % 64 == 0) tail_.store(t + 1, std::memory_order_release);
+        }
+        tail_.store(t, std::memory_order_release);
+    }
+
+    void run(W w) {
+        while (!stopping_.load()) {
+            fill(w, CHUNK);
+            const uint64_t head = head_.load(std::memory_order_acquire);
+            if (tail_.load(std::memory_order_relaxed) - head < ring_.size()) continue;
+            const uint32_t seen = wake_.load(std::memory_order_seq_cst);
+            waiting_.store(true, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (head_.load(std::memory_order_seq_cst) == head && !stopping_.load()) wake_.wait(seen, std::memory_order_seq_cst);
+            waiting_.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    std::vector<uint16_t> ring_;
+    std::vector<W> states_;                      // the wheel at the start of each chunk in flight
+    alignas(64) std::atomic<uint64_t> head_{0}; // popped
+    alignas(64) std::atomic<uint64_t> tail_{0}; // published
+    std::atomic<bool> waiting_{false};          // producer is (about to be) asleep on wake_
+    std::atomic<uint32_t> wake_{0};
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+};
+
+using SpinAhead = BasicSpinAhead<Wheel>;
+
+// A source whose engine state is a secret (a key from the OS, as for
+// SecureWheel): state() is empty, so a snapshot never holds the key and a
+// restore keeps the source's own fresh key. The sequence does not survive
+// a restart, only the tables' bets and balances.
+template <class S>
+class UnsavedSpins : public S {
+public:
+    using S::S;
+
+    std::string state() const override { return {}; }
+    uint64_t offset() const override { return 0; }
+    void restore(const std::string&, uint64_t) override {}
+};
@@ -0,0 +1,418 @@
+// strategy.hpp
+#pragma once
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bet.hpp"
+#include "roulette.hpp"
+#include "session.hpp"
+
+/**
+ * Betting strategy language.
+ *
+ * A strategy is a list of rules, one per line, tried top to bottom; the
+ * first one whose condition holds decides the round. No match = no bet.
+ *
+ *     # martingale on red, give up after 6 losses
+ *     if loss_streak >= 6: stop
+ *     if lost: bet red stake * 2
+ *     if profit >= 200: stop
+ *     bet red 10
+ *     bet straight 17 max(1, bankroll / 100)
+ *
+ * Actions:   bet <kind> [selection] <amount> | skip | stop
+ *            kinds are the Bet::Type names (straight, split, street, corner,
+ *            sixline, column, dozen, red, black, odd, even, high, low); the
+ *            inside bets, column and dozen take a selection label as in Bet.
+ * Values:    numbers and the variables below, + - * /, min(a, b), max(a, b),
+ *            == != < <= > >=, and / or / not (0 is false).
+ * Variables: bankroll start profit stake rounds spins won lost
+ *            win_streak loss_streak number red black green odd even
+ *            (all describe the last spin; stake is the last amount bet).
+ *
+ * Rules compile to a register bytecode (8-byte instructions, one constant
+ * pool) and run on a direct-threaded interpreter where the compiler
+ * supports computed goto, a switch loop elsewhere.
+ */
+
+class StrategyProgram {
+public:
+    enum Var : uint8_t {
+        Bankroll, Start, Profit, Stake, Rounds, Spins, Won, Lost,
+        WinStreak, LossStreak, Number, IsRed, IsBlack, IsGreen, IsOdd, IsEven,
+        VAR_COUNT
+    };
+
+    // Compiles `source`; throws std::invalid_argument with the line on error.
+    explicit StrategyProgram(const std::string& source);
+
+    // Evaluates the rules against `vars` (indexed by Var).
+    Decision run(const double* vars) const;
+
+    size_t size() const { return code_.size(); }
+
+private:
+    enum Op : uint8_t {
+        LoadK, LoadV, Add, Sub, Mul, Div, Min, Max, Neg,
+        Lt, Le, Gt, Ge, Eq, Ne, And, Or, Not, Jz, Place, Skip, Stop
+    };
+
+    struct Instr {
+        Op op;
+        uint8_t a, b, c;
+        uint32_t imm;           // constant / variable / jump target / bet template
+    };
+
+    static constexpr int MAX_REGS = 16;
+
+    std::vector<Instr> code_;
+    std::vector<double> consts_;
+    std::vector<Decision> bets_;    // bet templates; amount filled in at run time
+
+    class Compiler;
+};
+
+// ---------- Compiler ----------
+class StrategyProgram::Compiler {
+public:
+    Compiler(StrategyProgram& prog, const std::string& src) : p_(prog), src_(src) {}
+
+    void compile() {
+        next();
+        while (tok_.kind != Tok::End) {
+            if (tok_.kind == Tok::Newline) { next(); continue; }
+            statement();
+            if (tok_.kind != Tok::Newline && tok_.kind != Tok::End) error("expected end of line");
+        }
+        emit(Skip);
+    }
+
+private:
+    enum class Tok { End, Newline, Number, Ident, String, Sym };
+    struct Token {
+        Tok kind = Tok::End;
+        std::string text;
+        double value = 0.0;
+    };
+
+    [[noreturn]] void error(const std::string& what) const {
+        throw std::invalid_argument("strategy line " + std::to_string(line_) + ": " + what +
+                                    (tok_.text.empty() ? "" : " near '" + tok_.text + "'"));
+    }
+
+    // ----- lexer -----
+    void next() {
+        while (pos_ < src_.size() && (src_[pos_] == ' ' || src_[pos_] == '\t' || src_[pos_] == '\r')) ++pos_;
+        if (pos_ < src_.size() && src_[pos_] == '#')
+            while (pos_ < src_.size() && src_[pos_] != '\n') ++pos_;
+
+        tok_ = Token{};
+        if (pos_ >= src_.size()) return;
+
+        const size_t start = pos_;
+        unsigned char c = src_[pos_];
+        if (c == '\n') {
+            ++pos_; ++line_;
+            tok_.kind = Tok::Newline;
+        } else if (std::isdigit(c) || c == '.') {
+            while (pos_ < src_.size() && (std::isdigit((unsigned char)src_[pos_]) || src_[pos_] == '.')) ++pos_;
+            tok_.kind = Tok::Number;
+            tok_.text = src_.substr(start, pos_ - start);
+            const char* end = tok_.text.data() + tok_.text.size();
+            const auto [p, ec] = std::from_chars(tok_.text.data(), end, tok_.value);
+            if (ec != std::errc{} || p != end) error("bad number");
+        } else if (std::isalpha(c) || c == '_') {
+            while (pos_ < src_.size() && (std::isalnum((unsigned char)src_[pos_]) || src_[pos_] == '_')) ++pos_;
+            tok_.kind = Tok::Ident;
+            tok_.text = src_.substr(start, pos_ - start);
+        } else if (c == '"') {
+            size_t end = src_.find('"', pos_ + 1);
+            if (end == std::string::npos) error("unterminated string");
+            tok_.kind = Tok::String;
+            tok_.text = src_.substr(pos_ + 1, end - pos_ - 1);
+            pos_ = end + 1;
+        } else {
+            static const char* two[] = { "==", "!=", "<=", ">=" };
+            tok_.kind = Tok::Sym;
+            for (const char* t : two)
+                if (src_.compare(pos_, 2, t) == 0) { tok_.text = t; pos_ += 2; return; }
+            if (std::string("+-*/(),:<>").find((char)c) == std::string::npos) error(std::string("unexpected '") + (char)c + "'");
+            tok_.text = std::string(1, (char)c);
+            ++pos_;
+        }
+    }
+
+    bool accept(const char* sym) {
+        if ((tok_.kind == Tok::Sym || tok_.kind == Tok::Ident) && tok_.text == sym) { next(); return true; }
+        return false;
+    }
+    void expect(const char* sym) { if (!accept(sym)) error(std::string("expected '") + sym + "'"); }
+
+    // ----- code generation -----
+    size_t emit(Op op, int a = 0, int b = 0, int c = 0, uint32_t imm = 0) {
+        p_.code_.push_back(Instr{ op, (uint8_t)a, (uint8_t)b, (uint8_t)c, imm });
+        return p_.code_.size() - 1;
+    }
+    int reg(int r) const {
+        if (r >= MAX_REGS) error("expression too deep");
+        return r;
+    }
+
+    // ----- grammar -----
+    void statement() {
+        if (accept("if")) {
+            expr(0);
+            expect(":");
+            size_t jz = emit(Jz, 0);
+            action();
+            p_.code_[jz].imm = (uint32_t)p_.code_.size();
+        } else {
+            action();
+        }
+    }
+
+    void action() {
+        if (accept("skip")) { emit(Skip); return; }
+        if (accept("stop")) { emit(Stop); return; }
+        if (!accept("bet")) error("expected bet, skip or stop");
+
+        if (tok_.kind != Tok::Ident) error("expected bet kind");
+        Bet::Type type = bet_kind(tok_.text);
+        next();
+
+        std::string selection;
+        if (needs_selection(type)) {
+            if (tok_.kind != Tok::Number && tok_.kind != Tok::String && tok_.kind != Tok::Ident)
+                error("expected selection");
+            selection = tok_.text;
+            next();
+            // allow unquoted splits like 14-17
+            if (type == Bet::Type::Split && tok_.kind == Tok::Sym && tok_.text == "-") {
+                next();
+                selection += "-" + tok_.text;
+                next();
+            }
+        }
+        Bet bet(type, selection, 0.0);
+        if (coverage_mask(bet) == 0) error("bet covers no pockets");
+
+        expr(0);
+        p_.bets_.push_back(Decision::place(bet));
+        emit(Place, 0, 0, 0, (uint32_t)p_.bets_.size() - 1);
+    }
+
+    void expr(int d) {
+        conj(d);
+        while (accept("or")) { conj(reg(d + 1)); emit(Or, d, d, d + 1); }
+    }
+    void conj(int d) {
+        negation(d);
+        while (accept("and")) { negation(reg(d + 1)); emit(And, d, d, d + 1); }
+    }
+    void negation(int d) {
+        if (accept("not")) { negation(d); emit(Not, d, d); return; }
+        comparison(d);
+    }
+    void comparison(int d) {
+        sum(d);
+        static const std::pair<const char*, Op> ops[] = {
+            {"==", Eq}, {"!=", Ne}, {"<=", Le}, {">=", Ge}, {"<", Lt}, {">", Gt} };
+        for (auto [sym, op] : ops)
+            if (accept(sym)) { sum(reg(d + 1)); emit(op, d, d, d + 1); return; }
+    }
+    void sum(int d) {
+        term(d);
+        for (;;) {
+            if (accept("+"))      { term(reg(d + 1)); emit(Add, d, d, d + 1); }
+            else if (accept("-")) { term(reg(d + 1)); emit(Sub, d, d, d + 1); }
+            else return;
+        }
+    }
+    void term(int d) {
+        unary(d);
+        for (;;) {
+            if (accept("*"))      { unary(reg(d + 1)); emit(Mul, d, d, d + 1); }
+            else if (accept("/")) { unary(reg(d + 1)); emit(Div, d, d, d + 1); }
+            else return;
+        }
+    }
+    void unary(int d) {
+        if (accept("-")) { unary(d); emit(Neg, d, d); return; }
+        primary(d);
+    }
+    void primary(int d) {
+        if (tok_.kind == Tok::Number) {
+            p_.consts_.push_back(tok_.value);
+            emit(LoadK, d, 0, 0, (uint32_t)p_.consts_.size() - 1);
+            next();
+            return;
+        }
+        if (accept("(")) { expr(d); expect(")"); return; }
+        if (tok_.kind != Tok::Ident) error("expected value");
+
+        std::string name = tok_.text;
+        if (name == "min" || name == "max") {
+            next();
+            expect("(");
+            expr(d);
+            expect(",");
+            expr(reg(d + 1));
+            expect(")");
+            emit(name == "min" ? Min : Max, d, d, d + 1);
+            return;
+        }
+        emit(LoadV, d, 0, 0, variable(name));
+        next();
+    }
+
+    uint32_t variable(const std::string& name) const {
+        static const std::pair<const char*, Var> vars[] = {
+            {"bankroll", Bankroll}, {"start", Start}, {"profit", Profit}, {"stake", Stake},
+            {"rounds", Rounds}, {"spins", Spins}, {"won", Won}, {"lost", Lost},
+            {"win_streak", WinStreak}, {"loss_streak", LossStreak}, {"number", Number},
+            {"red", IsRed}, {"black", IsBlack}, {"green", IsGreen}, {"odd", IsOdd}, {"even", IsEven} };
+        for (auto [n, v] : vars) if (name == n) return v;
+        error("unknown variable '" + name + "'");
+    }
+
+    Bet::Type bet_kind(const std::string& name) const {
+        Bet::Type t;
+        if (!parse_bet_type(name, t)) error("unknown bet kind");
+        return t;
+    }
+
+    static bool needs_selection(Bet::Type t) {
+        return pockets_covered(t) < 18;
+    }
+
+    StrategyProgram& p_;
+    const std::string& src_;
+    size_t pos_ = 0;
+    int line_ = 1;
+    Token tok_;
+};
+
+inline StrategyProgram::StrategyProgram(const std::string& source) {
+    Compiler(*this, source).compile();
+}
+
+// ---------- Interpreter ----------
+#if defined(__GNUC__) || defined(__clang__)
+#define ROULETTE_THREADED_DISPATCH 1
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"     // labels as values
+#else
+#define ROULETTE_THREADED_DISPATCH 0
+#endif
+
+inline Decision StrategyProgram::run(const double* vars) const {
+    double r[MAX_REGS];
+    const Instr* const code = code_.data();
+    const double* const k = consts_.data();
+    const Instr* ip = code;
+
+#if ROULETTE_THREADED_DISPATCH
+    static const void* const dispatch[] = {
+        &&LoadK, &&LoadV, &&Add, &&Sub, &&Mul, &&Div, &&Min, &&Max, &&Neg,
+        &&Lt, &&Le, &&Gt, &&Ge, &&Eq, &&Ne, &&And, &&Or, &&Not, &&Jz, &&Place, &&Skip, &&Stop
+    };
+#define OP(name) name:
+#define NEXT()   goto *dispatch[ip->op]
+    NEXT();
+#else
+#define OP(name) case name:
+#define NEXT()   continue
+    for (;;) switch (ip->op) {
+#endif
+
+    OP(LoadK) r[ip->a] = k[ip->imm];                       ++ip; NEXT();
+    OP(LoadV) r[ip->a] = vars[ip->imm];                    ++ip; NEXT();
+    OP(Add)   r[ip->a] = r[ip->b] + r[ip->c];              ++ip; NEXT();
+    OP(Sub)   r[ip->a] = r[ip->b] - r[ip->c];              ++ip; NEXT();
+    OP(Mul)   r[ip->a] = r[ip->b] * r[ip->c];              ++ip; NEXT();
+    OP(Div)   r[ip->a] = r[ip->c] != 0.0 ? r[ip->b] / r[ip->c] : 0.0; ++ip; NEXT();
+    OP(Min)   r[ip->a] = r[ip->b] < r[ip->c] ? r[ip->b] : r[ip->c]; ++ip; NEXT();
+    OP(Max)   r[ip->a] = r[ip->b] > r[ip->c] ? r[ip->b] : r[ip->c]; ++ip; NEXT();
+    OP(Neg)   r[ip->a] = -r[ip->b];                        ++ip; NEXT();
+    OP(Lt)    r[ip->a] = r[ip->b] <  r[ip->c];             ++ip; NEXT();
+    OP(Le)    r[ip->a] = r[ip->b] <= r[ip->c];             ++ip; NEXT();
+    OP(Gt)    r[ip->a] = r[ip->b] >  r[ip->c];             ++ip; NEXT();
+    OP(Ge)    r[ip->a] = r[ip->b] >= r[ip->c];             ++ip; NEXT();
+    OP(Eq)    r[ip->a] = r[ip->b] == r[ip->c];             ++ip; NEXT();
+    OP(Ne)    r[ip->a] = r[ip->b] != r[ip->c];             ++ip; NEXT();
+    OP(And)   r[ip->a] = (r[ip->b] != 0.0) & (r[ip->c] != 0.0); ++ip; NEXT();
+    OP(Or)    r[ip->a] = (r[ip->b] != 0.0) | (r[ip->c] != 0.0); ++ip; NEXT();
+    OP(Not)   r[ip->a] = r[ip->b] == 0.0;                  ++ip; NEXT();
+    OP(Jz)    ip = (r[ip->a] == 0.0) ? code + ip->imm : ip + 1; NEXT();
+    OP(Place) {
+        Decision d = bets_[ip->imm];
+        d.amount = r[ip->a];
+        return d;
+    }
+    OP(Skip)  return Decision::skip();
+    OP(Stop)  return Decision::stop();
+
+#if !ROULETTE_THREADED_DISPATCH
+    }
+#endif
+#undef OP
+#undef NEXT
+}
+
+#if ROULETTE_THREADED_DISPATCH
+#pragma GCC diagnostic pop
+#endif
+#undef ROULETTE_THREADED_DISPATCH
+
+// ---------- Runner ----------
+// Keeps the variables a program sees; plugs into run_session().
+class ScriptedStrategy {
+public:
+    explicit ScriptedStrategy(const StrategyProgram& program) : program_(&program) {}
+
+    void reset(double start) {
+        vars_.fill(0.0);
+        vars_[StrategyProgram::Start] = start;
+        vars_[StrategyProgram::Bankroll] = start;
+        vars_[StrategyProgram::Number] = -1.0;
+        started_ = true;
+    }
+
+    Decision decide(double bankroll) {
+        if (!started_) reset(bankroll);
+        vars_[StrategyProgram::Bankroll] = bankroll;
+        vars_[StrategyProgram::Profit] = bankroll - vars_[StrategyProgram::Start];
+        return program_->run(vars_.data());
+    }
+
+    void observe(int index, const Decision& d, bool won) {
+        using P = StrategyProgram;
+        const Pocket& p = TRIPLE_ZERO_TABLE[index];     // indices agree on every wheel; this one has them all
+        vars_[P::Spins] += 1.0;
+        vars_[P::Number]  = p.value;
+        vars_[P::IsRed]   = is_red(p);
+        vars_[P::IsBlack] = is_black(p);
+        vars_[P::IsGreen] = is_green(p);
+        vars_[P::IsOdd]   = !is_green(p) && is_odd(p);
+        vars_[P::IsEven]  = !is_green(p) && is_even(p);
+
+        const bool placed = d.kind == Decision::Kind::Bet;
+        vars_[P::Won]  = placed && won;
+        vars_[P::Lost] = placed && !won;
+        if (!placed) return;
+
+        vars_[P::Rounds] += 1.0;
+        vars_[P::Stake] = d.amount;
+        vars_[P::WinStreak]  = won ? vars_[P::WinStreak] + 1.0 : 0.0;
+        vars_[P::LossStreak] = won ? 0.0 : vars_[P::LossStreak] + 1.0;
+    }
+
+private:
+    const StrategyProgram* program_;
+    std::array<double, StrategyProgram::VAR_COUNT> vars_{};
+    bool started_ = false;
+};
@@ -0,0 +1,423 @@
+// table.hpp
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bet.hpp"
+#include "bet_book.hpp"
+#include "exposure.hpp"
+#include "ledger.hpp"
+#include "player.hpp"
+#include "provably_fair.hpp"
+#include "roulette.hpp"
+#include "spin_ahead.hpp"
+#include "trace.hpp"
+
+/**
+ * One roulette table as a round state machine:
+ *
+ *   BettingOpen -> NoMoreBets -> Spin -> Settle -> Payout -> BettingOpen ...
+ *
+ * A table is owned by exactly one thread; nothing here locks. advance() is
+ * called when the current phase's deadline passes and returns the next
+ * deadline. Settle and Payout run back to back inside one advance() call,
+ * so a round settles as soon as the result is known.
+ *
+ * The table also keeps the house's per-pocket exposure for the open round
+ * and, when an exposure cap is set, refuses bets that would push the
+ * worst-case net liability past it.
+ *
+ * Open bets sit in a BetBook rather than on the Player: a placed bet gets a
+ * handle the player can cancel or resize with until no-more-bets, and
+ * settlement walks the book once. Players only hold balances here.
+ *
+ * With a ledger attached, every balance change and bet event is appended
+ * to it as it happens; last_lsn() is what a caller must see durable before
+ * acknowledging the operation it just made.
+ *
+ * capture() copies the table's state into a TableImage between two events
+ * on the owner thread, and restore() rebuilds a table from one (see
+ * snapshot.hpp), handles and wheel sequence included.
+ *
+ * set_fair() switches the table to a provably fair wheel (provably_fair.hpp):
+ * spins come from the committed server seed instead of the table's engine.
+ * The fair wheel's seeds are not part of a TableImage.
+ *
+ * set_spin_ahead() has the ordinary wheel's spins drawn ahead on a
+ * background thread (spin_ahead.hpp); the sequence, snapshots and restores
+ * are the same as without it. set_spin_source() takes spins from any
+ * other source instead, e.g. a SecureWheel (ChaCha20) drawn inline or
+ * ahead; wheel() still names the pockets.
+ */
+
+// A table's recoverable state: seats, open bets, round and wheel.
+struct TableImage {
+    struct SeatImage {
+        std::string name;
+        double balance = 0.0;
+        bool occupied = false;
+    };
+    struct BetImage {
+        uint64_t handle;
+        uint32_t seat;
+        Bet::Type type;
+        std::string selection;
+        double amount;
+    };
+
+    uint32_t id = 0;
+    uint64_t round = 1;             // round the open bets belong to
+    uint64_t lsn = 0;               // last ledger record reflected here
+    std::string rng;                // Wheel::rng_state(); empty = keep the table's own seed
+    uint64_t spins_after = 0;       // draws made since `rng` was taken
+    int pending_index = -1;         // drawn but not yet settled
+    std::vector<SeatImage> seats;
+    std::vector<BetImage> bets;
+};
+
+class Table {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Phase : uint8_t { BettingOpen, NoMoreBets, Spin, Settle, Payout };
+
+    struct Timing {
+        std::chrono::milliseconds betting{15000};
+        std::chrono::milliseconds no_more_bets{1000};
+        std::chrono::milliseconds spin{4000};       // ball in motion, result already drawn
+        std::chrono::milliseconds payout{2000};     // results on display before the next round
+    };
+
+    enum class BetResult : uint8_t { Accepted, Closed, NoSeat, Invalid, Insufficient, ExposureLimit, NoSuchBet };
+
+    // Receives everything a table does; called on the table's thread.
+    struct Listener {
+        virtual ~Listener() = default;
+        virtual void on_phase(const Table&) {}
+        virtual void on_result(const Table&, int /*index*/) {}
+        virtual void on_settle(const Table&, uint32_t /*seat*/, double /*staked*/, double /*paid*/) {}
+        virtual void on_round_end(const Table&) {}
+    };
+
+    Table(uint32_t id, Wheel::Type type, const Timing& timing, uint64_t seed)
+    : id_(id), wheel_(type, seed), timing_(timing), exposure_(type) {}
+
+    uint32_t id() const { return id_; }
+    Phase phase() const { return phase_; }
+    uint64_t round() const { return round_; }
+    int last_index() const { return last_index_; }
+    const Wheel& wheel() const { return wheel_; }
+    std::chrono::nanoseconds last_settle_time() const { return settle_time_; }
+    const Exposure& exposure() const { return exposure_; }
+    const BetBook& book() const { return book_; }
+
+    void set_ledger(Ledger* ledger) { ledger_ = ledger; }
+    uint64_t last_lsn() const { return last_lsn_; }
+
+    // nullptr goes back to the ordinary wheel.
+    void set_fair(std::unique_ptr<FairWheel> fair) { fair_ = std::move(fair); }
+    FairWheel* fair() { return fair_.get(); }
+    const FairWheel* fair() const { return fair_.get(); }
+
+    // Spins buffered ahead of the table; 0 draws each one when it is needed.
+    void set_spin_ahead(uint32_t capacity) {
+        source_ = capacity ? std::make_unique<SpinAhead>(wheel_, capacity) : nullptr;
+    }
+    // Spins from elsewhere (same pocket count); nullptr goes back to wheel().
+    void set_spin_source(std::unique_ptr<SpinSource> source) { source_ = std::move(source); }
+
+    // Largest net loss the house accepts on one round; 0 = unlimited.
+    void set_exposure_cap(double cap) { exposure_cap_ = cap; }
+    double exposure_cap() const { return exposure_cap_; }
+
+    // ---------- seats ----------
+    uint32_t sit(std::string name, double balance) {
+        uint32_t s;
+        if (!free_.empty()) {
+            s = free_.back();
+            free_.pop_back();
+            seats_[s] = Seat{ Player(std::move(name), balance), true };
+        } else {
+            s = (uint32_t)seats_.size();
+            seats_.push_back(Seat{ Player(std::move(name), balance), true });
+        }
+        journal(LedgerRecord::Kind::Sit, s, 0, balance, seats_[s].player.name());
+        return s;
+    }
+
+    // Open bets of a leaving player are forfeited, as at a real table.
+    void leave(uint32_t seat) {
+        if (!seated(seat)) return;
+        if (seats_[seat].open > 0) {
+            for (const BookEntry& e : book_.entries()) if (e.seat == seat) exposure_.remove(e.bet);
+            book_.remove_seat(seat);
+        }
+        seats_[seat].occupied = false;
+        seats_[seat].open = 0;
+        free_.push_back(seat);
+        journal(LedgerRecord::Kind::Leave, seat, 0, 0.0);
+    }
+
+    bool seated(uint32_t seat) const { return seat < seats_.size() && seats_[seat].occupied; }
+    const Player& player(uint32_t seat) const { return seats_.at(seat).player; }
+    size_t players() const { return seats_.size() - free_.size(); }
+
+    // ---------- betting ----------
+    // On success `*handle` (if given) names the bet for cancel/modify.
+    BetResult place_bet(uint32_t seat, const Bet& bet, BetHandle* handle = nullptr) {
+        if (phase_ != Phase::BettingOpen) return BetResult::Closed;
+        if (!seated(seat)) return BetResult::NoSeat;
+        if (!(bet.amount > 0.0) || bet.selection_label.size() > MAX_SELECTION ||
+            table_coverage_mask(bet, wheel_.type()) == 0)
+            return BetResult::Invalid;
+        Player& p = seats_[seat].player;
+        if (bet.amount > p.balance()) return BetResult::Insufficient;
+        if (exposure_cap_ > 0.0 && exposure_.max_net_with(bet) > exposure_cap_) return BetResult::ExposureLimit;
+        p.debit(bet.amount);
+        exposure_.add(bet);
+        const BetHandle h = book_.add(seat, bet);
+        ++seats_[seat].open;
+        journal(LedgerRecord::Kind::Place, seat, h.value(), bet.amount, bet.selection_label, (uint8_t)bet.type);
+        if (handle) *handle = h;
+        return BetResult::Accepted;
+    }
+
+    // Takes a bet back and refunds the stake.
+    BetResult cancel_bet(uint32_t seat, BetHandle h) {
+        if (phase_ != Phase::BettingOpen) return BetResult::Closed;
+        if (!seated(seat)) return BetResult::NoSeat;
+        const BookEntry* e = book_.find(h);
+        if (!e || e->seat != seat) return BetResult::NoSuchBet;
+        const double refund = e->bet.amount;
+        seats_[seat].player.credit(refund);
+        exposure_.remove(e->bet);
+        book_.remove(h);
+        --seats_[seat].open;
+        journal(LedgerRecord::Kind::Cancel, seat, h.value(), refund);
+        return BetResult::Accepted;
+    }
+
+    // Changes a bet's stake, charging or refunding the difference.
+    BetResult modify_bet(uint32_t seat, BetHandle h, double amount) {
+        if (phase_ != Phase::BettingOpen) return BetResult::Closed;
+        if (!seated(seat)) return BetResult::NoSeat;
+        const BookEntry* e = book_.find(h);
+        if (!e || e->seat != seat) return BetResult::NoSuchBet;
+        if (!(amount > 0.0)) return BetResult::Invalid;
+        Player& p = seats_[seat].player;
+        const double delta = amount - e->bet.amount;
+        if (delta > p.balance()) return BetResult::Insufficient;
+
+        Bet resized = e->bet;
+        resized.amount = amount;
+        exposure_.remove(e->bet);
+        if (exposure_cap_ > 0.0 && delta > 0.0 && exposure_.max_net_with(resized) > exposure_cap_) {
+            exposure_.add(e->bet);
+            return BetResult::ExposureLimit;
+        }
+        exposure_.add(resized);
+        if (delta > 0.0) p.debit(delta);
+        else p.credit(-delta);
+        book_.resize(h, amount);
+        journal(LedgerRecord::Kind::Modify, seat, h.value(), amount);
+        return BetResult::Accepted;
+    }
+
+    // ---------- state machine ----------
+    // Starts the first round; returns its deadline.
+    // A restored table caught between spin and settle settles first.
+    Clock::time_point open(Clock::time_point now, Listener& l) {
+        if (phase_ == Phase::Spin) return advance(now, l);
+        return enter(Phase::BettingOpen, now, l);
+    }
+
+    // Moves past the current phase; returns when the next one ends.
+    Clock::time_point advance(Clock::time_point now, Listener& l) {
+        switch (phase_) {
+            case Phase::BettingOpen: return enter(Phase::NoMoreBets, now, l);
+            case Phase::NoMoreBets:  return enter(Phase::Spin, now, l);
+            case Phase::Spin:        return enter(Phase::Settle, now, l);
+            case Phase::Settle:      return enter(Phase::Payout, now, l);
+            case Phase::Payout:      ++round_; return enter(Phase::BettingOpen, now, l);
+        }
+        return now;
+    }
+
+    // ---------- snapshots ----------
+    TableImage capture() const {
+        TableImage img;
+        img.id = id_;
+        img.round = phase_ == Phase::Payout ? round_ + 1 : round_;
+        img.lsn = last_lsn_;
+        if (source_) {
+            img.rng = source_->state();
+            img.spins_after = source_->offset();
+        } else {
+            img.rng = wheel_.rng_state();
+        }
+        img.pending_index = phase_ == Phase::Spin ? last_index_ : -1;
+        img.seats.reserve(seats_.size());
+        for (const Seat& s : seats_)
+            img.seats.push_back(TableImage::SeatImage{ s.player.name(), s.player.balance(), s.occupied });
+        img.bets.reserve(book_.size());
+        for (const BookEntry& e : book_.entries())
+            img.bets.push_back(TableImage::BetImage{ book_.handle_of(e).value(), e.seat, e.bet.type,
+                                                     e.bet.selection_label, e.bet.amount });
+        return img;
+    }
+
+    // Before open(); replaces everything but id, timing and ledger. Throws
+    // std::invalid_argument, leaving the table as it was, if a bet names a
+    // seat the image doesn't have.
+    void restore(const TableImage& img) {
+        for (const TableImage::BetImage& b : img.bets)
+            if (b.seat >= img.seats.size())
+                throw std::invalid_argument("table " + std::to_string(id_) + " image: bet on seat " +
+                                            std::to_string(b.seat) + " of " + std::to_string(img.seats.size()));
+        round_ = img.round;
+        last_lsn_ = img.lsn;
+        if (!img.rng.empty() && source_) {
+            try {
+                source_->restore(img.rng, img.spins_after);
+            } catch (const std::invalid_argument&) {
+                // taken with another engine: the source keeps its own seed
+            }
+        } else if (!img.rng.empty()) {
+            wheel_.set_rng_state(img.rng);
+            for (uint64_t i = 0; i < img.spins_after; ++i) wheel_.spin_index();
+        }
+
+        seats_.clear();
+        free_.clear();
+        book_ = BetBook{};
+        exposure_.clear();
+        for (const TableImage::SeatImage& s : img.seats)
+            seats_.push_back(Seat{ Player(s.name, s.balance), s.occupied });
+        for (uint32_t s = (uint32_t)seats_.size(); s-- > 0;)
+            if (!seats_[s].occupied) free_.push_back(s);
+        for (const TableImage::BetImage& b : img.bets) {
+            Bet bet(b.type, b.selection, b.amount);
+            book_.restore(BetHandle::from(b.handle), b.seat, bet);
+            exposure_.add(bet);
+            ++seats_[b.seat].open;
+        }
+        book_.rebuild_free_list();
+
+        last_index_ = img.pending_index;
+        phase_ = img.pending_index >= 0 ? Phase::Spin : Phase::BettingOpen;
+    }
+
+private:
+    struct Seat {
+        Player player;
+        bool occupied;
+        uint32_t open = 0;          // bets in the book
+        double staked = 0.0;        // settle() scratch
+        double paid = 0.0;
+    };
+
+    Clock::time_point enter(Phase next, Clock::time_point now, Listener& l) {
+        phase_ = next;
+        l.on_phase(*this);
+        switch (next) {
+            case Phase::BettingOpen: return now + timing_.betting;
+            case Phase::NoMoreBets:  return now + timing_.no_more_bets;
+            case Phase::Spin: {
+                TraceSpan span("spin");
+                last_index_ = fair_ ? fair_->spin_index() : source_ ? source_->pop() : wheel_.spin_index();
+                journal(LedgerRecord::Kind::Spin, 0, round_, last_index_);
+                l.on_result(*this, last_index_);
+                return now + timing_.spin;
+            }
+            case Phase::Settle:
+                settle(l);
+                return enter(Phase::Payout, now, l);
+            case Phase::Payout:
+                l.on_round_end(*this);
+                return now + timing_.payout;
+        }
+        return now;
+    }
+
+    void journal(LedgerRecord::Kind kind, uint32_t seat, uint64_t ref, double amount,
+                 const std::string& text = {}, uint8_t bet_type = 0) {
+        if (!ledger_) return;
+        LedgerRecord r;
+        r.kind = kind;
+        r.table = id_;
+        r.seat = seat;
+        r.ref = ref;
+        r.amount = amount;
+        r.balance = seat < seats_.size() ? seats_[seat].player.balance() : 0.0;
+        r.bet_type = bet_type;
+        set_record_text(r, text);
+        last_lsn_ = ledger_->append(r);
+    }
+
+    // Pays every open bet against last_index_ and clears the layout.
+    void settle(Listener& l) {
+        TraceSpan span("settle");
+        const auto t0 = Clock::now();
+        for (const BookEntry& e : book_.entries()) {
+            Seat& seat = seats_[e.seat];
+            seat.staked += e.bet.amount;
+            if ((e.mask >> last_index_) & 1) seat.paid += e.payout;
+        }
+        for (uint32_t s = 0; s < seats_.size(); ++s) {
+            Seat& seat = seats_[s];
+            if (!seat.occupied || seat.open == 0) continue;
+            if (seat.paid > 0.0) seat.player.credit(seat.paid);
+            journal(LedgerRecord::Kind::Settle, s, round_, seat.paid);
+            l.on_settle(*this, s, seat.staked, seat.paid);
+            seat.open = 0;
+            seat.staked = seat.paid = 0.0;
+        }
+        book_.clear();
+        exposure_.clear();
+        settle_time_ = Clock::now() - t0;
+    }
+
+    uint32_t id_;
+    Wheel wheel_;
+    std::unique_ptr<FairWheel> fair_;
+    std::unique_ptr<SpinSource> source_;    // spins instead of wheel_, when set
+    Timing timing_;
+    Phase phase_ = Phase::BettingOpen;
+    uint64_t round_ = 1;
+    int last_index_ = -1;
+    std::chrono::nanoseconds settle_time_{0};
+    std::vector<Seat> seats_;
+    std::vector<uint32_t> free_;
+    BetBook book_;
+    Exposure exposure_;
+    double exposure_cap_ = 0.0;
+    Ledger* ledger_ = nullptr;
+    uint64_t last_lsn_ = 0;
+};
+
+inline const char* phase_name(Table::Phase p) {
+    switch (p) {
+        case Table::Phase::BettingOpen: return "BETTING_OPEN";
+        case Table::Phase::NoMoreBets:  return "NO_MORE_BETS";
+        case Table::Phase::Spin:        return "SPIN";
+        case Table::Phase::Settle:      return "SETTLE";
+        case Table::Phase::Payout:      return "PAYOUT";
+    }
+    return "UNKNOWN";
+}
+
+inline const char* bet_result_name(Table::BetResult r) {
+    switch (r) {
+        case Table::BetResult::Accepted:      return "OK";
+        case Table::BetResult::Closed:        return "BETTING_CLOSED";
+        case Table::BetResult::NoSeat:        return "NOT_SEATED";
+        case Table::BetResult::Invalid:       return "INVALID_BET";
+        case Table::BetResult::Insufficient:  return "INSUFFICIENT_FUNDS";
+        case Table::BetResult::ExposureLimit: return "EXPOSURE_LIMIT";
+        case Table::BetResult::NoSuchBet:     return "NO_SUCH_BET";
+    }
+    return "UNKNOWN";
+}
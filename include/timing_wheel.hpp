@@ -0,0 +1,223 @@
+// timing_wheel.hpp
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * Hierarchical timing wheel: the event queue of a discrete-event simulation.
+ *
+ * Time is an integer tick count (the caller picks the unit). Level L has
+ * 256 slots of 256^L ticks each; an event goes on the lowest level whose
+ * slot still lies in the current span of the level above, so scheduling is
+ * an XOR, a count-leading-zeros and a list append: O(1) however many
+ * events are pending. Advancing finds the next occupied slot through
+ * per-level bitmaps, and when time enters a higher-level slot its events
+ * cascade down a level, each event moving at most LEVELS - 1 times.
+ * Events that fall in the next span of the top level (still within
+ * horizon() ticks, but past the wheel's end) wait on an overflow list that
+ * is linked in when time crosses into that span.
+ *
+ * Events are fired in time order, and in scheduling order within a tick.
+ * Payloads live in one pooled vector linked by index, so a steady-state
+ * simulation allocates nothing. There is no cancel: give payloads a
+ * generation number and ignore stale ones when they fire.
+ */
+
+template <class T, int LEVELS = 5>
+class TimingWheel {
+public:
+    static constexpr int BITS = 8;
+    static constexpr uint32_t SLOTS = 1u << BITS;
+    static_assert(LEVELS >= 1 && LEVELS * BITS <= 64, "levels must fit a 64-bit tick");
+
+    explicit TimingWheel(uint64_t start = 0) : now_(start) {
+        for (auto& level : head_) level.fill(NIL);
+        for (auto& level : tail_) level.fill(NIL);
+    }
+
+    uint64_t now() const { return now_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Ticks from now() that an event can be scheduled ahead.
+    static constexpr uint64_t horizon() {
+        return LEVELS * BITS >= 64 ? UINT64_MAX : (uint64_t{1} << (LEVELS * BITS)) - 1;
+    }
+
+    // Events in the past fire at now(). Throws std::out_of_range past the horizon.
+    void schedule(uint64_t when, const T& value) {
+        when = std::max(when, now_);
+        if (when - now_ > horizon()) throw std::out_of_range("event beyond the timing wheel's horizon");
+        uint32_t i;
+        if (free_ != NIL) {
+            i = free_;
+            free_ = nodes_[i].next;
+            nodes_[i] = Node{ when, NIL, value };
+        } else {
+            i = (uint32_t)nodes_.size();
+            nodes_.push_back(Node{ when, NIL, value });
+        }
+        link(i);
+        ++size_;
+    }
+
+    // Fires fire(when, value) for every event due at or before `until`, in
+    // order; handlers may schedule more, including for the current tick.
+    // Leaves now() at `until`. Returns how many fired.
+    template <class F>
+    size_t run_until(uint64_t until, F&& fire) {
+        size_t fired = 0;
+        for (;;) {
+            const int s = next_slot(0, (uint32_t)(now_ & (SLOTS - 1)));
+            if (s >= 0) {
+                const uint64_t t = (now_ & ~uint64_t{SLOTS - 1}) | (uint32_t)s;
+                if (t > until) break;
+                now_ = t;
+                while (head_[0][s] != NIL) {
+                    const uint32_t i = pop(0, (uint32_t)s);
+                    const T value = nodes_[i].value;        // the pool may grow under fire()
+                    nodes_[i].next = free_;
+                    free_ = i;
+                    --size_;
+                    fire(t, value);
+                    ++fired;
+                }
+                continue;
+            }
+            if (!cascade(until)) break;
+        }
+        now_ = std::max(now_, until);
+        return fired;
+    }
+
+    // Runs until no event is left.
+    template <class F>
+    size_t run(F&& fire) {
+        size_t fired = 0;
+        while (!empty()) fired += run_until(next_due(), fire);
+        return fired;
+    }
+
+    // Earliest pending event's tick, or UINT64_MAX when empty. Scans at most
+    // one slot list.
+    uint64_t next_due() const {
+        if (empty()) return UINT64_MAX;
+        const int s0 = next_slot(0, (uint32_t)(now_ & (SLOTS - 1)));
+        if (s0 >= 0) return (now_ & ~uint64_t{SLOTS - 1}) | (uint32_t)s0;
+        for (int l = 1; l < LEVELS; ++l) {
+            const int s = next_slot(l, digit(now_, l) + 1);
+            if (s < 0) continue;
+            uint64_t t = UINT64_MAX;
+            for (uint32_t i = head_[l][s]; i != NIL; i = nodes_[i].next) t = std::min(t, nodes_[i].when);
+            return t;
+        }
+        uint64_t t = UINT64_MAX;
+        for (uint32_t i = over_head_; i != NIL; i = nodes_[i].next) t = std::min(t, nodes_[i].when);
+        return t;
+    }
+
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    struct Node {
+        uint64_t when;
+        uint32_t next;
+        T value;
+    };
+
+    static uint32_t digit(uint64_t t, int level) { return (uint32_t)(t >> (level * BITS)) & (SLOTS - 1); }
+
+    void link(uint32_t i) {
+        const uint64_t when = nodes_[i].when;
+        const uint64_t diff = when ^ now_;
+        const int level = diff < SLOTS ? 0 : (63 - __builtin_clzll(diff)) / BITS;
+        nodes_[i].next = NIL;
+        if (level >= LEVELS) {          // next top-level span (schedule() checked the horizon)
+            if (over_tail_ == NIL) over_head_ = i;
+            else nodes_[over_tail_].next = i;
+            over_tail_ = i;
+            return;
+        }
+        const uint32_t s = digit(when, level);
+        if (tail_[level][s] == NIL) {
+            head_[level][s] = i;
+            bits_[level][s >> 6] |= uint64_t{1} << (s & 63);
+        } else {
+            nodes_[tail_[level][s]].next = i;
+        }
+        tail_[level][s] = i;
+    }
+
+    uint32_t pop(int level, uint32_t s) {
+        const uint32_t i = head_[level][s];
+        head_[level][s] = nodes_[i].next;
+        if (head_[level][s] == NIL) {
+            tail_[level][s] = NIL;
+            bits_[level][s >> 6] &= ~(uint64_t{1} << (s & 63));
+        }
+        return i;
+    }
+
+    // First occupied slot >= from on `level`, or -1.
+    int next_slot(int level, uint32_t from) const {
+        for (uint32_t w = from >> 6; w < SLOTS / 64; ++w) {
+            uint64_t m = bits_[level][w];
+            if (w == from >> 6) m &= ~uint64_t{0} << (from & 63);
+            if (m) return (int)(w * 64 + (uint32_t)__builtin_ctzll(m));
+        }
+        return -1;
+    }
+
+    // Moves time to the start of the next occupied higher-level slot and
+    // redistributes its events; false if there is none at or before `until`.
+    bool cascade(uint64_t until) {
+        for (int l = 1; l < LEVELS; ++l) {
+            const int s = next_slot(l, digit(now_, l) + 1);
+            if (s < 0) continue;
+            const int shift = (l + 1) * BITS;
+            const uint64_t high = shift >= 64 ? 0 : (now_ >> shift) << shift;
+            const uint64_t start = high | ((uint64_t)(uint32_t)s << (l * BITS));
+            if (start > until) return false;
+            now_ = start;
+            uint32_t i = head_[l][s];
+            head_[l][s] = tail_[l][s] = NIL;
+            bits_[l][(uint32_t)s >> 6] &= ~(uint64_t{1} << (s & 63));
+            while (i != NIL) {
+                const uint32_t next = nodes_[i].next;
+                link(i);
+                i = next;
+            }
+            return true;
+        }
+        // the top span is used up: move into the next one and link its events
+        if constexpr (LEVELS * BITS < 64) {
+            if (over_head_ == NIL) return false;
+            const uint64_t start = ((now_ >> (LEVELS * BITS)) + 1) << (LEVELS * BITS);
+            if (start > until) return false;
+            now_ = start;
+            uint32_t i = over_head_;
+            over_head_ = over_tail_ = NIL;
+            while (i != NIL) {
+                const uint32_t next = nodes_[i].next;
+                link(i);
+                i = next;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    uint64_t now_;
+    size_t size_ = 0;
+    std::vector<Node> nodes_;
+    uint32_t free_ = NIL;
+    uint32_t over_head_ = NIL;          // events for the next top-level span, in scheduling order
+    uint32_t over_tail_ = NIL;
+    std::array<std::array<uint32_t, SLOTS>, LEVELS> head_;
+    std::array<std::array<uint32_t, SLOTS>, LEVELS> tail_;
+    std::array<std::array<uint64_t, SLOTS / 64>, LEVELS> bits_{};
+};
@@ -0,0 +1,185 @@
+// trace.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Scoped trace spans for finding out where a slow round went.
+ *
+ *   { TraceSpan span("settle"); ... }
+ *
+ * While tracing is off a span is one relaxed load and a not-taken branch
+ * at each end. While it is on, each span reads the cycle counter twice
+ * (TSC on x86, the virtual counter on ARM) and writes one 24-byte event to
+ * its thread's ring: no locks, no allocation, nothing shared with other
+ * threads. Rings keep the last RING_EVENTS spans per thread and overwrite
+ * older ones.
+ *
+ * Trace::dump() writes every thread's ring as Chrome trace-event JSON, which
+ * chrome://tracing and ui.perfetto.dev open directly. Counter ticks are
+ * turned into microseconds with a rate measured between enable() and the
+ * dump. Span names must be string literals (or otherwise outlive the
+ * process's last dump); only the pointer is stored.
+ */
+
+class Trace {
+public:
+    static constexpr size_t RING_EVENTS = 1 << 16;     // per thread, a power of two
+
+    static bool enabled() { return on_.load(std::memory_order_relaxed); }
+
+    static void enable(bool on) {
+        if (on && !enabled()) {
+            std::lock_guard<std::mutex> lk(mu_);
+            base_ticks_ = ticks();
+            base_time_ = std::chrono::steady_clock::now();
+        }
+        on_.store(on, std::memory_order_relaxed);
+    }
+
+    // Cheap monotonic counter; units are only meaningful within one dump.
+    static uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        uint64_t t;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(t));
+        return t;
+#else
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    // Labels the calling thread in the dump ("shard 0", "ledger", ...).
+    static void name_thread(std::string name) {
+        Ring& r = ring();
+        std::lock_guard<std::mutex> lk(mu_);
+        r.name = std::move(name);
+    }
+
+    // Records a finished span on the calling thread's ring.
+    static void emit(const char* name, uint64_t start, uint64_t end) {
+        Ring& r = ring();
+        const uint64_t n = r.head.load(std::memory_order_relaxed);
+        Event& e = r.events[n & (RING_EVENTS - 1)];
+        e.name.store(name, std::memory_order_relaxed);
+        e.start.store(start, std::memory_order_relaxed);
+        e.end.store(end, std::memory_order_relaxed);
+        r.head.store(n + 1, std::memory_order_release);
+    }
+
+    // Writes every span still in the rings, oldest first per thread. Safe
+    // while threads keep tracing: events overwritten during the copy are
+    // left out. false if the file can't be written.
+    static bool dump(const std::string& path) {
+        std::lock_guard<std::mutex> lk(mu_);
+        const uint64_t t1 = ticks();
+        const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - base_time_).count();
+        const double ticks_per_us = secs > 0.001 && t1 > base_ticks_ ? (double)(t1 - base_ticks_) / (secs * 1e6) : 1e3;
+
+        std::FILE* f = std::fopen(path.c_str(), "w");
+        if (!f) return false;
+        const long pid = (long)::getpid();
+        std::fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+        bool first = true;
+        struct Copy { const char* name; uint64_t start, end; };
+        std::vector<Copy> copy;
+        for (size_t t = 0; t < rings_.size(); ++t) {
+            const Ring& r = *rings_[t];
+            if (!r.name.empty()) {
+                std::fprintf(f, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%ld,\"tid\":%zu,\"args\":{\"name\":\"%s\"}}",
+                             first ? "" : ",\n", pid, t, r.name.c_str());
+                first = false;
+            }
+            const uint64_t head = r.head.load(std::memory_order_acquire);
+            const uint64_t from = head > RING_EVENTS ? head - RING_EVENTS : 0;
+            copy.clear();
+            for (uint64_t i = from; i < head; ++i) {
+                const Event& e = r.events[i & (RING_EVENTS - 1)];
+                copy.push_back(Copy{ e.name.load(std::memory_order_relaxed), e.start.load(std::memory_order_relaxed),
+                                     e.end.load(std::memory_order_relaxed) });
+            }
+            // whatever the writer lapped while we copied may be torn
+            const uint64_t now = r.head.load(std::memory_order_acquire);
+            const uint64_t valid = now > RING_EVENTS ? now - RING_EVENTS + 1 : 0;
+            for (uint64_t i = std::max(from, valid); i < head; ++i) {
+                const Copy& c = copy[i - from];
+                if (c.start < base_ticks_ || c.end < c.start) continue;     // from before the last enable()
+                std::fprintf(f, "%s{\"ph\":\"X\",\"name\":\"%s\",\"pid\":%ld,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f}",
+                             first ? "" : ",\n", c.name, pid, t, (double)(c.start - base_ticks_) / ticks_per_us,
+                             (double)(c.end - c.start) / ticks_per_us);
+                first = false;
+            }
+        }
+        std::fprintf(f, "\n]}\n");
+        return std::fclose(f) == 0;
+    }
+
+private:
+    struct Event {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint64_t> start{0};
+        std::atomic<uint64_t> end{0};
+    };
+    struct Ring {
+        alignas(64) std::atomic<uint64_t> head{0};
+        std::string name;                               // under mu_
+        Event events[RING_EVENTS];
+    };
+
+    // Made on a thread's first span and kept for the life of the process,
+    // so a dump still shows threads that have exited.
+    static Ring& ring() {
+        thread_local Ring* mine = nullptr;
+        if (!mine) {
+            std::lock_guard<std::mutex> lk(mu_);
+            rings_.push_back(std::make_unique<Ring>());
+            mine = rings_.back().get();
+        }
+        return *mine;
+    }
+
+    static inline std::atomic<bool> on_{false};
+    static inline std::mutex mu_;
+    static inline std::vector<std::unique_ptr<Ring>> rings_;
+    static inline uint64_t base_ticks_ = 0;
+    static inline std::chrono::steady_clock::time_point base_time_{};
+};
+
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name) {
+        if (__builtin_expect(Trace::enabled(), 0)) {
+            name_ = name;
+            start_ = Trace::ticks();
+        }
+    }
+    ~TraceSpan() { end(); }
+
+    // Ends the span before the scope does; later calls do nothing.
+    void end() {
+        if (__builtin_expect(name_ != nullptr, 0)) {
+            Trace::emit(name_, start_, Trace::ticks());
+            name_ = nullptr;
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name_ = nullptr;
+    uint64_t start_ = 0;
+};
@@ -0,0 +1,307 @@
+// wheel_geometry.hpp
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "bet_book.hpp"
+#include "roulette.hpp"
+#include "spin_ahead.hpp"
+
+/**
+ * Wheel layouts as types, for wheels other than the two Wheel::Type knows
+ * (triple zero, promotional wheels with extra green pockets).
+ *
+ * A geometry is a struct of constants:
+ *
+ *   struct TripleZeroGeometry {
+ *       static constexpr std::string_view name = "triple-zero";
+ *       static constexpr WheelType table_type = WheelType::TripleZero;   // optional
+ *       static constexpr int numbers = 36;                     // 1..numbers, standard colours
+ *       static constexpr std::array<std::string_view, 3> greens = { "0", "00", "000" };
+ *       static constexpr std::array<uint8_t, 39> order = { ... }; // table indices, clockwise
+ *   };
+ *
+ * Table indices follow Wheel's: 0 is greens[0], 1..numbers are the
+ * numbers, and the other greens come after them ("00" is 37, "000" 38).
+ * Pocket::green tells the greens apart (isDoubleZero is set for greens[1]
+ * only), so "000" is not mistaken for "00".
+ * WheelTables<G> builds the pockets, labels, wheel positions and attribute
+ * masks at compile time and rejects a bad layout there (order not a
+ * permutation, more than 64 pockets, which is what coverage masks hold).
+ *
+ * GeometryWheel<G> spins and settles with the pocket count as a constant
+ * and no branch on the layout. WheelRegistry names every geometry at run
+ * time, so a configuration file can say "triple-zero" and get its
+ * tables, a spin source for it and an RngHealth for it. A geometry that
+ * names a table_type is one Table and the server can run (--wheel NAME);
+ * the rest are for simulation and health checks only.
+ */
+
+// ---------- Geometries ----------
+struct EuropeanGeometry {
+    static constexpr std::string_view name = "european";
+    static constexpr WheelType table_type = WheelType::European;
+    static constexpr int numbers = 36;
+    static constexpr std::array<std::string_view, 1> greens = { "0" };
+    static constexpr std::array<uint8_t, 37> order = {
+        0,32,15,19,4,21,2,25,17,34,6,27,13,36,11,30,8,23,10,
+        5,24,16,33,1,20,14,31,9,22,18,29,7,28,12,35,3,26
+    };
+};
+
+struct AmericanGeometry {
+    static constexpr std::string_view name = "american";
+    static constexpr WheelType table_type = WheelType::American;
+    static constexpr int numbers = 36;
+    static constexpr std::array<std::string_view, 2> greens = { "0", "00" };
+    static constexpr std::array<uint8_t, 38> order = {
+        0,28,9,26,30,11,7,20,32,17,5,22,34,15,3,24,36,13,1,
+        37,27,10,25,29,12,8,19,31,18,6,21,33,16,4,23,35,14,2
+    };
+};
+
+// The double-zero wheel with 000 between 2 and 0.
+struct TripleZeroGeometry {
+    static constexpr std::string_view name = "triple-zero";
+    static constexpr WheelType table_type = WheelType::TripleZero;
+    static constexpr int numbers = 36;
+    static constexpr std::array<std::string_view, 3> greens = { "0", "00", "000" };
+    static constexpr std::array<uint8_t, 39> order = {
+        0,28,9,26,30,11,7,20,32,17,5,22,34,15,3,24,36,13,1,
+        37,27,10,25,29,12,8,19,31,18,6,21,33,16,4,23,35,14,2,38
+    };
+};
+
+// ---------- Compile-time tables ----------
+namespace geometry_detail {
+// "0".."36", so labels can be string_views into static storage
+inline constexpr auto NUMBER_TEXT = [] {
+    std::array<std::array<char, 3>, 37> t{};
+    for (int n = 0; n <= 36; ++n) {
+        if (n < 10) t[n] = { char('0' + n), 0, 0 };
+        else        t[n] = { char('0' + n / 10), char('0' + n % 10), 0 };
+    }
+    return t;
+}();
+
+template <size_t N>
+constexpr bool is_permutation(const std::array<uint8_t, N>& order) {
+    std::array<bool, N> seen{};
+    for (uint8_t i : order) {
+        if (i >= N || seen[i]) return false;
+        seen[i] = true;
+    }
+    return true;
+}
+}  // namespace geometry_detail
+
+template <class G>
+struct WheelTables {
+    static constexpr int NUMBERS = G::numbers;
+    static constexpr int POCKETS = G::numbers + (int)G::greens.size();
+
+    static_assert(NUMBERS >= 1 && NUMBERS <= 36, "numbers are 1..36 at most");
+    static_assert(!G::greens.empty(), "a wheel needs a 0");
+    static_assert(POCKETS <= 64, "coverage masks hold 64 pockets");
+    static_assert((int)G::order.size() == POCKETS, "order must list every pocket once");
+    static_assert(geometry_detail::is_permutation(G::order), "order must list every pocket once");
+
+    static constexpr bool is_green_index(int i) { return i == 0 || i > NUMBERS; }
+    // 1 for greens[0], 2 for greens[1], ...; Pocket::green
+    static constexpr uint8_t green_of(int i) { return (uint8_t)(i == 0 ? 1 : i - NUMBERS + 1); }
+
+    static constexpr std::array<Pocket, POCKETS> pockets = [] {
+        std::array<Pocket, POCKETS> t{};
+        for (int i = 0; i < POCKETS; ++i)
+            t[i] = is_green_index(i) ? Pocket{0, i == NUMBERS + 1, build_attrs(0, true), green_of(i)}
+                                     : Pocket{i, false, build_attrs(i, false)};
+        return t;
+    }();
+
+    static constexpr std::array<std::string_view, POCKETS> labels = [] {
+        std::array<std::string_view, POCKETS> t{};
+        for (int i = 0; i < POCKETS; ++i)
+            t[i] = i == 0         ? G::greens[0]
+                 : i > NUMBERS    ? G::greens[i - NUMBERS]
+                                  : std::string_view(geometry_detail::NUMBER_TEXT[i].data());
+        return t;
+    }();
+
+    // index -> place on the wheel (the inverse of G::order)
+    static constexpr std::array<uint8_t, POCKETS> position = [] {
+        std::array<uint8_t, POCKETS> t{};
+        for (int p = 0; p < POCKETS; ++p) t[G::order[p]] = (uint8_t)p;
+        return t;
+    }();
+
+    // Pockets with `flag` as a coverage mask.
+    static constexpr uint64_t mask_of(uint16_t flag) {
+        uint64_t m = 0;
+        for (int i = 0; i < POCKETS; ++i) if (pockets[i].attrs & flag) m |= uint64_t{1} << i;
+        return m;
+    }
+
+    // -1 for a label not on this wheel.
+    static constexpr int index_of(std::string_view label) {
+        for (int i = 0; i < POCKETS; ++i) if (labels[i] == label) return i;
+        return -1;
+    }
+};
+
+// ---------- Wheel ----------
+template <class G, class Engine = std::mt19937_64>
+class GeometryWheel {
+public:
+    using Tables = WheelTables<G>;
+    static constexpr int POCKETS = Tables::POCKETS;
+
+    explicit GeometryWheel(uint64_t seed = std::random_device{}()) : rng_(seed) {}
+    explicit GeometryWheel(Engine&& engine) : rng_(std::move(engine)) {}
+
+    int spin_index() {
+        if constexpr (requires(Engine& e) { e.bounded(1u); }) {
+            return (int)rng_.bounded((uint32_t)POCKETS);
+        } else {
+            std::uniform_int_distribution<int> dist(0, POCKETS - 1);
+            return dist(rng_);
+        }
+    }
+
+    template <class T>
+    void spin_indices(T* out, size_t n) {
+        for (size_t i = 0; i < n; ++i) out[i] = (T)spin_index();
+    }
+
+    static const Pocket& pocket_by_index(int idx) { return Tables::pockets[idx]; }
+    static std::string label_by_index(int idx) { return std::string(Tables::labels[idx]); }
+
+    // A straight bet's mask by label, greens included ("000" is bit 38).
+    static constexpr uint64_t straight_mask(std::string_view label) {
+        const int i = Tables::index_of(label);
+        return i < 0 ? 0 : uint64_t{1} << i;
+    }
+
+    // Adds each entry's payout to paid_by_seat[e.seat] if it covers
+    // `index`, without a branch per bet; returns the total paid.
+    static double settle(const std::vector<BookEntry>& book, int index, double* paid_by_seat) {
+        double total = 0.0;
+        for (const BookEntry& e : book) {
+            const double paid = e.payout * (double)((e.mask >> index) & 1);
+            paid_by_seat[e.seat] += paid;
+            total += paid;
+        }
+        return total;
+    }
+
+    Engine& engine() { return rng_; }
+
+    std::string rng_state() const {
+        std::ostringstream os;
+        os << rng_;
+        return os.str();
+    }
+    void set_rng_state(const std::string& state) {
+        std::istringstream is(state);
+        is >> rng_;
+        if (!is) throw std::invalid_argument("bad wheel rng state");
+    }
+
+private:
+    Engine rng_;
+};
+
+// ---------- Runtime registry ----------
+// A geometry's tables behind plain pointers, for code that picks the
+// wheel at run time.
+struct WheelGeometryInfo {
+    std::string_view name;
+    int numbers = 0;
+    int pockets = 0;
+    const Pocket* table = nullptr;          // by index
+    const std::string_view* labels = nullptr;
+    const uint8_t* order = nullptr;         // indices in wheel order
+    std::unique_ptr<SpinSource> (*make_spins)(uint64_t seed) = nullptr;     // GeometryWheel<G>, inline
+    std::optional<WheelType> table_type;    // how a Table runs it; none = not servable
+
+    std::string_view label(int index) const { return labels[index]; }
+    int index_of(std::string_view label) const {
+        for (int i = 0; i < pockets; ++i) if (labels[i] == label) return i;
+        return -1;
+    }
+};
+
+template <class G>
+const WheelGeometryInfo& geometry_info() {
+    using T = WheelTables<G>;
+    static const WheelGeometryInfo info{
+        G::name, T::NUMBERS, T::POCKETS, T::pockets.data(), T::labels.data(), G::order.data(),
+        [](uint64_t seed) -> std::unique_ptr<SpinSource> {
+            return std::make_unique<InlineSpins<GeometryWheel<G>>>(GeometryWheel<G>(seed));
+        },
+        [] () -> std::optional<WheelType> {
+            if constexpr (requires { G::table_type; }) return G::table_type;
+            else return std::nullopt;
+        }() };
+    return info;
+}
+
+class WheelRegistry {
+public:
+    // The process-wide registry, with the built-in geometries in it.
+    static WheelRegistry& global() {
+        static WheelRegistry r = [] {
+            WheelRegistry w;
+            w.add<EuropeanGeometry>();
+            w.add<AmericanGeometry>();
+            w.add<TripleZeroGeometry>();
+            return w;
+        }();
+        return r;
+    }
+
+    // Throws std::invalid_argument if the name is taken.
+    template <class G>
+    void add() { add(geometry_info<G>()); }
+
+    void add(const WheelGeometryInfo& info) {
+        if (find(info.name)) throw std::invalid_argument("wheel already registered: " + std::string(info.name));
+        wheels_.push_back(&info);
+    }
+
+    const WheelGeometryInfo* find(std::string_view name) const {
+        for (const WheelGeometryInfo* w : wheels_) if (w->name == name) return w;
+        return nullptr;
+    }
+
+    // Throws std::invalid_argument for an unknown name.
+    const WheelGeometryInfo& get(std::string_view name) const {
+        if (const WheelGeometryInfo* w = find(name)) return *w;
+        throw std::invalid_argument("unknown wheel: " + std::string(name));
+    }
+
+    std::vector<std::string_view> names() const {
+        std::vector<std::string_view> out;
+        for (const WheelGeometryInfo* w : wheels_) out.push_back(w->name);
+        return out;
+    }
+
+private:
+    std::vector<const WheelGeometryInfo*> wheels_;
+};
+
+inline const WheelGeometryInfo& geometry_of(WheelType type) {
+    switch (type) {
+        case WheelType::European: return geometry_info<EuropeanGeometry>();
+        case WheelType::American: return geometry_info<AmericanGeometry>();
+        case WheelType::TripleZero: break;
+    }
+    return geometry_info<TripleZeroGeometry>();
+}
@@ -0,0 +1,377 @@
+// wire.hpp
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "bet.hpp"
+#include "crc32c.hpp"
+#include "table.hpp"
+
+/**
+ * Binary wire protocol for the table server.
+ *
+ * Every message is one frame: a 12-byte header and a fixed-layout payload.
+ *
+ *   offset  size  field
+ *        0     2  magic 0x52B7 (bytes B7 52; B7 never starts a text line)
+ *        2     1  version (1)
+ *        3     1  type (wire::Type)
+ *        4     2  payload length
+ *        6     2  reserved, 0
+ *        8     4  CRC-32C of bytes 0..7 followed by the payload
+ *
+ * Everything is little-endian. Payloads are the structs below byte for
+ * byte: fixed size per type, naturally aligned fields, explicit padding,
+ * strings NUL-padded. Only Text has a variable length; it carries one line
+ * of the text protocol, for commands that have no binary form yet.
+ *
+ * decode_frame() validates a frame in place in the receive buffer, and
+ * Frame::as<T>() reads the payload straight out of it, so decoding is a
+ * header check and one CRC over a few dozen bytes; nothing is tokenized
+ * or allocated.
+ *
+ * to_text() renders any message in the line protocol, which is what the
+ * server sends to text clients and what frame_to_text() prints for
+ * debugging a binary capture.
+ */
+
+static_assert(std::endian::native == std::endian::little,
+              "wire structs are memcpy'd as little-endian; add byte swaps for big-endian hosts");
+
+namespace wire {
+
+constexpr uint16_t MAGIC = 0x52B7;
+constexpr uint8_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 12;
+constexpr size_t MAX_TEXT = 1024;
+
+enum class Type : uint8_t {
+    // client -> server
+    Join = 1, Resume, PlaceBet, CancelBet, ModifyBet, Leave,
+    // server -> client
+    Joined = 0x81, BetAck, Cancelled, Error, Phase, Result, Settle,
+    // either way
+    Text = 0xF0,
+};
+
+// ---------- payloads ----------
+struct Join {
+    static constexpr Type TYPE = Type::Join;
+    uint32_t table;
+    uint32_t pad = 0;
+    double balance;
+    char name[16];
+};
+
+struct Resume {
+    static constexpr Type TYPE = Type::Resume;
+    uint32_t table;
+    uint32_t seat;
+    char name[16];
+};
+
+struct PlaceBet {
+    static constexpr Type TYPE = Type::PlaceBet;
+    double amount;
+    uint8_t bet_type;           // Bet::Type
+    char selection[15];         // empty for outside bets
+};
+
+struct CancelBet {
+    static constexpr Type TYPE = Type::CancelBet;
+    uint64_t bet;
+};
+
+struct ModifyBet {
+    static constexpr Type TYPE = Type::ModifyBet;
+    uint64_t bet;
+    double amount;
+};
+
+struct Leave {
+    static constexpr Type TYPE = Type::Leave;
+};
+
+struct Joined {
+    static constexpr Type TYPE = Type::Joined;
+    uint32_t table;
+    uint32_t seat;
+    double balance;
+};
+
+struct BetAck {
+    static constexpr Type TYPE = Type::BetAck;
+    uint64_t round;
+    uint64_t bet;
+    double amount;
+    double balance;
+};
+
+struct Cancelled {
+    static constexpr Type TYPE = Type::Cancelled;
+    uint64_t bet;
+    double balance;
+};
+
+struct Error {
+    static constexpr Type TYPE = Type::Error;
+    char reason[16];            // as after "ERR " in the text protocol
+};
+
+struct Phase {
+    static constexpr Type TYPE = Type::Phase;
+    uint64_t round;
+    uint32_t table;
+    uint8_t phase;              // Table::Phase
+    uint8_t pad[3] = {};
+};
+
+struct Result {
+    static constexpr Type TYPE = Type::Result;
+    static constexpr uint64_t NO_NONCE = UINT64_MAX;
+    uint64_t round;
+    uint64_t nonce;             // provably fair nonce, or NO_NONCE
+    uint32_t table;
+    uint8_t index;              // pocket index on the table's wheel
+    char label[3];              // "0".."36", "00", "000"; NUL-padded, unterminated when full (get_str)
+};
+
+struct Settle {
+    static constexpr Type TYPE = Type::Settle;
+    uint64_t round;
+    double staked;
+    double paid;
+    double balance;             // after payout
+    uint32_t table;
+    uint32_t pad = 0;
+};
+
+// Not a fixed layout: the payload is the line itself.
+struct Text {
+    static constexpr Type TYPE = Type::Text;
+    std::string_view line;
+};
+
+static_assert(sizeof(Join) == 32 && sizeof(Resume) == 24 && sizeof(PlaceBet) == 24 && sizeof(CancelBet) == 8 &&
+              sizeof(ModifyBet) == 16 && sizeof(Joined) == 16 && sizeof(BetAck) == 32 && sizeof(Cancelled) == 16 &&
+              sizeof(Error) == 16 && sizeof(Phase) == 16 && sizeof(Result) == 24 && sizeof(Settle) == 40,
+              "wire payload layouts are part of the protocol");
+
+// Payload size for a type: fixed size, -1 for variable (Text), -2 unknown.
+inline int payload_size(Type t) {
+    switch (t) {
+        case Type::Join:      return sizeof(Join);
+        case Type::Resume:    return sizeof(Resume);
+        case Type::PlaceBet:  return sizeof(PlaceBet);
+        case Type::CancelBet: return sizeof(CancelBet);
+        case Type::ModifyBet: return sizeof(ModifyBet);
+        case Type::Leave:     return 0;
+        case Type::Joined:    return sizeof(Joined);
+        case Type::BetAck:    return sizeof(BetAck);
+        case Type::Cancelled: return sizeof(Cancelled);
+        case Type::Error:     return sizeof(Error);
+        case Type::Phase:     return sizeof(Phase);
+        case Type::Result:    return sizeof(Result);
+        case Type::Settle:    return sizeof(Settle);
+        case Type::Text:      return -1;
+    }
+    return -2;
+}
+
+// NUL-padded copy, cut to fit with room for the NUL.
+template <size_t N>
+void set_str(char (&dst)[N], std::string_view s) {
+    std::memset(dst, 0, N);
+    std::memcpy(dst, s.data(), std::min(s.size(), N - 1));
+}
+
+template <size_t N>
+std::string_view get_str(const char (&src)[N]) {
+    return std::string_view(src, ::strnlen(src, N));
+}
+
+// ---------- encoding ----------
+inline void put_frame(std::string& out, Type type, const void* payload, size_t len) {
+    uint8_t h[HEADER_SIZE] = {};
+    h[0] = (uint8_t)MAGIC;
+    h[1] = (uint8_t)(MAGIC >> 8);
+    h[2] = VERSION;
+    h[3] = (uint8_t)type;
+    h[4] = (uint8_t)len;
+    h[5] = (uint8_t)(len >> 8);
+    const uint32_t crc = crc32c(payload, len, crc32c(h, 8));
+    std::memcpy(h + 8, &crc, 4);
+    out.append(reinterpret_cast<const char*>(h), HEADER_SIZE);
+    out.append(static_cast<const char*>(payload), len);
+}
+
+// Appends one frame to `out`.
+template <class M>
+void encode(const M& m, std::string& out) {
+    static_assert(std::is_trivially_copyable_v<M>);
+    if constexpr (std::is_empty_v<M>) put_frame(out, M::TYPE, nullptr, 0);
+    else put_frame(out, M::TYPE, &m, sizeof m);
+}
+
+inline void encode(const Text& m, std::string& out) {
+    put_frame(out, Type::Text, m.line.data(), std::min(m.line.size(), MAX_TEXT));
+}
+
+template <class M>
+std::string frame(const M& m) {
+    std::string out;
+    encode(m, out);
+    return out;
+}
+
+// ---------- decoding ----------
+enum class Status : uint8_t { Ok, NeedMore, BadMagic, BadVersion, BadType, BadLength, BadChecksum };
+
+// A validated frame inside someone else's buffer; valid while it is.
+struct Frame {
+    Type type;
+    uint16_t length;
+    const uint8_t* payload;
+
+    size_t size() const { return HEADER_SIZE + length; }
+
+    template <class M>
+    M as() const {
+        static_assert(std::is_trivially_copyable_v<M>);
+        M m;
+        std::memcpy(&m, payload, sizeof m);     // length was checked against sizeof(M)
+        return m;
+    }
+    std::string_view text() const { return std::string_view(reinterpret_cast<const char*>(payload), length); }
+};
+
+// Checks the frame at the start of [data, data + size). Ok fills `out`;
+// NeedMore means the frame isn't all there yet; anything else means the
+// stream can't be trusted from here on.
+inline Status decode_frame(const void* data, size_t size, Frame& out) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    if (size >= 2 && (p[0] | p[1] << 8) != MAGIC) return Status::BadMagic;
+    if (size < HEADER_SIZE) return Status::NeedMore;
+    if (p[2] != VERSION) return Status::BadVersion;
+    const Type type = (Type)p[3];
+    const uint16_t len = (uint16_t)(p[4] | p[5] << 8);
+    const int want = payload_size(type);
+    if (want == -2) return Status::BadType;
+    if (want >= 0 ? len != want : len > MAX_TEXT) return Status::BadLength;
+    if (size < HEADER_SIZE + len) return Status::NeedMore;
+    uint32_t crc;
+    std::memcpy(&crc, p + 8, 4);
+    if (crc32c(p + HEADER_SIZE, len, crc32c(p, 8)) != crc) return Status::BadChecksum;
+    out = Frame{ type, len, p + HEADER_SIZE };
+    return Status::Ok;
+}
+
+inline const char* status_name(Status s) {
+    switch (s) {
+        case Status::Ok:          return "OK";
+        case Status::NeedMore:    return "NEED_MORE";
+        case Status::BadMagic:    return "BAD_MAGIC";
+        case Status::BadVersion:  return "BAD_VERSION";
+        case Status::BadType:     return "BAD_TYPE";
+        case Status::BadLength:   return "BAD_LENGTH";
+        case Status::BadChecksum: return "BAD_CHECKSUM";
+    }
+    return "?";
+}
+
+// ---------- text bridge ----------
+namespace detail {
+
+__attribute__((format(printf, 1, 2)))
+inline std::string fmt(const char* f, ...) {
+    char buf[256];
+    va_list ap;
+    va_start(ap, f);
+    int n = std::vsnprintf(buf, sizeof buf, f, ap);
+    va_end(ap);
+    return std::string(buf, (size_t)std::clamp(n, 0, (int)sizeof buf - 1));
+}
+
+// "sixline" rather than "Six Line", so the line stays one token per field
+inline std::string bet_type_token(uint8_t t) {
+    if (t > (uint8_t)Bet::Type::Low) return "?";
+    std::string s;
+    for (char c : bet_type_to_string((Bet::Type)t)) if (c != ' ') s += (char)std::tolower((unsigned char)c);
+    return s;
+}
+
+inline std::string str(std::string_view s) { return std::string(s); }
+
+} // namespace detail
+
+inline std::string to_text(const Join& m) {
+    return detail::fmt("JOIN %u %s %.2f", m.table, detail::str(get_str(m.name)).c_str(), m.balance);
+}
+inline std::string to_text(const Resume& m) {
+    return detail::fmt("RESUME %u %u %s", m.table, m.seat, detail::str(get_str(m.name)).c_str());
+}
+inline std::string to_text(const PlaceBet& m) {
+    const std::string sel(get_str(m.selection));
+    return detail::fmt("BET %s %s %.2f", detail::bet_type_token(m.bet_type).c_str(), sel.empty() ? "-" : sel.c_str(), m.amount);
+}
+inline std::string to_text(const CancelBet& m) { return detail::fmt("CANCEL %llu", (unsigned long long)m.bet); }
+inline std::string to_text(const ModifyBet& m) {
+    return detail::fmt("MODIFY %llu %.2f", (unsigned long long)m.bet, m.amount);
+}
+inline std::string to_text(const Leave&) { return "LEAVE"; }
+
+inline std::string to_text(const Joined& m) { return detail::fmt("JOINED %u %u %.2f", m.table, m.seat, m.balance); }
+inline std::string to_text(const BetAck& m) {
+    return detail::fmt("ACK %llu %llu %.2f %.2f", (unsigned long long)m.round, (unsigned long long)m.bet,
+                       m.amount, m.balance);
+}
+inline std::string to_text(const Cancelled& m) {
+    return detail::fmt("CANCELLED %llu %.2f", (unsigned long long)m.bet, m.balance);
+}
+inline std::string to_text(const Error& m) { return "ERR " + detail::str(get_str(m.reason)); }
+inline std::string to_text(const Phase& m) {
+    const char* name = m.phase <= (uint8_t)Table::Phase::Payout ? phase_name((Table::Phase)m.phase) : "?";
+    return detail::fmt("PHASE %u %llu %s", m.table, (unsigned long long)m.round, name);
+}
+inline std::string to_text(const Result& m) {
+    const std::string label(get_str(m.label));
+    if (m.nonce == Result::NO_NONCE)
+        return detail::fmt("RESULT %u %llu %s", m.table, (unsigned long long)m.round, label.c_str());
+    return detail::fmt("RESULT %u %llu %s %llu", m.table, (unsigned long long)m.round, label.c_str(),
+                       (unsigned long long)m.nonce);
+}
+inline std::string to_text(const Settle& m) {
+    return detail::fmt("SETTLE %u %llu %.2f %.2f %.2f", m.table, (unsigned long long)m.round, m.staked, m.paid,
+                       m.balance);
+}
+inline std::string to_text(const Text& m) { return std::string(m.line); }
+
+// Any valid frame as its text-protocol line.
+inline std::string frame_to_text(const Frame& f) {
+    switch (f.type) {
+        case Type::Join:      return to_text(f.as<Join>());
+        case Type::Resume:    return to_text(f.as<Resume>());
+        case Type::PlaceBet:  return to_text(f.as<PlaceBet>());
+        case Type::CancelBet: return to_text(f.as<CancelBet>());
+        case Type::ModifyBet: return to_text(f.as<ModifyBet>());
+        case Type::Leave:     return to_text(Leave{});
+        case Type::Joined:    return to_text(f.as<Joined>());
+        case Type::BetAck:    return to_text(f.as<BetAck>());
+        case Type::Cancelled: return to_text(f.as<Cancelled>());
+        case Type::Error:     return to_text(f.as<Error>());
+        case Type::Phase:     return to_text(f.as<Phase>());
+        case Type::Result:    return to_text(f.as<Result>());
+        case Type::Settle:    return to_text(f.as<Settle>());
+        case Type::Text:      return std::string(f.text());
+    }
+    return "?";
+}
+
+} // namespace wire